@@ -0,0 +1,171 @@
+/**
+ * Messages versus frames per second when packing frames into batches
+ *
+ * A PUB socket sends binary wire sized frames through a packer to a SUB
+ * socket in the same process, over inproc and over TCP on the loopback.
+ * For each batch size the subscriber counts the messages and the frames
+ * it received per second, unpaced, so the per message cost shows as the
+ * gap between a batch size and the next.
+ *
+ * Usage: bench_batch [FRAMES]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <zmq.h>
+#include "vl53lx_platform_pack.h"
+
+#define FRAME_SIZE      192
+#define TOPIC           "bench/A/ranges"
+#define MAX_BATCH       128
+#define BUFFERS         256
+
+typedef struct
+{
+    void *socket;
+    uint64_t expected;
+    uint64_t frames;
+    uint64_t messages;
+} receiver_t;
+
+static VL53LX_Packer_t packer;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void send_batch(void *publisher, const char *topic, void *data, uint32_t len)
+{
+    zmq_msg_t msg;
+
+    zmq_send(publisher, topic, strlen(topic), ZMQ_SNDMORE);
+    zmq_msg_init_data(&msg, data, len, VL53LX_pool_release, &packer.pool);
+    if (zmq_msg_send(&msg, publisher, 0) < 0)
+        zmq_msg_close(&msg);
+}
+
+static void *receive(void *arg)
+{
+    receiver_t *pr = arg;
+    zmq_msg_t msg;
+
+    zmq_msg_init(&msg);
+    while (pr->frames < pr->expected) {
+        // Topic, then the batch
+        if (zmq_msg_recv(&msg, pr->socket, 0) < 0 || zmq_msg_recv(&msg, pr->socket, 0) < 0)
+            break;
+        pr->frames += zmq_msg_size(&msg) / FRAME_SIZE;
+        pr->messages++;
+    }
+    zmq_msg_close(&msg);
+    return NULL;
+}
+
+// Sends until the subscriber sees messages, PUB drops everything before.
+// Queues are unlimited so nothing is dropped
+static void connect_pair(void *context, const char *transport, void **publisher, void **subscriber)
+{
+    static int pairs;
+    char endpoint[64];
+    int timeout = 10;
+    int hwm = 0;
+    uint8_t byte;
+
+    if (strcmp(transport, "inproc") == 0)
+        snprintf(endpoint, sizeof(endpoint), "inproc://bench_batch-%d", pairs++);
+    else
+        snprintf(endpoint, sizeof(endpoint), "tcp://127.0.0.1:%d", 5590 + pairs++);
+    *publisher = zmq_socket(context, ZMQ_PUB);
+    *subscriber = zmq_socket(context, ZMQ_SUB);
+    zmq_setsockopt(*publisher, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(*subscriber, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_bind(*publisher, endpoint);
+    zmq_connect(*subscriber, endpoint);
+    zmq_setsockopt(*subscriber, ZMQ_SUBSCRIBE, "", 0);
+    zmq_setsockopt(*subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    do
+        zmq_send(*publisher, &byte, 1, 0);
+    while (zmq_recv(*subscriber, &byte, 1, 0) < 0);
+
+    // Drain the handshake messages, then block for good
+    while (zmq_recv(*subscriber, &byte, 1, 0) >= 0)
+        ;
+    timeout = -1;
+    zmq_setsockopt(*subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+static void run(void *context, const char *transport, uint32_t batch, uint64_t frames,
+                double *messages_per_s, double *frames_per_s)
+{
+    uint8_t frame[FRAME_SIZE];
+    void *publisher, *subscriber;
+    receiver_t r = {0};
+    pthread_t thread;
+    uint64_t start, elapsed, i;
+
+    connect_pair(context, transport, &publisher, &subscriber);
+    packer.max_frames = batch;
+    packer.user = publisher;
+
+    r.socket = subscriber;
+    r.expected = frames;
+    pthread_create(&thread, NULL, receive, &r);
+
+    memset(frame, 0x5A, sizeof(frame));
+    start = now_ns();
+    for (i = 0; i < frames; i++) {
+        if (VL53LX_pack_add(&packer, TOPIC, frame, sizeof(frame), VL53LX_PACK_NO_SEPARATOR, start) != 0) {
+            // Every buffer is still queued, same fallback as the publisher
+            zmq_send(publisher, TOPIC, strlen(TOPIC), ZMQ_SNDMORE);
+            zmq_send(publisher, frame, sizeof(frame), 0);
+        }
+    }
+    VL53LX_pack_flush(&packer);
+    pthread_join(thread, NULL);
+    elapsed = now_ns() - start;
+
+    *messages_per_s = r.messages / (elapsed / 1e9);
+    *frames_per_s = r.frames / (elapsed / 1e9);
+
+    zmq_close(publisher);
+    zmq_close(subscriber);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *transports[] = {"inproc", "tcp"};
+    static const uint32_t batches[] = {1, 2, 4, 8, 16, 32, 64, MAX_BATCH};
+    uint64_t frames = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+    double messages_per_s, frames_per_s;
+    void *context;
+    size_t t, b;
+
+    if (frames < 1000)
+        frames = 1000;
+    // Only the batch size flushes, the latency budget never runs out
+    if (VL53LX_pack_init(&packer, FRAME_SIZE * MAX_BATCH, BUFFERS, 1, UINT64_MAX / 2, send_batch, NULL) != 0)
+        return EXIT_FAILURE;
+    context = zmq_ctx_new();
+
+    printf("transport,batch,messages_per_s,frames_per_s\n");
+    for (t = 0; t < sizeof(transports) / sizeof(transports[0]); t++) {
+        for (b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            run(context, transports[t], batches[b], frames, &messages_per_s, &frames_per_s);
+            printf("%s,%u,%.0f,%.0f\n", transports[t], batches[b], messages_per_s, frames_per_s);
+        }
+    }
+
+    if (VL53LX_pool_exhausted(&packer.pool))
+        printf("pool ran out %u times, those frames were sent on their own\n", VL53LX_pool_exhausted(&packer.pool));
+
+    // Every message is released once the context is gone
+    zmq_ctx_destroy(context);
+    VL53LX_pack_free(&packer);
+    return 0;
+}
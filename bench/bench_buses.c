@@ -0,0 +1,86 @@
+/**
+ * Frames per second as buses are added, against simulated sensors
+ *
+ * Every bus carries two sensors ranging every 10 ms on a 400 kHz bus. The
+ * same sensors are run once from a single acquisition loop and once with
+ * one worker per bus.
+ *
+ * Usage: bench_buses [SECONDS] [MAX_BUSES]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "vl53lx_platform_worker.h"
+
+#define SENSORS_PER_BUS 2
+#define MAX_BUSES       (VL53LX_MULTI_MAX_SENSORS / SENSORS_PER_BUS)
+#define BUS             "sim:period=10000,clock=400000"
+
+static void count_frame(void *user, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
+{
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Runs groups managers of per_group sensors, one worker each
+static double run(int groups, int per_group, int seconds)
+{
+    static VL53LX_MultiSensor_t sensors[MAX_BUSES];
+    VL53LX_Worker_t workers[MAX_BUSES];
+    VL53LX_SensorConfig_t config[VL53LX_MULTI_MAX_SENSORS];
+    char name[24];
+    uint32_t frames = 0;
+    double start, elapsed;
+    int g, i;
+
+    for (g = 0; g < groups; g++) {
+        for (i = 0; i < per_group; i++) {
+            snprintf(name, sizeof(name), "%d.%d", g, i);
+            VL53LX_multi_parse_sensor(&config[i], name);
+        }
+        if (VL53LX_multi_init(&sensors[g], BUS, "", config, per_group) != VL53LX_ERROR_NONE ||
+            VL53LX_multi_start(&sensors[g]) != VL53LX_ERROR_NONE)
+            exit(EXIT_FAILURE);
+    }
+
+    start = now_s();
+    for (g = 0; g < groups; g++)
+        VL53LX_worker_start(&workers[g], &sensors[g], -1, count_frame, NULL);
+    sleep(seconds);
+    for (g = 0; g < groups; g++)
+        VL53LX_worker_cancel(&workers[g]);
+    for (g = 0; g < groups; g++) {
+        VL53LX_worker_join(&workers[g]);
+        frames += workers[g].frames;
+    }
+    elapsed = now_s() - start;
+
+    for (g = 0; g < groups; g++)
+        VL53LX_multi_close(&sensors[g]);
+    return frames / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    int max_buses = argc > 2 ? atoi(argv[2]) : MAX_BUSES;
+    int buses;
+
+    if (max_buses < 1 || max_buses > MAX_BUSES)
+        max_buses = MAX_BUSES;
+
+    printf("buses,sensors,single_loop_fps,per_bus_fps\n");
+    for (buses = 1; buses <= max_buses; buses++) {
+        double single = run(1, buses * SENSORS_PER_BUS, seconds);
+        double per_bus = run(buses, SENSORS_PER_BUS, seconds);
+        printf("%d,%d,%.1f,%.1f\n", buses, buses * SENSORS_PER_BUS, single, per_bus);
+    }
+    return 0;
+}
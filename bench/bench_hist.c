@@ -0,0 +1,439 @@
+/**
+ * Cost of the histogram post processing stages, per frame
+ *
+ * Runs over a corpus of histograms: synthetic scenes captured from the
+ * simulated sensor and any batch files recorded with vl53lx_pi --raw-file.
+ * Each stage is timed on its own, fed the inputs it gets inside
+ * VL53LX_hist_process_data(), which are prepared for every frame first:
+ *
+ *   process   VL53LX_hist_process_data(), the whole pipeline
+ *   pulses    VL53LX_f_025, ambient, dmax and pulse extraction
+ *   sigma     VL53LX_f_023, every sigma estimate of the frame
+ *   dmax      VL53LX_f_001, for every dmax reflectance
+ *   xtalk     VL53LX_f_033, crosstalk histogram removal
+ *
+ * The sigma estimates are called deep inside pulse extraction, the
+ * benchmark is linked with --wrap=VL53LX_f_023 to record their arguments.
+ *
+ * A pass runs a stage over every frame of a corpus, the time per frame is
+ * averaged over PASSES passes after one to warm up. One CSV line is
+ * printed per corpus and stage, with the CPU model, so results of Pi 3,
+ * Pi 4 and Pi Zero 2 can be collected and compared.
+ *
+ * Usage: bench_hist [-p PASSES] [-n FRAMES] [BATCH_FILE]...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "vl53lx_api.h"
+#include "vl53lx_hist_funcs.h"
+#include "vl53lx_hist_core.h"
+#include "vl53lx_hist_algos_gen3.h"
+#include "vl53lx_hist_algos_gen4.h"
+#include "vl53lx_sigma_estimate.h"
+#include "vl53lx_dmax.h"
+#include "vl53lx_xtalk.h"
+#include "vl53lx_core_support.h"
+#include "vl53lx_platform_multi.h"
+#include "vl53lx_platform_raw.h"
+#include "vl53lx_platform_batch.h"
+
+#define MAX_CORPORA     16
+#define MAX_SIGMA_CALLS 16
+
+// Arguments of one VL53LX_f_023 call
+typedef struct
+{
+    uint32_t arg[9];
+    uint16_t fast_osc_frequency;
+    uint8_t sigma_ref_mm;
+} sigma_call_t;
+
+typedef struct
+{
+    char name[64];
+    VL53LX_BatchContext_t context;
+    uint32_t count;
+    VL53LX_histogram_bin_data_t *hist;
+    VL53LX_RawInputs_t *inputs;
+    // Inputs of the stages, per frame
+    VL53LX_hist_post_process_config_t *post_cfg;
+    VL53LX_hist_gen3_dmax_config_t *dmax_cfg;
+    VL53LX_histogram_bin_data_t *averaged;
+    VL53LX_histogram_bin_data_t *removed;
+    VL53LX_histogram_bin_data_t *dmax_bins;
+    uint32_t *xtalk_rate;
+    sigma_call_t *sigma;
+    uint8_t *sigma_count;
+} corpus_t;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(corpus_t *pc, uint32_t i);
+} stage_t;
+
+// Scenes of the simulated sensor, see vl53lx_platform_sim.h
+static const char *const scenes[][2] = {
+    {"near", "target=150"},
+    {"mid", "target=1200"},
+    {"far", "target=3500"},
+    {"two_targets", "target=600,target=1800"},
+    {"bright_ambient", "target=1200,ambient=8000"},
+    {"no_target", "ambient=1000"},
+};
+
+static _Alignas(16) uint8_t area1[VL53LX_BATCH_WORK_AREA1_SIZE];
+static _Alignas(16) uint8_t area2[VL53LX_BATCH_WORK_AREA2_SIZE];
+static VL53LX_hist_gen3_dmax_private_data_t dmax_private;
+static VL53LX_histogram_bin_data_t hist;
+static VL53LX_range_results_t results;
+static int16_t dmax_mm[VL53LX_MAX_AMBIENT_DMAX_VALUES];
+
+// Where the wrapper records the sigma estimates of a frame, NULL when not
+// recording
+static sigma_call_t *recording;
+static uint8_t recorded;
+
+VL53LX_Error __real_VL53LX_f_023(uint8_t sigma_estimator__sigma_ref_mm, uint32_t VL53LX_p_007,
+                                 uint32_t VL53LX_p_032, uint32_t VL53LX_p_001, uint32_t a_zp,
+                                 uint32_t c_zp, uint32_t bx, uint32_t ax_zp, uint32_t cx_zp,
+                                 uint32_t VL53LX_p_028, uint16_t fast_osc_frequency, uint16_t *psigma_est);
+
+VL53LX_Error __wrap_VL53LX_f_023(uint8_t sigma_estimator__sigma_ref_mm, uint32_t VL53LX_p_007,
+                                 uint32_t VL53LX_p_032, uint32_t VL53LX_p_001, uint32_t a_zp,
+                                 uint32_t c_zp, uint32_t bx, uint32_t ax_zp, uint32_t cx_zp,
+                                 uint32_t VL53LX_p_028, uint16_t fast_osc_frequency, uint16_t *psigma_est)
+{
+    sigma_call_t *psc;
+
+    if (recording != NULL && recorded < MAX_SIGMA_CALLS) {
+        psc = &recording[recorded++];
+        psc->sigma_ref_mm = sigma_estimator__sigma_ref_mm;
+        psc->arg[0] = VL53LX_p_007;
+        psc->arg[1] = VL53LX_p_032;
+        psc->arg[2] = VL53LX_p_001;
+        psc->arg[3] = a_zp;
+        psc->arg[4] = c_zp;
+        psc->arg[5] = bx;
+        psc->arg[6] = ax_zp;
+        psc->arg[7] = cx_zp;
+        psc->arg[8] = VL53LX_p_028;
+        psc->fast_osc_frequency = fast_osc_frequency;
+    }
+    return __real_VL53LX_f_023(sigma_estimator__sigma_ref_mm, VL53LX_p_007, VL53LX_p_032, VL53LX_p_001,
+                               a_zp, c_zp, bx, ax_zp, cx_zp, VL53LX_p_028, fast_osc_frequency, psigma_est);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Processing writes to the histogram, each run starts from the recording
+static void run_process(corpus_t *pc, uint32_t i)
+{
+    VL53LX_BatchContext_t *pctx = &pc->context;
+    uint8_t histo_merge_nb = pc->inputs[i].histo_merge_nb;
+
+    hist = pc->hist[i];
+    VL53LX_hist_process_data(&pctx->dmax_cal, &pc->dmax_cfg[i], &pc->post_cfg[i], &hist, &pctx->xtalk_shape,
+                             area1, area2, &results, &histo_merge_nb);
+}
+
+static void run_pulses(corpus_t *pc, uint32_t i)
+{
+    VL53LX_BatchContext_t *pctx = &pc->context;
+
+    VL53LX_f_025(&pctx->dmax_cal, &pc->dmax_cfg[i], &pc->post_cfg[i], &pc->averaged[i], &pc->removed[i],
+                 (VL53LX_hist_gen3_algo_private_data_t *)area1, (VL53LX_hist_gen4_algo_filtered_data_t *)area2,
+                 &dmax_private, &results, pc->inputs[i].histo_merge_nb);
+}
+
+static void run_sigma(corpus_t *pc, uint32_t i)
+{
+    const sigma_call_t *psc = &pc->sigma[(size_t)i * MAX_SIGMA_CALLS];
+    uint16_t sigma;
+    int k;
+
+    for (k = 0; k < pc->sigma_count[i]; k++, psc++)
+        __real_VL53LX_f_023(psc->sigma_ref_mm, psc->arg[0], psc->arg[1], psc->arg[2], psc->arg[3],
+                            psc->arg[4], psc->arg[5], psc->arg[6], psc->arg[7], psc->arg[8],
+                            psc->fast_osc_frequency, &sigma);
+}
+
+static void run_dmax(corpus_t *pc, uint32_t i)
+{
+    VL53LX_BatchContext_t *pctx = &pc->context;
+    int p;
+
+    for (p = 0; p < VL53LX_MAX_AMBIENT_DMAX_VALUES; p++)
+        VL53LX_f_001(pc->dmax_cfg[i].target_reflectance_for_dmax_calc[p], &pctx->dmax_cal, &pc->dmax_cfg[i],
+                     &pc->dmax_bins[i], &dmax_private, &dmax_mm[p]);
+}
+
+static void run_xtalk(corpus_t *pc, uint32_t i)
+{
+    VL53LX_f_033(&pc->averaged[i], &pc->context.xtalk_shape.xtalk_shape, pc->xtalk_rate[i],
+                 &pc->removed[i]);
+}
+
+static const stage_t stages[] = {
+    {"process", run_process},
+    {"pulses", run_pulses},
+    {"sigma", run_sigma},
+    {"dmax", run_dmax},
+    {"xtalk", run_xtalk},
+};
+
+// Computes the inputs every stage gets for every frame, as
+// VL53LX_hist_process_data() and VL53LX_f_025 prepare them
+static int prepare(corpus_t *pc)
+{
+    VL53LX_BatchContext_t *pctx = &pc->context;
+    VL53LX_hist_post_process_config_t *pcfg;
+    VL53LX_histogram_bin_data_t *pbins;
+    uint32_t i;
+
+    pc->post_cfg = calloc(pc->count, sizeof(*pc->post_cfg));
+    pc->dmax_cfg = calloc(pc->count, sizeof(*pc->dmax_cfg));
+    pc->averaged = calloc(pc->count, sizeof(*pc->averaged));
+    pc->removed = calloc(pc->count, sizeof(*pc->removed));
+    pc->dmax_bins = calloc(pc->count, sizeof(*pc->dmax_bins));
+    pc->xtalk_rate = calloc(pc->count, sizeof(*pc->xtalk_rate));
+    pc->sigma = calloc((size_t)pc->count * MAX_SIGMA_CALLS, sizeof(*pc->sigma));
+    pc->sigma_count = calloc(pc->count, sizeof(*pc->sigma_count));
+    if (pc->post_cfg == NULL || pc->dmax_cfg == NULL || pc->averaged == NULL || pc->removed == NULL || pc->dmax_bins == NULL || pc->xtalk_rate == NULL ||
+        pc->sigma == NULL || pc->sigma_count == NULL) {
+        printf("Failed to allocate the inputs of %u frames.\n", pc->count);
+        return -1;
+    }
+
+    pctx->dmax_cfg.ambient_thresh_sigma = pctx->post_cfg.ambient_thresh_sigma1;
+    for (i = 0; i < pc->count; i++) {
+        // The offsets and SPADs of the range, as VL53LX_batch_process() sets them
+        pcfg = &pc->post_cfg[i];
+        *pcfg = pctx->post_cfg;
+        pcfg->algo__crosstalk_compensation_plane_offset_kcps = pc->inputs[i].xtalk_plane_offset_kcps;
+        pcfg->range_offset_mm = pc->inputs[i].range_offset_mm;
+        pc->dmax_cfg[i] = pctx->dmax_cfg;
+        pc->dmax_cfg[i].max_effective_spads = pc->inputs[i].max_effective_spads;
+
+        hist = pc->hist[i];
+        VL53LX_f_031(&hist, &pc->averaged[i]);
+
+        pbins = &pc->removed[i];
+        VL53LX_init_histogram_bin_data_struct(0, pctx->xtalk_shape.xtalk_shape.VL53LX_p_021, pbins);
+        VL53LX_copy_xtalk_bin_data_to_histogram_data_struct(&pctx->xtalk_shape.xtalk_shape, pbins);
+        VL53LX_f_032(pcfg->algo__crosstalk_compensation_plane_offset_kcps,
+                     pcfg->algo__crosstalk_compensation_x_plane_gradient_kcps,
+                     pcfg->algo__crosstalk_compensation_y_plane_gradient_kcps, 0, 0,
+                     hist.result__dss_actual_effective_spads, hist.roi_config__user_roi_centre_spad,
+                     hist.roi_config__user_roi_requested_global_xy_size, &pc->xtalk_rate[i]);
+        VL53LX_f_033(&pc->averaged[i], &pctx->xtalk_shape.xtalk_shape, pc->xtalk_rate[i], pbins);
+
+        pbins = &pc->dmax_bins[i];
+        *pbins = pc->averaged[i];
+        VL53LX_hist_calc_zero_distance_phase(pbins);
+        VL53LX_hist_estimate_ambient_from_thresholded_bins((int32_t)pcfg->ambient_thresh_sigma0, pbins);
+        VL53LX_hist_estimate_ambient_from_ambient_bins(pbins);
+        VL53LX_hist_remove_ambient_bins(pbins);
+
+        recording = &pc->sigma[(size_t)i * MAX_SIGMA_CALLS];
+        recorded = 0;
+        run_process(pc, i);
+        pc->sigma_count[i] = recorded;
+        recording = NULL;
+    }
+    return 0;
+}
+
+// Ranges the simulated sensor once for its processing context, then
+// captures raw histograms
+static int synthesize(corpus_t *pc, const char *name, const char *scene, uint32_t frames)
+{
+    VL53LX_MultiSensor_t sensors;
+    VL53LX_SensorConfig_t config;
+    VL53LX_MultiRangingData_t ranging;
+    VL53LX_AdditionalData_t additional;
+    VL53LX_DEV Dev;
+    VL53LX_Error status;
+    char bus[128];
+    uint32_t i;
+
+    snprintf(pc->name, sizeof(pc->name), "sim_%s", name);
+    snprintf(bus, sizeof(bus), "sim:seed=1,%s", scene);
+    VL53LX_multi_parse_sensor(&config, "bench");
+    if (VL53LX_multi_init(&sensors, bus, "", &config, 1) != VL53LX_ERROR_NONE ||
+        VL53LX_multi_start(&sensors) != VL53LX_ERROR_NONE)
+        return -1;
+    Dev = &sensors.sensor[0].dev;
+
+    status = VL53LX_WaitMeasurementDataReady(Dev);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GetMultiRangingData(Dev, &ranging);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GetBatchContext(Dev, &pc->context);
+    VL53LX_ClearInterruptAndStartMeasurement(Dev);
+
+    pc->hist = calloc(frames, sizeof(*pc->hist));
+    pc->inputs = calloc(frames, sizeof(*pc->inputs));
+    for (i = 0; status == VL53LX_ERROR_NONE && pc->hist != NULL && pc->inputs != NULL && i < frames; i++) {
+        status = VL53LX_WaitMeasurementDataReady(Dev);
+        if (status == VL53LX_ERROR_NONE)
+            status = VL53LX_GetRawHistogramData(Dev, &additional);
+        VL53LX_GetRawHistogramInputs(Dev, &pc->inputs[i]);
+        pc->hist[i] = additional.VL53LX_p_006;
+        VL53LX_ClearInterruptAndStartMeasurement(Dev);
+    }
+    pc->count = i;
+    VL53LX_multi_close(&sensors);
+
+    if (status != VL53LX_ERROR_NONE || pc->hist == NULL || pc->inputs == NULL) {
+        printf("Failed to capture the %s scene, status %d.\n", name, status);
+        return -1;
+    }
+    return 0;
+}
+
+static int load(corpus_t *pc, const char *path, uint32_t frames)
+{
+    VL53LX_Batch_t batch;
+    const char *base = strrchr(path, '/');
+    uint32_t i;
+
+    if (VL53LX_batch_map(&batch, path) != 0)
+        return -1;
+    snprintf(pc->name, sizeof(pc->name), "%s", base != NULL ? base + 1 : path);
+    pc->context = batch.context;
+    pc->count = batch.count < frames ? batch.count : frames;
+    pc->hist = calloc(pc->count ? pc->count : 1, sizeof(*pc->hist));
+    pc->inputs = calloc(pc->count ? pc->count : 1, sizeof(*pc->inputs));
+    for (i = 0; pc->hist != NULL && pc->inputs != NULL && i < pc->count; i++) {
+        pc->hist[i] = batch.frames[i].hist;
+        pc->inputs[i] = batch.frames[i].inputs;
+    }
+    VL53LX_batch_unmap(&batch);
+
+    if (pc->count == 0 || pc->hist == NULL || pc->inputs == NULL) {
+        printf("Failed to load frames from %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Model of the Pi, or of any other CPU, commas would split the CSV
+static void cpu_model(char *out, size_t size)
+{
+    char line[256], *value;
+    FILE *fp;
+
+    snprintf(out, size, "unknown");
+    fp = fopen("/proc/cpuinfo", "r");
+    if (fp == NULL)
+        return;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        value = strchr(line, ':');
+        if (value == NULL)
+            continue;
+        // The Pi names the board last, with "Model"
+        if (strncmp(line, "Model", 5) == 0 || strncmp(line, "model name", 10) == 0) {
+            snprintf(out, size, "%s", value + 2);
+            out[strcspn(out, "\n")] = '\0';
+        }
+    }
+    fclose(fp);
+    for (; *out != '\0'; out++)
+        if (*out == ',')
+            *out = ' ';
+}
+
+static void measure(const char *cpu, corpus_t *pc, const stage_t *st, int passes)
+{
+    double mean = 0, m2 = 0, min = INFINITY, ns, delta, variance;
+    uint64_t start, calls = 0;
+    uint32_t i;
+    int p;
+
+    for (p = -1; p < passes; p++) {
+        start = now_ns();
+        for (i = 0; i < pc->count; i++)
+            st->run(pc, i);
+        ns = (double)(now_ns() - start) / pc->count;
+        // The first pass warms the caches up
+        if (p < 0)
+            continue;
+        delta = ns - mean;
+        mean += delta / (p + 1);
+        m2 += delta * (ns - mean);
+        if (ns < min)
+            min = ns;
+    }
+    variance = passes > 1 ? m2 / (passes - 1) : 0;
+
+    if (st->run == run_sigma)
+        for (i = 0; i < pc->count; i++)
+            calls += pc->sigma_count[i];
+    else
+        calls = st->run == run_dmax ? (uint64_t)pc->count * VL53LX_MAX_AMBIENT_DMAX_VALUES : pc->count;
+
+    printf("%s,%s,%s,%u,%.2f,%d,%.1f,%.1f,%.1f,%.1f,%.0f\n", cpu, pc->name, st->name, pc->count,
+           (double)calls / pc->count, passes, mean, min, sqrt(variance), variance, mean > 0 ? 1e9 / mean : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    static corpus_t corpora[MAX_CORPORA];
+    uint32_t frames = 200, count = 0;
+    int passes = 20;
+    char cpu[128];
+    size_t s;
+    int c, i;
+
+    while ((c = getopt(argc, argv, "p:n:")) != -1) {
+        switch (c) {
+        case 'p':
+            passes = atoi(optarg);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        default:
+            printf("Usage: %s [-p PASSES] [-n FRAMES] [BATCH_FILE]...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (passes < 1)
+        passes = 1;
+    if (frames < 1)
+        frames = 1;
+
+    // A corpus missing would silently change what the numbers mean
+    for (s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++)
+        if (synthesize(&corpora[count++], scenes[s][0], scenes[s][1], frames) != 0)
+            return EXIT_FAILURE;
+    if (count + argc - optind > MAX_CORPORA) {
+        printf("At most %u batch files.\n", MAX_CORPORA - count);
+        return EXIT_FAILURE;
+    }
+    for (i = optind; i < argc; i++)
+        if (load(&corpora[count++], argv[i], frames) != 0)
+            return EXIT_FAILURE;
+    for (i = 0; i < (int)count; i++)
+        if (prepare(&corpora[i]) != 0)
+            return EXIT_FAILURE;
+
+    cpu_model(cpu, sizeof(cpu));
+    printf("cpu,corpus,stage,frames,calls_per_frame,passes,ns_per_frame,min_ns,stddev_ns,variance_ns2,"
+           "frames_per_s\n");
+    for (i = 0; i < (int)count; i++)
+        for (s = 0; s < sizeof(stages) / sizeof(stages[0]); s++)
+            measure(cpu, &corpora[i], &stages[s], passes);
+    return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * Copying versus zero copy publishing over the inproc transport
+ *
+ * A PUB socket sends frames to a SUB socket in the same process, either
+ * formatted in a stack buffer and copied by zmq_send() or formatted in a
+ * pool buffer and handed over with zmq_msg_init_data(). For each frame
+ * size the benchmark measures the unpaced throughput and, under a paced
+ * 1 kHz load like a fast sensor, the time spent in the send path and the
+ * publish to receive latency.
+ *
+ * Usage: bench_publish [FRAMES]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <zmq.h>
+#include "vl53lx_platform_pool.h"
+
+#define ENDPOINT        "inproc://bench_publish"
+#define RATE_HZ         1000
+#define POOL_BUFFERS    1024
+#define MAX_FRAME_SIZE  3000
+
+typedef struct
+{
+    void *socket;
+    uint32_t expected;
+    uint32_t received;
+    uint64_t *latency_ns;
+} receiver_t;
+
+static VL53LX_Pool_t pool;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Stands in for formatting a frame, the send time goes first
+static void fill(uint8_t *data, size_t size, uint32_t seq)
+{
+    uint64_t t = now_ns();
+
+    memset(data + sizeof(t), (uint8_t)seq, size - sizeof(t));
+    memcpy(data, &t, sizeof(t));
+}
+
+static void publish(void *publisher, size_t size, uint32_t seq, int zero_copy)
+{
+    uint8_t copy[MAX_FRAME_SIZE];
+    zmq_msg_t msg;
+    uint8_t *data;
+
+    if (!zero_copy) {
+        fill(copy, size, seq);
+        zmq_send(publisher, copy, size, 0);
+        return;
+    }
+
+    data = VL53LX_pool_get(&pool);
+    if (data == NULL) {
+        fill(copy, size, seq);
+        zmq_send(publisher, copy, size, 0);
+        return;
+    }
+    fill(data, size, seq);
+    zmq_msg_init_data(&msg, data, size, VL53LX_pool_release, &pool);
+    if (zmq_msg_send(&msg, publisher, 0) < 0)
+        zmq_msg_close(&msg);
+}
+
+static void *receive(void *arg)
+{
+    receiver_t *pr = arg;
+    uint64_t sent;
+    zmq_msg_t msg;
+
+    zmq_msg_init(&msg);
+    while (pr->received < pr->expected) {
+        if (zmq_msg_recv(&msg, pr->socket, 0) < 0)
+            break;
+        memcpy(&sent, zmq_msg_data(&msg), sizeof(sent));
+        if (pr->latency_ns != NULL)
+            pr->latency_ns[pr->received] = now_ns() - sent;
+        pr->received++;
+    }
+    zmq_msg_close(&msg);
+    return NULL;
+}
+
+// Sends until the subscriber sees frames, PUB drops everything before.
+// Queues are unlimited so nothing is dropped, the pool falls back to
+// copies if the subscriber lags more than POOL_BUFFERS frames
+static void connect_pair(void *context, void **publisher, void **subscriber)
+{
+    static int pairs;
+    char endpoint[64];
+    int timeout = 10;
+    int hwm = 0;
+    uint8_t byte;
+
+    // inproc names are only released once the reaper closed the socket
+    snprintf(endpoint, sizeof(endpoint), ENDPOINT "-%d", pairs++);
+    *publisher = zmq_socket(context, ZMQ_PUB);
+    *subscriber = zmq_socket(context, ZMQ_SUB);
+    zmq_setsockopt(*publisher, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(*subscriber, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_bind(*publisher, endpoint);
+    zmq_connect(*subscriber, endpoint);
+    zmq_setsockopt(*subscriber, ZMQ_SUBSCRIBE, "", 0);
+    zmq_setsockopt(*subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    do
+        zmq_send(*publisher, &byte, 1, 0);
+    while (zmq_recv(*subscriber, &byte, 1, 0) < 0);
+
+    // Drain the handshake frames, then block for good
+    while (zmq_recv(*subscriber, &byte, 1, 0) >= 0)
+        ;
+    timeout = -1;
+    zmq_setsockopt(*subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+// Unpaced, frames the subscriber received per second
+static double throughput(void *context, size_t size, uint32_t frames, int zero_copy)
+{
+    void *publisher, *subscriber;
+    receiver_t r = {0};
+    pthread_t thread;
+    uint64_t start;
+    uint32_t i;
+
+    connect_pair(context, &publisher, &subscriber);
+    r.socket = subscriber;
+    r.expected = frames;
+    pthread_create(&thread, NULL, receive, &r);
+
+    start = now_ns();
+    for (i = 0; i < frames; i++)
+        publish(publisher, size, i, zero_copy);
+    pthread_join(thread, NULL);
+
+    zmq_close(publisher);
+    zmq_close(subscriber);
+    return r.received / ((now_ns() - start) / 1e9);
+}
+
+// Paced at RATE_HZ, send path cost and latency percentiles in us
+static void paced(void *context, size_t size, uint32_t frames, int zero_copy, double *send_us,
+                  double *p50_us, double *p99_us, double *max_us)
+{
+    void *publisher, *subscriber;
+    receiver_t r = {0};
+    struct timespec next;
+    pthread_t thread;
+    uint64_t spent = 0, t;
+    uint32_t i;
+
+    connect_pair(context, &publisher, &subscriber);
+    r.socket = subscriber;
+    r.expected = frames;
+    r.latency_ns = calloc(frames, sizeof(*r.latency_ns));
+    pthread_create(&thread, NULL, receive, &r);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (i = 0; i < frames; i++) {
+        next.tv_nsec += 1000000000L / RATE_HZ;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        t = now_ns();
+        publish(publisher, size, i, zero_copy);
+        spent += now_ns() - t;
+    }
+    pthread_join(thread, NULL);
+
+    qsort(r.latency_ns, r.received, sizeof(*r.latency_ns), compare_u64);
+    *send_us = spent / 1e3 / frames;
+    *p50_us = r.latency_ns[r.received / 2] / 1e3;
+    *p99_us = r.latency_ns[(uint64_t)r.received * 99 / 100] / 1e3;
+    *max_us = r.latency_ns[r.received - 1] / 1e3;
+
+    free(r.latency_ns);
+    zmq_close(publisher);
+    zmq_close(subscriber);
+}
+
+int main(int argc, char *argv[])
+{
+    static const size_t sizes[] = {192, 240, 1024, MAX_FRAME_SIZE};
+    uint32_t frames = argc > 1 ? atoi(argv[1]) : 5000;
+    double fps, send_us, p50, p99, max;
+    void *context;
+    size_t s;
+    int zero_copy;
+
+    if (frames < 100)
+        frames = 100;
+    if (VL53LX_pool_init(&pool, MAX_FRAME_SIZE, POOL_BUFFERS) != 0)
+        return EXIT_FAILURE;
+    context = zmq_ctx_new();
+
+    printf("bytes,mode,unpaced_fps,send_us_at_%dHz,p50_us,p99_us,max_us\n", RATE_HZ);
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (zero_copy = 0; zero_copy < 2; zero_copy++) {
+            fps = throughput(context, sizes[s], frames * 20, zero_copy);
+            paced(context, sizes[s], frames, zero_copy, &send_us, &p50, &p99, &max);
+            printf("%zu,%s,%.0f,%.2f,%.1f,%.1f,%.1f\n", sizes[s], zero_copy ? "zero_copy" : "copy",
+                   fps, send_us, p50, p99, max);
+        }
+    }
+    if (VL53LX_pool_exhausted(&pool))
+        printf("pool ran out %u times, those frames were copied\n", VL53LX_pool_exhausted(&pool));
+
+    zmq_ctx_destroy(context);
+    VL53LX_pool_free(&pool);
+    return 0;
+}
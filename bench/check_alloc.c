@@ -0,0 +1,100 @@
+/**
+ * Heap allocations made by the ranging loop, which must make none
+ *
+ * Ranges a simulated sensor for a few frames to settle, then counts every
+ * malloc, calloc and realloc issued by the driver and platform layer while
+ * it reads FRAMES frames with VL53LX_GetMultiRangingData() and restarts
+ * each range with VL53LX_ClearInterruptAndStartMeasurement(). Linked with
+ * --wrap=malloc,--wrap=calloc,--wrap=realloc, only calls from the objects
+ * of this program and of libVL53LX_pi are counted, not those inside libc.
+ *
+ * Exits non-zero when anything was allocated, run by make check-alloc.
+ *
+ * Usage: check_alloc [FRAMES]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "vl53lx_api.h"
+#include "vl53lx_platform_multi.h"
+
+#define BUS             "sim:period=1000"
+#define WARMUP_FRAMES   10
+
+static int counting = 0;
+static uint32_t allocations = 0;
+static size_t allocated = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if (counting) {
+        allocations++;
+        allocated += size;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    if (counting) {
+        allocations++;
+        allocated += count * size;
+    }
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (counting) {
+        allocations++;
+        allocated += size;
+    }
+    return __real_realloc(ptr, size);
+}
+
+static VL53LX_Error range(VL53LX_DEV Dev, VL53LX_MultiRangingData_t *pdata)
+{
+    VL53LX_Error status;
+
+    status = VL53LX_WaitMeasurementDataReady(Dev);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GetMultiRangingData(Dev, pdata);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_ClearInterruptAndStartMeasurement(Dev);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    static VL53LX_MultiSensor_t sensors;
+    VL53LX_MultiRangingData_t data;
+    VL53LX_SensorConfig_t config;
+    VL53LX_Error status = VL53LX_ERROR_NONE;
+    int frames = argc > 1 ? atoi(argv[1]) : 1000;
+    int i;
+
+    VL53LX_multi_parse_sensor(&config, "check");
+    if (VL53LX_multi_init(&sensors, BUS, "", &config, 1) != VL53LX_ERROR_NONE ||
+        VL53LX_multi_start(&sensors) != VL53LX_ERROR_NONE)
+        return EXIT_FAILURE;
+
+    for (i = 0; i < WARMUP_FRAMES && status == VL53LX_ERROR_NONE; i++)
+        status = range(&sensors.sensor[0].dev, &data);
+
+    counting = 1;
+    for (i = 0; i < frames && status == VL53LX_ERROR_NONE; i++)
+        status = range(&sensors.sensor[0].dev, &data);
+    counting = 0;
+
+    VL53LX_multi_close(&sensors);
+    if (status != VL53LX_ERROR_NONE) {
+        printf("Ranging failed after %d frames: %d\n", i, status);
+        return EXIT_FAILURE;
+    }
+    printf("%d frames, %u allocations of %zu bytes\n", frames, allocations, allocated);
+    return allocations ? EXIT_FAILURE : EXIT_SUCCESS;
+}
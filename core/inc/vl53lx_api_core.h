@@ -182,6 +182,13 @@ VL53LX_Error VL53LX_get_measurement_results(
 
 
 
+VL53LX_Error VL53LX_update_hist_post_process_config(
+	VL53LX_DEV                 Dev,
+	uint8_t                   *phisto_merge_nb);
+
+
+
+
 VL53LX_Error VL53LX_get_device_results(
 	VL53LX_DEV                 Dev,
 	VL53LX_DeviceResultsLevel  device_result_level,
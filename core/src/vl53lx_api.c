@@ -1033,6 +1033,7 @@ VL53LX_Error VL53LX_GetMultiRangingData(VL53LX_DEV Dev,
 			VL53LXDevStructGetLLDriverHandle(Dev);
 	VL53LX_range_results_t *presults =
 			(VL53LX_range_results_t *) pdev->wArea1;
+	VL53LX_PROFILE_DECLARE(stage_start);
 
 	LOG_FUNCTION_START("");
 
@@ -1046,9 +1047,11 @@ VL53LX_Error VL53LX_GetMultiRangingData(VL53LX_DEV Dev,
 				VL53LX_DEVICERESULTSLEVEL_FULL,
 				presults);
 
+	VL53LX_PROFILE_START(stage_start);
 	Status = SetMeasurementData(Dev,
 					presults,
 					pMultiRangingData);
+	VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_SET_MEASUREMENT, stage_start);
 
 	LOG_FUNCTION_END(Status);
 	return Status;
@@ -48,8 +48,6 @@
 	_LOG_TRACE_PRINT(VL53LX_TRACE_MODULE_CORE, \
 	level, VL53LX_TRACE_FUNCTION_NONE, ##__VA_ARGS__)
 
-#define VL53LX_MAX_I2C_XFER_SIZE 256
-
 static VL53LX_Error select_offset_per_vcsel(VL53LX_LLDriverData_t *pdev,
 		int16_t *poffset) {
 	VL53LX_Error status = VL53LX_ERROR_NONE;
@@ -2060,6 +2058,116 @@ VL53LX_Error VL53LX_get_measurement_results(
 }
 
 
+VL53LX_Error VL53LX_update_hist_post_process_config(
+	VL53LX_DEV                    Dev,
+	uint8_t                      *phisto_merge_nb)
+{
+
+
+	VL53LX_Error status = VL53LX_ERROR_NONE;
+
+	VL53LX_LLDriverData_t *pdev =
+			VL53LXDevStructGetLLDriverHandle(Dev);
+
+	VL53LX_hist_post_process_config_t *pHP = &(pdev->histpostprocess);
+	VL53LX_xtalk_config_t *pC = &(pdev->xtalk_cfg);
+	VL53LX_histogram_bin_data_t *pHD = &(pdev->hist_data);
+	VL53LX_customer_nvm_managed_t *pN = &(pdev->customer);
+	VL53LX_xtalk_calibration_results_t *pXCR = &(pdev->xtalk_cal);
+	uint8_t tmp8;
+	uint8_t histo_merge_nb, idx;
+	VL53LX_PROFILE_DECLARE(stage_start);
+
+	LOG_FUNCTION_START("");
+
+	VL53LX_compute_histo_merge_nb(Dev, &histo_merge_nb);
+	if (histo_merge_nb == 0)
+		histo_merge_nb = 1;
+	idx = histo_merge_nb - 1;
+	if (pdev->tuning_parms.tp_hist_merge == 1)
+		pC->algo__crosstalk_compensation_plane_offset_kcps =
+			pXCR->algo__xtalk_cpo_HistoMerge_kcps[idx];
+
+	pHP->gain_factor =
+		pdev->gain_cal.histogram_ranging_gain_factor;
+
+	pHP->algo__crosstalk_compensation_plane_offset_kcps =
+	VL53LX_calc_crosstalk_plane_offset_with_margin(
+	pC->algo__crosstalk_compensation_plane_offset_kcps,
+	pC->histogram_mode_crosstalk_margin_kcps);
+
+	pHP->algo__crosstalk_compensation_x_plane_gradient_kcps =
+	pC->algo__crosstalk_compensation_x_plane_gradient_kcps;
+	pHP->algo__crosstalk_compensation_y_plane_gradient_kcps =
+	pC->algo__crosstalk_compensation_y_plane_gradient_kcps;
+
+	pdev->dmax_cfg.ambient_thresh_sigma =
+		pHP->ambient_thresh_sigma1;
+	pdev->dmax_cfg.min_ambient_thresh_events =
+		pHP->min_ambient_thresh_events;
+	pdev->dmax_cfg.signal_total_events_limit =
+		pHP->signal_total_events_limit;
+	pdev->dmax_cfg.dss_config__target_total_rate_mcps =
+		pdev->stat_cfg.dss_config__target_total_rate_mcps;
+	pdev->dmax_cfg.dss_config__aperture_attenuation =
+		pdev->gen_cfg.dss_config__aperture_attenuation;
+
+	pHP->algo__crosstalk_detect_max_valid_range_mm =
+		pC->algo__crosstalk_detect_max_valid_range_mm;
+	pHP->algo__crosstalk_detect_min_valid_range_mm =
+		pC->algo__crosstalk_detect_min_valid_range_mm;
+	pHP->algo__crosstalk_detect_max_valid_rate_kcps =
+		pC->algo__crosstalk_detect_max_valid_rate_kcps;
+	pHP->algo__crosstalk_detect_max_sigma_mm =
+		pC->algo__crosstalk_detect_max_sigma_mm;
+
+
+
+	VL53LX_copy_rtn_good_spads_to_buffer(
+			&(pdev->nvm_copy_data),
+			&(pdev->rtn_good_spads[0]));
+
+
+
+	VL53LX_PROFILE_START(stage_start);
+	switch (pdev->offset_correction_mode) {
+
+	case VL53LX_OFFSETCORRECTIONMODE__MM1_MM2_OFFSETS:
+		tmp8 = pdev->gen_cfg.dss_config__aperture_attenuation;
+
+		VL53LX_hist_combine_mm1_mm2_offsets(
+		pN->mm_config__inner_offset_mm,
+		pN->mm_config__outer_offset_mm,
+		pdev->nvm_copy_data.roi_config__mode_roi_centre_spad,
+		pdev->nvm_copy_data.roi_config__mode_roi_xy_size,
+		pHD->roi_config__user_roi_centre_spad,
+		pHD->roi_config__user_roi_requested_global_xy_size,
+		&(pdev->add_off_cal_data),
+		&(pdev->rtn_good_spads[0]),
+		(uint16_t)tmp8,
+		&(pHP->range_offset_mm));
+	break;
+	case VL53LX_OFFSETCORRECTIONMODE__PER_VCSEL_OFFSETS:
+		select_offset_per_vcsel(
+		pdev,
+		&(pHP->range_offset_mm));
+		pHP->range_offset_mm *= 4;
+	break;
+	default:
+		pHP->range_offset_mm = 0;
+	break;
+
+	}
+	VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_OFFSET_SELECT, stage_start);
+
+	*phisto_merge_nb = histo_merge_nb;
+
+	LOG_FUNCTION_END(status);
+
+	return status;
+}
+
+
 VL53LX_Error VL53LX_get_device_results(
 	VL53LX_DEV                    Dev,
 	VL53LX_DeviceResultsLevel     device_results_level,
@@ -2087,21 +2195,22 @@ VL53LX_Error VL53LX_get_device_results(
 
 	VL53LX_dmax_calibration_data_t   dmax_cal;
 	VL53LX_dmax_calibration_data_t *pdmax_cal = &dmax_cal;
-	VL53LX_hist_post_process_config_t *pHP = &(pdev->histpostprocess);
 	VL53LX_xtalk_config_t *pC = &(pdev->xtalk_cfg);
 	VL53LX_low_power_auto_data_t *pL = &(pdev->low_power_auto_data);
 	VL53LX_histogram_bin_data_t *pHD = &(pdev->hist_data);
-	VL53LX_customer_nvm_managed_t *pN = &(pdev->customer);
 	VL53LX_zone_histograms_t *pZH = &(pres->zone_hists);
 	VL53LX_xtalk_calibration_results_t *pXCR = &(pdev->xtalk_cal);
-	uint8_t tmp8;
 	uint8_t zid;
 	uint8_t i;
-	uint8_t histo_merge_nb, idx;
+	uint8_t histo_merge_nb;
 	VL53LX_range_data_t *pdata;
+	VL53LX_PROFILE_DECLARE(results_start);
+	VL53LX_PROFILE_DECLARE(stage_start);
 
 	LOG_FUNCTION_START("");
 
+	VL53LX_PROFILE_START(results_start);
+
 
 	if ((pdev->sys_ctrl.system__mode_start &
 		 VL53LX_DEVICESCHEDULERMODE_HISTOGRAM)
@@ -2128,83 +2237,9 @@ VL53LX_Error VL53LX_get_device_results(
 		if (status != VL53LX_ERROR_NONE)
 			goto UPDATE_DYNAMIC_CONFIG;
 
-		VL53LX_compute_histo_merge_nb(Dev, &histo_merge_nb);
-		if (histo_merge_nb == 0)
-			histo_merge_nb = 1;
-		idx = histo_merge_nb - 1;
-		if (pdev->tuning_parms.tp_hist_merge == 1)
-			pC->algo__crosstalk_compensation_plane_offset_kcps =
-				pXCR->algo__xtalk_cpo_HistoMerge_kcps[idx];
-
-		pHP->gain_factor =
-			pdev->gain_cal.histogram_ranging_gain_factor;
-
-		pHP->algo__crosstalk_compensation_plane_offset_kcps =
-		VL53LX_calc_crosstalk_plane_offset_with_margin(
-		pC->algo__crosstalk_compensation_plane_offset_kcps,
-		pC->histogram_mode_crosstalk_margin_kcps);
-
-		pHP->algo__crosstalk_compensation_x_plane_gradient_kcps =
-		pC->algo__crosstalk_compensation_x_plane_gradient_kcps;
-		pHP->algo__crosstalk_compensation_y_plane_gradient_kcps =
-		pC->algo__crosstalk_compensation_y_plane_gradient_kcps;
-
-		pdev->dmax_cfg.ambient_thresh_sigma =
-			pHP->ambient_thresh_sigma1;
-		pdev->dmax_cfg.min_ambient_thresh_events =
-			pHP->min_ambient_thresh_events;
-		pdev->dmax_cfg.signal_total_events_limit =
-			pHP->signal_total_events_limit;
-		pdev->dmax_cfg.dss_config__target_total_rate_mcps =
-			pdev->stat_cfg.dss_config__target_total_rate_mcps;
-		pdev->dmax_cfg.dss_config__aperture_attenuation =
-			pdev->gen_cfg.dss_config__aperture_attenuation;
-
-		pHP->algo__crosstalk_detect_max_valid_range_mm =
-			pC->algo__crosstalk_detect_max_valid_range_mm;
-		pHP->algo__crosstalk_detect_min_valid_range_mm =
-			pC->algo__crosstalk_detect_min_valid_range_mm;
-		pHP->algo__crosstalk_detect_max_valid_rate_kcps =
-			pC->algo__crosstalk_detect_max_valid_rate_kcps;
-		pHP->algo__crosstalk_detect_max_sigma_mm =
-			pC->algo__crosstalk_detect_max_sigma_mm;
-
-
-
-		VL53LX_copy_rtn_good_spads_to_buffer(
-				&(pdev->nvm_copy_data),
-				&(pdev->rtn_good_spads[0]));
-
-
-
-		switch (pdev->offset_correction_mode) {
-
-		case VL53LX_OFFSETCORRECTIONMODE__MM1_MM2_OFFSETS:
-			tmp8 = pdev->gen_cfg.dss_config__aperture_attenuation;
-
-			VL53LX_hist_combine_mm1_mm2_offsets(
-			pN->mm_config__inner_offset_mm,
-			pN->mm_config__outer_offset_mm,
-			pdev->nvm_copy_data.roi_config__mode_roi_centre_spad,
-			pdev->nvm_copy_data.roi_config__mode_roi_xy_size,
-			pHD->roi_config__user_roi_centre_spad,
-			pHD->roi_config__user_roi_requested_global_xy_size,
-			&(pdev->add_off_cal_data),
-			&(pdev->rtn_good_spads[0]),
-			(uint16_t)tmp8,
-			&(pHP->range_offset_mm));
-		break;
-		case VL53LX_OFFSETCORRECTIONMODE__PER_VCSEL_OFFSETS:
-			select_offset_per_vcsel(
-			pdev,
-			&(pHP->range_offset_mm));
-			pHP->range_offset_mm *= 4;
-		break;
-		default:
-			pHP->range_offset_mm = 0;
-		break;
-
-		}
+		status = VL53LX_update_hist_post_process_config(
+				Dev,
+				&histo_merge_nb);
 
 
 
@@ -2229,6 +2264,7 @@ VL53LX_Error VL53LX_get_device_results(
 		if (status != VL53LX_ERROR_NONE)
 			goto UPDATE_DYNAMIC_CONFIG;
 
+		VL53LX_PROFILE_START(stage_start);
 		status = VL53LX_ipp_hist_process_data(
 				Dev,
 				pdmax_cal,
@@ -2240,6 +2276,7 @@ VL53LX_Error VL53LX_get_device_results(
 				pdev->wArea2,
 				&histo_merge_nb,
 				presults);
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_HIST_PROCESS, stage_start);
 
 		if ((pdev->tuning_parms.tp_hist_merge == 1) &&
 			(histo_merge_nb > 1))
@@ -2258,32 +2295,38 @@ VL53LX_Error VL53LX_get_device_results(
 		if (status != VL53LX_ERROR_NONE)
 			goto UPDATE_DYNAMIC_CONFIG;
 
+		VL53LX_PROFILE_START(stage_start);
 		status = VL53LX_hist_wrap_dmax(
 				&(pdev->histpostprocess),
 				&(pdev->hist_data),
 				&(presults->wrap_dmax_mm));
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_WRAP_DMAX, stage_start);
 
 
 		if (status != VL53LX_ERROR_NONE)
 			goto UPDATE_DYNAMIC_CONFIG;
 
 		zid = pdev->ll_state.rd_zone_id;
+		VL53LX_PROFILE_START(stage_start);
 		status = VL53LX_hist_phase_consistency_check(
 			Dev,
 			&(pZH->VL53LX_p_003[zid]),
 			&(pres->zone_results.VL53LX_p_003[zid]),
 			presults);
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_PHASE_CHECK, stage_start);
 
 
 		if (status != VL53LX_ERROR_NONE)
 			goto UPDATE_DYNAMIC_CONFIG;
 
 		zid = pdev->ll_state.rd_zone_id;
+		VL53LX_PROFILE_START(stage_start);
 		status = VL53LX_hist_xmonitor_consistency_check(
 			Dev,
 			&(pZH->VL53LX_p_003[zid]),
 			&(pres->zone_results.VL53LX_p_003[zid]),
 			&(presults->xmonitor));
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_XMONITOR_CHECK, stage_start);
 
 
 		if (status != VL53LX_ERROR_NONE)
@@ -2359,8 +2402,12 @@ UPDATE_DYNAMIC_CONFIG:
 
 
 
-		if (status == VL53LX_ERROR_NONE)
+		if (status == VL53LX_ERROR_NONE) {
+			VL53LX_PROFILE_START(stage_start);
 			status = VL53LX_dynamic_xtalk_correction_corrector(Dev);
+			VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_XTALK_CORRECTION,
+				stage_start);
+		}
 
 #ifdef VL53LX_LOG_ENABLE
 		if (status == VL53LX_ERROR_NONE)
@@ -2485,6 +2532,8 @@ UPDATE_DYNAMIC_CONFIG:
 			VL53LX_TRACE_MODULE_RANGE_RESULTS_DATA);
 #endif
 
+	VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_DEVICE_RESULTS, results_start);
+
 	LOG_FUNCTION_END(status);
 
 	return status;
@@ -2556,17 +2605,21 @@ VL53LX_Error VL53LX_get_histogram_bin_data(
 	uint8_t    i                        = 0;
 
 	int32_t    hist_merge				= 0;
+	VL53LX_PROFILE_DECLARE(stage_start);
 
 	LOG_FUNCTION_START("");
 
 
 
-	if (status == VL53LX_ERROR_NONE)
+	if (status == VL53LX_ERROR_NONE) {
+		VL53LX_PROFILE_START(stage_start);
 		status = VL53LX_ReadMulti(
 			Dev,
 			VL53LX_HISTOGRAM_BIN_DATA_I2C_INDEX,
 			pbuffer,
 			VL53LX_HISTOGRAM_BIN_DATA_I2C_SIZE_BYTES);
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_HISTOGRAM_READ, stage_start);
+	}
 
 
 
@@ -2646,8 +2699,11 @@ VL53LX_Error VL53LX_get_histogram_bin_data(
 		pdev->pos_before_next_recom = 0;
 	}
 
-	if (hist_merge == 1)
+	if (hist_merge == 1) {
+		VL53LX_PROFILE_START(stage_start);
 		vl53lx_histo_merge(Dev, pdata);
+		VL53LX_PROFILE_END(Dev, VL53LX_PROFILE_HISTO_MERGE, stage_start);
+	}
 
 
 	pdata->zone_id                 = pdev->ll_state.rd_zone_id;
@@ -0,0 +1,206 @@
+#ifndef _VL53LX_PLATFORM_BATCH_H_
+#define _VL53LX_PLATFORM_BATCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "vl53lx_def.h"
+#include "vl53lx_hist_structs.h"
+#include "vl53lx_dmax_structs.h"
+#include "vl53lx_platform_user_data.h"
+#include "vl53lx_platform_raw.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_batch.h
+ *
+ * @brief  Offline reprocessing of raw histograms on every core
+ *
+ * Raw histograms (see vl53lx_platform_raw.h) are stored in a batch file
+ * together with the processing context of the sensor they came from: dmax
+ * calibration and configuration, post processing configuration and
+ * crosstalk shape. Each frame keeps the inputs its range set, see
+ * VL53LX_RawInputs_t. VL53LX_batch_process() then runs
+ * VL53LX_hist_process_data() over all the frames, one thread per core,
+ * each with its own wArea1/wArea2 scratch space and copy of the context,
+ * so post processing parameters can be tuned on recorded data far faster
+ * than real time.
+ *
+ * A batch file is the 8 byte magic "VL53LXHB", then uint32_t version,
+ * context size and frame size and a reserved uint32_t, followed by the
+ * VL53LX_BatchContext_t padded to a multiple of 8 bytes and the
+ * VL53LX_BatchFrame_t records. Structures are stored as laid out in
+ * memory, a file is read back on hosts with the same structure sizes.
+ */
+
+#define VL53LX_BATCH_MAGIC              "VL53LXHB"
+#define VL53LX_BATCH_VERSION            3
+#define VL53LX_BATCH_FILE_HEADER_SIZE   24
+
+#define VL53LX_BATCH_WORK_AREA1_SIZE    1536
+#define VL53LX_BATCH_WORK_AREA2_SIZE    512
+#define VL53LX_BATCH_CHUNK_FRAMES       256
+
+/**
+ * @struct VL53LX_BatchContext_t
+ * @brief  Everything VL53LX_hist_process_data() needs besides the bins
+ */
+typedef struct {
+
+	VL53LX_dmax_calibration_data_t     dmax_cal;
+	/*!< from VL53LX_get_dmax_calibration_data() */
+	VL53LX_hist_gen3_dmax_config_t     dmax_cfg;
+	/*!< dmax configuration */
+	VL53LX_hist_post_process_config_t  post_cfg;
+	/*!< post processing configuration, the one usually tuned */
+	VL53LX_xtalk_histogram_data_t      xtalk_shape;
+	/*!< crosstalk shape */
+	uint8_t                            hist_merge;
+	/*!< tuning parameter tp_hist_merge, rates are divided by the
+	     histo_merge_nb of each frame when set */
+
+} VL53LX_BatchContext_t;
+
+/**
+ * @struct VL53LX_BatchFrame_t
+ * @brief  One raw histogram
+ */
+typedef struct {
+
+	uint64_t  timestamp_ns;
+	/*!< CLOCK_MONOTONIC time data ready was observed */
+	VL53LX_histogram_bin_data_t hist;
+	/*!< as returned by VL53LX_GetRawHistogramData() */
+	VL53LX_RawInputs_t inputs;
+	/*!< as returned by VL53LX_GetRawHistogramInputs() */
+
+} VL53LX_BatchFrame_t;
+
+/**
+ * @struct VL53LX_Batch_t
+ * @brief  A batch file mapped for reading
+ */
+typedef struct {
+
+	VL53LX_BatchContext_t context;
+	/*!< processing context stored in the file */
+	const VL53LX_BatchFrame_t *frames;
+	/*!< frames, mapped read only */
+	uint64_t  count;
+	/*!< number of frames */
+	void     *map;
+	/*!< whole file mapping */
+	size_t    map_size;
+	/*!< size of the mapping */
+
+} VL53LX_Batch_t;
+
+/**
+ * @struct VL53LX_BatchStats_t
+ * @brief  Throughput of one VL53LX_batch_process() run
+ */
+typedef struct {
+
+	uint32_t  threads;
+	/*!< worker threads used */
+	uint64_t  frames;
+	/*!< frames processed */
+	uint64_t  errors;
+	/*!< frames VL53LX_hist_process_data() failed on */
+	double    seconds;
+	/*!< wall clock time */
+	double    fps;
+	/*!< frames per second over all threads */
+	double    fps_per_core;
+	/*!< frames per second of one thread */
+
+} VL53LX_BatchStats_t;
+
+/**
+ * @brief  Receives the results of one frame, from any worker thread
+ */
+typedef void (*VL53LX_BatchHandler_t)(void *user, uint64_t index,
+	const VL53LX_range_results_t *presults);
+
+/**
+ * @brief  Copies the processing context of a device
+ *
+ * The driver derives the context from the calibration data while
+ * processing a range, so at least one range must have gone through
+ * VL53LX_GetMultiRangingData() or VL53LX_GetRawHistogramData() since the
+ * configuration last changed.
+ *
+ * @param[in]   Dev       : device handle
+ * @param[out]  pctx      : context to fill
+ */
+VL53LX_Error VL53LX_GetBatchContext(VL53LX_DEV Dev, VL53LX_BatchContext_t *pctx);
+
+/**
+ * @brief  Creates a batch file and writes its header and context
+ *
+ * @return  the open file to append frames to, NULL on failure
+ */
+FILE *VL53LX_batch_create(const char *path, const VL53LX_BatchContext_t *pctx);
+
+/**
+ * @brief  Appends one frame to a file made by VL53LX_batch_create()
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_batch_append(FILE *fp, uint64_t timestamp_ns, const VL53LX_histogram_bin_data_t *phist,
+	const VL53LX_RawInputs_t *pinputs);
+
+/**
+ * @brief  Maps a batch file for reading
+ *
+ * @return  0 on success, -1 if the file can not be read or was written
+ *          with other structure sizes
+ */
+int VL53LX_batch_map(VL53LX_Batch_t *pb, const char *path);
+
+/**
+ * @brief  Releases a mapping made by VL53LX_batch_map()
+ */
+void VL53LX_batch_unmap(VL53LX_Batch_t *pb);
+
+/**
+ * @brief  Sets one post processing parameter from KEY=VALUE, KEY being the
+ *         VL53LX_hist_post_process_config_t field name
+ *
+ * @return  0 on success, -1 on an unknown key or malformed value
+ */
+int VL53LX_batch_set_param(VL53LX_hist_post_process_config_t *pcfg, const char *key_value);
+
+/**
+ * @brief  Prints the tunable post processing parameters and their values
+ */
+void VL53LX_batch_print_params(FILE *fp, const VL53LX_hist_post_process_config_t *pcfg);
+
+/**
+ * @brief  Runs VL53LX_hist_process_data() over every frame of a batch
+ *
+ * Each frame goes through the same steps as in VL53LX_get_device_results():
+ * VL53LX_hist_process_data(), the division of merged rates and
+ * VL53LX_hist_wrap_dmax(), with the merge count, crosstalk plane offset and
+ * range offset recorded with it. Tuning those two offsets in pctx moves
+ * the recorded ones by as much as pctx differs from pb->context. Frames are handed out to the threads in chunks
+ * of VL53LX_BATCH_CHUNK_FRAMES, handler sees them in no particular order.
+ *
+ * @param  pb       : mapped batch
+ * @param  pctx     : context to process with, pb->context or a tuned copy
+ * @param  threads  : worker threads, 0 for one per online core
+ * @param  handler  : results consumer, may be NULL
+ * @param  user     : passed to handler
+ * @param  pstats   : throughput, may be NULL
+ */
+VL53LX_Error VL53LX_batch_process(const VL53LX_Batch_t *pb, const VL53LX_BatchContext_t *pctx,
+	uint32_t threads, VL53LX_BatchHandler_t handler, void *user, VL53LX_BatchStats_t *pstats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
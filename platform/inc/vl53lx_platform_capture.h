@@ -0,0 +1,115 @@
+#ifndef _VL53LX_PLATFORM_CAPTURE_H_
+#define _VL53LX_PLATFORM_CAPTURE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_capture.h
+ *
+ * @brief  I2C transaction recorder and replay backend
+ *
+ * Selected through the device path given to VL53LX_i2c_init():
+ *
+ *   record:FILE:/dev/i2c-N   talk to the real bus and append every
+ *                            VL53LX_ReadMulti/VL53LX_WriteMulti to FILE
+ *   replay:FILE              answer every transaction from FILE, no bus
+ *
+ * A capture file is the 8 byte magic "VL53LXCP" and a uint32_t version,
+ * followed by one record per transaction. All fields are little-endian:
+ *
+ *   uint64_t timestamp_ns   CLOCK_MONOTONIC when the transaction completed
+ *   uint8_t  op             VL53LX_CAPTURE_OP_READ or VL53LX_CAPTURE_OP_WRITE
+ *   int8_t   status         VL53LX_Error returned by the bus
+ *   uint8_t  address        7-bit slave address of the sensor
+ *   uint16_t index          register index
+ *   uint16_t count          payload length
+ *   uint8_t  payload[count] bytes read or written
+ *
+ * Replay is strictly sequential: the driver only takes decisions on the
+ * values it reads, so the same call sequence is issued as when recording.
+ * Several sensors share one capture of their bus; a replay that addresses
+ * them in another order than the recording diverges on the address.
+ */
+
+#define VL53LX_CAPTURE_MAGIC            "VL53LXCP"
+#define VL53LX_CAPTURE_VERSION          2
+#define VL53LX_CAPTURE_FILE_HEADER_SIZE 12
+#define VL53LX_CAPTURE_RECORD_SIZE      15
+
+#define VL53LX_CAPTURE_OP_READ          'R'
+#define VL53LX_CAPTURE_OP_WRITE         'W'
+
+#define VL53LX_CAPTURE_MAX_OPEN         8
+
+/**
+ * @struct VL53LX_CaptureStats_t
+ * @brief  Replay progress counters
+ */
+typedef struct {
+
+	uint32_t  records;
+	/*!< number of records consumed or appended */
+	uint32_t  payload_mismatches;
+	/*!< replayed writes whose payload differs from the capture */
+
+} VL53LX_CaptureStats_t;
+
+/**
+ * @brief  Opens a capture file for appending records of the bus at fd
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_capture_open_record(const char *path, int fd);
+
+/**
+ * @brief  Maps a capture file for replay
+ *
+ * @return  a descriptor standing in for the bus fd, -1 on failure
+ */
+int VL53LX_capture_open_replay(const char *path);
+
+/**
+ * @brief  Flushes and releases the capture attached to fd, if any
+ */
+void VL53LX_capture_close(int fd);
+
+/**
+ * @brief  Tells whether fd is a replay descriptor
+ */
+int VL53LX_capture_is_replay(int fd);
+
+/**
+ * @brief  Appends a record if fd is being recorded
+ */
+void VL53LX_capture_record(int fd, uint8_t op, int status, uint8_t address,
+	uint16_t index, const uint8_t *data, uint32_t count);
+
+/**
+ * @brief  Consumes the next record of a replay
+ *
+ * Reads get their payload copied into data. The op, address, index and
+ * count must match the capture; any divergence stops the replay with
+ * VL53LX_ERROR_CONTROL_INTERFACE.
+ *
+ * @return  the status recorded with the transaction
+ */
+int VL53LX_capture_replay(int fd, uint8_t op, uint8_t address,
+	uint16_t index, uint8_t *data, uint32_t count);
+
+/**
+ * @brief  Copies the counters of the capture attached to fd
+ *
+ * @return  0 on success, -1 if fd has no capture
+ */
+int VL53LX_capture_get_stats(int fd, VL53LX_CaptureStats_t *pstats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
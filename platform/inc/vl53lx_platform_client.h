@@ -0,0 +1,109 @@
+#ifndef _VL53LX_PLATFORM_CLIENT_H_
+#define _VL53LX_PLATFORM_CLIENT_H_
+
+#include <stdint.h>
+#include <zmq.h>
+#include "vl53lx_platform_wire.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_client.h
+ *
+ * @brief  Subscriber side of the binary frames, for C and Python
+ *
+ * A client subscribes to a publisher running with --format=BINARY and
+ * hands out its frames in batches: VL53LX_client_recv() sleeps in the
+ * kernel until a message arrives or the timeout passes, then copies every
+ * frame already received into arrays of the caller, up to their size. One
+ * call returns many frames at once, a --batch message as much as the
+ * frames of many messages, so the cost of a call is shared by all of them.
+ *
+ * Frames keep their wire layout, the arrays decode with numpy as they are
+ * (python/vl53lx_client.py). A message only partly returned is kept for
+ * the next call, no frame is lost to a short array. Messages that are no
+ * binary frames, like the stats of --format=BINARY, are skipped and
+ * counted.
+ *
+ * The library is also built on its own as bin/libvl53lx_client.so, which
+ * only needs libzmq.
+ *
+ * Usage:
+ *
+ *   VL53LX_client_open(&client, "tcp://raspberrypi:5556");
+ *   VL53LX_client_subscribe(&client, "left/");
+ *   while ((n = VL53LX_client_recv(&client, frames, raws, 64, 100)) >= 0)
+ *       use frames[0] to frames[n - 1]
+ *   VL53LX_client_close(&client);
+ */
+
+/**
+ * @struct VL53LX_Client_t
+ * @brief  Socket and the message being returned
+ */
+typedef struct {
+
+	void     *context;
+	/*!< ZeroMQ context of the socket */
+	void     *socket;
+	/*!< SUB socket */
+	zmq_msg_t message;
+	/*!< payload returned from offset on */
+	uint32_t  offset;
+	/*!< next frame of message */
+	uint32_t  size;
+	/*!< bytes of message, 0 when there is none */
+	uint64_t  frames;
+	/*!< frames returned */
+	uint64_t  messages;
+	/*!< messages received */
+	uint64_t  skipped;
+	/*!< messages or trailing bytes that were no binary frame */
+
+} VL53LX_Client_t;
+
+/**
+ * @brief  Creates the socket and connects it to a publisher
+ *
+ * @param   address  : e.g. tcp://raspberrypi:5556
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_client_open(VL53LX_Client_t *pc, const char *address);
+
+/**
+ * @brief  Subscribes to a topic prefix, "" for every topic, repeat for
+ *         several
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_client_subscribe(VL53LX_Client_t *pc, const char *topic);
+
+/**
+ * @brief  Waits for frames and returns those received
+ *
+ * @param   frames      : at least max_frames frames
+ * @param   raws        : NULL, or at least max_frames. Entry i is set when
+ *                        frames[i] has VL53LX_WIRE_FLAG_RAW
+ * @param   max_frames  : frames to return at most
+ * @param   timeout_ms  : longest wait for the first frame, -1 forever,
+ *                        0 not at all
+ *
+ * @return  number of frames, 0 on timeout or a signal, -1 on error
+ */
+int VL53LX_client_recv(VL53LX_Client_t *pc, VL53LX_WireFrame_t *frames, VL53LX_WireRaw_t *raws,
+                       uint32_t max_frames, int32_t timeout_ms);
+
+/**
+ * @brief  Closes the socket and its context
+ */
+void VL53LX_client_close(VL53LX_Client_t *pc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
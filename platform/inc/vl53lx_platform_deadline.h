@@ -0,0 +1,98 @@
+#ifndef _VL53LX_PLATFORM_DEADLINE_H_
+#define _VL53LX_PLATFORM_DEADLINE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_deadline.h
+ *
+ * @brief  Data ready scheduler for polled acquisition
+ *
+ * Predicts when the next range completes from the last observed data ready
+ * and the ranging period, sleeps with clock_nanosleep(TIMER_ABSTIME) until
+ * a guard interval before that point, then spaces the remaining polls by
+ * VL53LX_DEADLINE_POLL_STEP_US.
+ *
+ * The period starts from the timing budget and is learned online from the
+ * interval between data ready observations. The guard adapts so a frame
+ * takes about VL53LX_DEADLINE_TARGET_POLLS polls: a frame found ready on
+ * the first poll was waiting already and the guard doubles, every extra
+ * poll beyond the target shortens it by one step.
+ *
+ * Usage, around VL53LX_GetMeasurementDataReady():
+ *
+ *   VL53LX_deadline_init(&dl, budget_us);
+ *   for (;;) {
+ *       VL53LX_deadline_wait(&dl);
+ *       VL53LX_GetMeasurementDataReady(Dev, &ready);
+ *       if (ready) {
+ *           VL53LX_deadline_ready(&dl);
+ *           ...
+ *       }
+ *   }
+ */
+
+#define VL53LX_DEADLINE_POLL_STEP_US     250
+#define VL53LX_DEADLINE_TARGET_POLLS     2
+
+/**
+ * @struct VL53LX_Deadline_t
+ * @brief  Scheduler state, all times CLOCK_MONOTONIC
+ */
+typedef struct {
+
+	uint64_t  period_ns;
+	/*!< learned interval between two data ready */
+	uint64_t  guard_ns;
+	/*!< how long before the predicted completion polling starts */
+	uint64_t  last_ready_ns;
+	/*!< when data ready was last observed */
+	uint64_t  next_poll_ns;
+	/*!< absolute time of the next poll, 0 before the first of a frame */
+	uint32_t  frame_polls;
+	/*!< polls issued for the frame in progress */
+	uint32_t  frames;
+	/*!< data ready observations */
+	uint32_t  polls;
+	/*!< polls issued in total */
+
+} VL53LX_Deadline_t;
+
+/**
+ * @brief  Starts scheduling, the first range is expected period_us from now
+ */
+void VL53LX_deadline_init(VL53LX_Deadline_t *pdl, uint32_t period_us);
+
+/**
+ * @brief  Sleeps until the next poll is due
+ */
+void VL53LX_deadline_wait(VL53LX_Deadline_t *pdl);
+
+/**
+ * @brief  Returns the CLOCK_MONOTONIC time in ns of the next poll, for
+ *         callers multiplexing several schedules in one sleep
+ */
+uint64_t VL53LX_deadline_next_ns(const VL53LX_Deadline_t *pdl);
+
+/**
+ * @brief  Accounts for a poll issued without VL53LX_deadline_wait(), at or
+ *         after VL53LX_deadline_next_ns()
+ */
+void VL53LX_deadline_polled(VL53LX_Deadline_t *pdl);
+
+/**
+ * @brief  Records that the last poll found data ready and updates the
+ *         period and guard estimates
+ */
+void VL53LX_deadline_ready(VL53LX_Deadline_t *pdl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _VL53LX_PLATFORM_GPIO_H_
+#define _VL53LX_PLATFORM_GPIO_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_gpio.h
+ *
+ * @brief  GPIO lines through the Linux GPIO character device
+ *
+ * Lines are requested from a /dev/gpiochipN with the v2 uAPI, there is no
+ * export step to wait for. Each request returns a line descriptor owned by
+ * the caller and held until released; for inputs it is also the edge event
+ * descriptor, readable whenever an edge is queued, so it can be added to
+ * any poll()/epoll() based event loop.
+ */
+
+#define VL53LX_GPIO_DEFAULT_CHIP    "/dev/gpiochip0"
+#define VL53LX_GPIO_CONSUMER        "vl53lx"
+
+#define VL53LX_GPIO_EDGE_RISING     0x01
+#define VL53LX_GPIO_EDGE_FALLING    0x02
+
+/**
+ * @brief  Requests line as an input reporting the given edges
+ *
+ * @param  chip  : gpiochip device path
+ * @param  line  : line offset on the chip
+ * @param  edges : VL53LX_GPIO_EDGE_RISING and/or VL53LX_GPIO_EDGE_FALLING
+ *
+ * @return  the line descriptor, -1 on failure
+ */
+int VL53LX_gpio_request_input(const char *chip, uint32_t line, uint8_t edges);
+
+/**
+ * @brief  Requests line as an output driven to value
+ *
+ * @return  the line descriptor, -1 on failure
+ */
+int VL53LX_gpio_request_output(const char *chip, uint32_t line, uint8_t value);
+
+/**
+ * @brief  Drives an output line
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_gpio_set_value(int fd, uint8_t value);
+
+/**
+ * @brief  Waits up to timeout_ms for edges on an input line and consumes
+ *         all the queued ones
+ *
+ * @param  timeout_ms : -1 waits forever, 0 only checks
+ *
+ * @return  the number of edges consumed, 0 on timeout, -1 on failure
+ */
+int VL53LX_gpio_wait_edge(int fd, int32_t timeout_ms);
+
+/**
+ * @brief  Releases a line obtained from VL53LX_gpio_request_input() or
+ *         VL53LX_gpio_request_output()
+ */
+void VL53LX_gpio_release(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
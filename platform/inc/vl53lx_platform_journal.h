@@ -0,0 +1,249 @@
+#ifndef _VL53LX_PLATFORM_JOURNAL_H_
+#define _VL53LX_PLATFORM_JOURNAL_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "vl53lx_def.h"
+#include "vl53lx_platform_multi.h"
+#include "vl53lx_platform_ring.h"
+#include "vl53lx_platform_wire.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_journal.h
+ *
+ * @brief  Append only log of binary frames in memory mapped segment files
+ *
+ * Frames are recorded for hours in the binary wire format, which carries
+ * the monotonic timestamp and sensor id of each frame, into segment files
+ * PATH.0000, PATH.0001 and on. Each segment is preallocated to its full
+ * size, mapped and filled with plain stores. The next frame that does not
+ * fit rotates to a new segment, a finished one is truncated to what it
+ * holds.
+ *
+ * VL53LX_journal_append() only encodes the frame into a queue, its own thread
+ * writes the segments, so page faults, disk writeback and rotation never
+ * hold up the caller. A full queue drops its oldest frame and counts it.
+ *
+ * A segment starts with a VL53LX_JournalHeader_t, the VL53LX_JournalSensor_t
+ * configuration of every sensor (preset, distance mode, timing budget and
+ * calibration) and a sparse index, then the frames. The index gets an
+ * entry for the first frame past every VL53LX_JOURNAL_INDEX_STRIDE bytes, so
+ * VL53LX_journal_seek() finds a time with a binary search and a short scan.
+ * The header tells how many bytes of frames are complete, a reader of a
+ * segment still written or left by a crash stops there. Structures are
+ * stored as laid out in memory, like batch files.
+ *
+ * Usage:
+ *
+ *   VL53LX_journal_add_sensor(&journal, id, &sensor) for every sensor
+ *   VL53LX_journal_start(&journal, path, segment_size);
+ *   VL53LX_journal_append(&journal, &frame, id) for every frame
+ *   VL53LX_journal_stop(&journal);
+ */
+
+#define VL53LX_JOURNAL_MAGIC                "VL53LXJL"
+#define VL53LX_JOURNAL_VERSION              1
+#define VL53LX_JOURNAL_INDEX_STRIDE         16384
+#define VL53LX_JOURNAL_QUEUE_FRAMES         4096
+#define VL53LX_JOURNAL_MAX_SENSORS          32
+#define VL53LX_JOURNAL_MIN_SEGMENT_SIZE     (1 << 20)
+
+/**
+ * @struct VL53LX_JournalSensor_t
+ * @brief  Configuration of one sensor, as it ranged when the log started
+ */
+typedef struct {
+
+	char      name[VL53LX_MULTI_NAME_SIZE];
+	/*!< --sensor name */
+	uint8_t   sensor_id;
+	/*!< sensor_id of its frames */
+	uint8_t   address;
+	/*!< 7 bit I2C address */
+	uint8_t   raw;
+	/*!< frames are raw histograms */
+	uint8_t   preset_mode;
+	/*!< VL53LX_DevicePresetModes */
+	uint8_t   distance_mode;
+	/*!< VL53LX_DistanceModes */
+	uint8_t   reserved[3];
+	/*!< 0 */
+	uint32_t  timing_budget_us;
+	/*!< VL53LX_GetMeasurementTimingBudgetMicroSeconds() */
+	VL53LX_CalibrationData_t calibration;
+	/*!< VL53LX_GetCalibrationData() */
+
+} VL53LX_JournalSensor_t;
+
+/**
+ * @struct VL53LX_JournalIndex_t
+ * @brief  Index entry
+ */
+typedef struct {
+
+	uint64_t  timestamp_ns;
+	/*!< latest timestamp up to and including the frame, timestamps of
+	     different buses interleave by up to a queue */
+	uint64_t  offset;
+	/*!< of the frame from the start of the segment */
+
+} VL53LX_JournalIndex_t;
+
+/**
+ * @struct VL53LX_JournalHeader_t
+ * @brief  Start of every segment
+ */
+typedef struct {
+
+	char      magic[8];
+	/*!< VL53LX_JOURNAL_MAGIC, not NUL terminated */
+	uint32_t  version;
+	/*!< VL53LX_JOURNAL_VERSION */
+	uint32_t  segment;
+	/*!< number of the segment, from 0 */
+	uint32_t  sensor_count;
+	/*!< VL53LX_JournalSensor_t records after the header */
+	uint32_t  index_capacity;
+	/*!< VL53LX_JournalIndex_t entries after the sensors */
+	uint64_t  data_offset;
+	/*!< offset of the first frame, page aligned */
+	uint64_t  segment_size;
+	/*!< preallocated bytes */
+	uint64_t  start_ns;
+	/*!< CLOCK_MONOTONIC time the log started, same in every segment */
+	uint64_t  start_realtime_ns;
+	/*!< CLOCK_REALTIME at start_ns */
+	atomic_uint_fast64_t used;
+	/*!< bytes of complete frames after data_offset */
+	atomic_uint index_count;
+	/*!< valid index entries */
+	uint32_t  reserved;
+	/*!< 0 */
+
+} VL53LX_JournalHeader_t;
+
+/**
+ * @struct VL53LX_Journal_t
+ * @brief  Writer state
+ */
+typedef struct {
+
+	char      path[4096];
+	/*!< segment files are path.NNNN */
+	uint64_t  segment_size;
+	/*!< bytes per segment */
+	uint64_t  start_ns;
+	/*!< see VL53LX_JournalHeader_t */
+	uint64_t  start_realtime_ns;
+	/*!< see VL53LX_JournalHeader_t */
+	VL53LX_JournalSensor_t sensor[VL53LX_JOURNAL_MAX_SENSORS];
+	/*!< written to every segment */
+	uint32_t  sensor_count;
+	/*!< valid entries of sensor */
+	VL53LX_Ring_t queue;
+	/*!< encoded frames on their way to the thread */
+	pthread_t thread;
+	/*!< writes the segments */
+	volatile int running;
+	/*!< cleared to stop the thread */
+	uint8_t  *map;
+	/*!< current segment, NULL before the first frame or after an error */
+	int       fd;
+	/*!< current segment file */
+	uint32_t  segment;
+	/*!< number of the current segment */
+	uint64_t  next_index;
+	/*!< offset past which the next index entry is due */
+	uint64_t  latest_ns;
+	/*!< latest timestamp written */
+	uint64_t  frames;
+	/*!< frames written */
+	uint32_t  errors;
+	/*!< frames lost since a segment could not be created, which ends
+	     the journal */
+
+} VL53LX_Journal_t;
+
+/**
+ * @brief  Stores the configuration of a sensor, before VL53LX_journal_start()
+ */
+VL53LX_Error VL53LX_journal_add_sensor(VL53LX_Journal_t *pl, uint8_t sensor_id, VL53LX_Sensor_t *ps);
+
+/**
+ * @brief  Starts the writer thread, the first segment is created with it
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_journal_start(VL53LX_Journal_t *pl, const char *path, uint64_t segment_size);
+
+/**
+ * @brief  Queues a frame, never blocks
+ */
+void VL53LX_journal_append(VL53LX_Journal_t *pl, const VL53LX_Frame_t *pframe, uint8_t sensor_id);
+
+/**
+ * @brief  Writes the queued frames, stops the thread and truncates the
+ *         last segment
+ */
+void VL53LX_journal_stop(VL53LX_Journal_t *pl);
+
+/**
+ * @brief  Returns the frames dropped because the queue was full
+ */
+uint32_t VL53LX_journal_dropped(VL53LX_Journal_t *pl);
+
+/**
+ * @struct VL53LX_JournalSegment_t
+ * @brief  Segment mapped for reading
+ */
+typedef struct {
+
+	const uint8_t *base;
+	/*!< start of the file */
+	size_t    size;
+	/*!< bytes mapped */
+	const VL53LX_JournalHeader_t *header;
+	/*!< base */
+	const VL53LX_JournalSensor_t *sensor;
+	/*!< header->sensor_count entries */
+	const VL53LX_JournalIndex_t *index;
+	/*!< header->index_count entries */
+
+} VL53LX_JournalSegment_t;
+
+/**
+ * @brief  Maps a segment for reading
+ *
+ * @return  0 on success, -1 on failure or when it is no journal segment
+ */
+int VL53LX_journal_map(const char *path, VL53LX_JournalSegment_t *pseg);
+
+/**
+ * @brief  Unmaps a segment
+ */
+void VL53LX_journal_unmap(VL53LX_JournalSegment_t *pseg);
+
+/**
+ * @brief  Returns the offset of the first frame at or after timestamp_ns,
+ *         the end of the frames if there is none
+ */
+uint64_t VL53LX_journal_seek(const VL53LX_JournalSegment_t *pseg, uint64_t timestamp_ns);
+
+/**
+ * @brief  Returns the frame at *poffset and moves *poffset to the next
+ *
+ * @return  the frame, NULL at the end of the frames
+ */
+const VL53LX_WireFrame_t *VL53LX_journal_next(const VL53LX_JournalSegment_t *pseg, uint64_t *poffset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef _VL53LX_PLATFORM_METRICS_H_
+#define _VL53LX_PLATFORM_METRICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vl53lx_platform_user_data.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_metrics.h
+ *
+ * @brief  Counters served as text in the Prometheus exposition format
+ *
+ * A plain HTTP endpoint that Prometheus scrapes, or anyone reads with
+ * curl. Every socket is non-blocking and polled by the thread that owns
+ * them next to its other work, which never waits on a client: the request
+ * and the reply move on as far as the socket allows each time it is
+ * ready. Once a request is in, the thread builds the text with the helpers
+ * below. Connections are served one at a time, the next ones wait in the
+ * listen backlog. Nothing runs in between scrapes.
+ *
+ * The thread that answers only reads counters kept by the others, the
+ * acquisition threads never wait for it. A client that has not completed
+ * its exchange after VL53LX_METRICS_TIMEOUT_MS is dropped.
+ *
+ * Usage:
+ *
+ *   VL53LX_metrics_open(&metrics, "127.0.0.1:9100");
+ *   poll VL53LX_metrics_fd() with the other descriptors, for writing while
+ *   VL53LX_metrics_sending(), then whether it was ready or not
+ *   if (VL53LX_metrics_serve(&metrics, ready, now_ns)) {
+ *       VL53LX_metrics_family(&metrics, "frames_total", "counter", "Frames");
+ *       VL53LX_metrics_sample(&metrics, "frames_total", labels, frames);
+ *       VL53LX_metrics_reply(&metrics);
+ *   }
+ */
+
+#define VL53LX_METRICS_DEFAULT_HOST     "127.0.0.1"
+#define VL53LX_METRICS_TIMEOUT_MS       1000
+#define VL53LX_METRICS_REQUEST_SIZE     2048
+#define VL53LX_METRICS_INITIAL_SIZE     65536
+
+/**
+ * @struct VL53LX_Metrics_t
+ * @brief  Listening socket, the connection served and its reply
+ */
+typedef struct {
+
+	int       fd;
+	/*!< listening socket, -1 when closed */
+	int       conn;
+	/*!< connection being served, -1 for none */
+	uint8_t   sending;
+	/*!< the reply to conn is on its way */
+	uint64_t  deadline_ns;
+	/*!< CLOCK_MONOTONIC time conn is dropped at */
+	char      request[VL53LX_METRICS_REQUEST_SIZE];
+	/*!< what conn sent so far */
+	uint32_t  request_len;
+	/*!< bytes of request used */
+	char      header[256];
+	/*!< HTTP header of the reply */
+	uint32_t  header_len;
+	/*!< bytes of header used */
+	uint32_t  sent;
+	/*!< bytes of header and text sent */
+	char     *text;
+	/*!< exposition of the current request */
+	uint32_t  len;
+	/*!< bytes of text used */
+	uint32_t  size;
+	/*!< bytes of text allocated */
+	uint32_t  scrapes;
+	/*!< requests answered */
+
+} VL53LX_Metrics_t;
+
+/**
+ * @brief  Listens on [HOST:]PORT, HOST is VL53LX_METRICS_DEFAULT_HOST
+ *         when left out and * for every interface
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_metrics_open(VL53LX_Metrics_t *pm, const char *address);
+
+/**
+ * @brief  Closes the socket and frees the text
+ */
+void VL53LX_metrics_close(VL53LX_Metrics_t *pm);
+
+/**
+ * @brief  Descriptor to poll, the connection being served or else the
+ *         listening socket
+ */
+int VL53LX_metrics_fd(const VL53LX_Metrics_t *pm);
+
+/**
+ * @brief  Tells whether VL53LX_metrics_fd() is polled for writing rather
+ *         than reading
+ */
+int VL53LX_metrics_sending(const VL53LX_Metrics_t *pm);
+
+/**
+ * @brief  Moves the connection on, without blocking
+ *
+ * Takes a pending connection, reads what arrived of its request or sends
+ * more of its reply. Requests other than GET are answered with an error
+ * here. Called on every wake up, it also drops the connection once its
+ * time is up.
+ *
+ * @param   ready   : VL53LX_metrics_fd() polled ready, else only the
+ *                    deadline is checked
+ * @param   now_ns  : CLOCK_MONOTONIC time
+ *
+ * @return  1 when a request is in and its reply is to be built, 0 else
+ */
+int VL53LX_metrics_serve(VL53LX_Metrics_t *pm, int ready, uint64_t now_ns);
+
+/**
+ * @brief  Starts a metric, its samples follow
+ *
+ * @param   name  : without the vl53lx_ prefix, added to every name
+ * @param   type  : counter, gauge or histogram
+ */
+void VL53LX_metrics_family(VL53LX_Metrics_t *pm, const char *name, const char *type,
+	const char *help);
+
+/**
+ * @brief  Adds a sample of the current metric
+ *
+ * @param   labels  : from VL53LX_metrics_label(), "" for none
+ */
+void VL53LX_metrics_sample(VL53LX_Metrics_t *pm, const char *name, const char *labels,
+	double value);
+
+/**
+ * @brief  Adds the buckets, sum and count of a stage, in seconds
+ */
+void VL53LX_metrics_histogram(VL53LX_Metrics_t *pm, const char *name, const char *labels,
+	const VL53LX_ProfileStage_t *pst);
+
+/**
+ * @brief  Appends name="value" to labels, escaped and comma separated
+ *
+ * @return  0 on success, -1 when labels is too small
+ */
+int VL53LX_metrics_label(char *labels, size_t size, const char *name, const char *value);
+
+/**
+ * @brief  Starts sending the text built since VL53LX_metrics_serve()
+ *         returned 1, the connection is closed once it is all sent
+ */
+void VL53LX_metrics_reply(VL53LX_Metrics_t *pm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef _VL53LX_PLATFORM_MULTI_H_
+#define _VL53LX_PLATFORM_MULTI_H_
+
+#include <stdint.h>
+#include "vl53lx_platform.h"
+#include "vl53lx_platform_deadline.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_multi.h
+ *
+ * @brief  Several sensors sharing one I2C bus
+ *
+ * Every sensor boots at address 0x29. VL53LX_multi_init() holds all the
+ * sensors in reset with VL53LX_PowerOff(), then powers them up one at a
+ * time with VL53LX_PowerOn(), moves each to its own address and
+ * initialises it. One sensor may have neither an XSHUT nor a power line,
+ * it is addressed first while the others are held.
+ *
+ * All the sensors of a real bus share one descriptor, every transfer
+ * carries the address of its device. On a sim: bus each sensor gets its own
+ * model and XSHUT lines are ignored, as they are when replaying.
+ *
+ * A sensor is described on the command line as NAME[:KEY=VALUE,...]:
+ *
+ *   xshut=N       gpiochip line wired to XSHUT, -1 (default) if not wired
+ *   power=N       gpiochip line enabling the sensor supply, -1 (default) if
+ *                 not wired
+ *   address=0xNN  7 bit address, assigned from VL53LX_MULTI_BASE_ADDRESS
+ *                 when omitted, 0x29 kept for a lone sensor
+ *   irq=N         gpiochip line wired to GPIO1, -1 (default) to poll
+ *   raw=0|1       read raw histograms only, see vl53lx_platform_raw.h
+ */
+
+#define VL53LX_MULTI_MAX_SENSORS        8
+#define VL53LX_MULTI_BASE_ADDRESS       0x30
+#define VL53LX_MULTI_NAME_SIZE          16
+
+/**
+ * @struct VL53LX_SensorConfig_t
+ * @brief  Wiring and address of one sensor
+ */
+typedef struct {
+
+	char      name[VL53LX_MULTI_NAME_SIZE];
+	/*!< identifies the sensor in published data */
+	int32_t   xshut_line;
+	/*!< gpiochip line wired to XSHUT, -1 if not wired */
+	int32_t   power_line;
+	/*!< gpiochip line enabling the supply, -1 if not wired */
+	int32_t   irq_line;
+	/*!< gpiochip line wired to GPIO1, -1 to poll */
+	uint8_t   address;
+	/*!< 7 bit address, 0 for automatic */
+	uint8_t   shadow;
+	/*!< enable the register shadow from boot on */
+	uint8_t   raw;
+	/*!< read raw histograms, no host side range processing */
+
+} VL53LX_SensorConfig_t;
+
+/**
+ * @struct VL53LX_Sensor_t
+ * @brief  One managed sensor
+ */
+typedef struct {
+
+	VL53LX_SensorConfig_t config;
+	/*!< as given to VL53LX_multi_init() */
+	VL53LX_Dev_t  dev;
+	/*!< driver device, use &dev as the VL53LX_DEV handle */
+	VL53LX_Deadline_t deadline;
+	/*!< data ready schedule when polled */
+	uint64_t      last_ready_ns;
+	/*!< when data ready was last observed */
+	uint64_t      irq_timeout_ns;
+	/*!< data ready is polled anyway after this long without an edge */
+	uint32_t      start_bytes_elided;
+	/*!< bytes the register shadow left out of the latest
+	     VL53LX_StartMeasurement() */
+
+} VL53LX_Sensor_t;
+
+/**
+ * @struct VL53LX_MultiSensor_t
+ * @brief  Sensors of one bus
+ */
+typedef struct {
+
+	uint8_t   count;
+	/*!< number of valid entries in sensor */
+	VL53LX_Sensor_t sensor[VL53LX_MULTI_MAX_SENSORS];
+	/*!< sensors in configuration order */
+	char      gpio_chip[64];
+	/*!< gpiochip of the XSHUT, power enable and GPIO1 lines */
+	int       shared_fd;
+	/*!< bus descriptor shared by all sensors, -1 if each has its own */
+	uint8_t   started;
+	/*!< VL53LX_multi_start() was called */
+
+} VL53LX_MultiSensor_t;
+
+/**
+ * @brief  Fills a sensor config from a NAME[:KEY=VALUE,...] description
+ *
+ * @return  0 on success, -1 on a malformed description
+ */
+int VL53LX_multi_parse_sensor(VL53LX_SensorConfig_t *pconfig, const char *spec);
+
+/**
+ * @brief  Opens the bus, sequences XSHUT and power enable, assigns the addresses and runs
+ *         VL53LX_WaitDeviceBooted() and VL53LX_DataInit() on every sensor
+ *
+ * GPIO1 is enabled for sensors with an irq line.
+ *
+ * @param  pm      : manager to fill
+ * @param  bus     : device path as for VL53LX_i2c_init()
+ * @param  chip    : gpiochip of the XSHUT, power enable and GPIO1 lines
+ * @param  pconfig : count sensor configs
+ *
+ * @return  VL53LX_ERROR_NONE on success, the first failure otherwise with
+ *          the sensors powered down
+ */
+VL53LX_Error VL53LX_multi_init(VL53LX_MultiSensor_t *pm, const char *bus, const char *chip,
+	const VL53LX_SensorConfig_t *pconfig, uint8_t count);
+
+/**
+ * @brief  Starts ranging on all the sensors and seeds their data ready
+ *         schedules from their timing budgets
+ */
+VL53LX_Error VL53LX_multi_start(VL53LX_MultiSensor_t *pm);
+
+/**
+ * @brief  Stops ranging on all the sensors, VL53LX_multi_start() resumes
+ */
+VL53LX_Error VL53LX_multi_stop(VL53LX_MultiSensor_t *pm);
+
+/**
+ * @brief  Waits until at least one sensor may have data ready
+ *
+ * Sensors with a GPIO1 line are due on an edge, or after irq_timeout_ns
+ * without one. The others are due every poll_period_ms, or from their
+ * schedule when poll_period_ms is negative. Sleeps in a single ppoll() on
+ * all the GPIO1 descriptors.
+ *
+ * @return  bit mask of the sensors to check with
+ *          VL53LX_GetMeasurementDataReady(), may be 0
+ */
+uint32_t VL53LX_multi_wait(VL53LX_MultiSensor_t *pm, int32_t poll_period_ms);
+
+/**
+ * @brief  Tells the scheduler the sensor had data ready
+ */
+void VL53LX_multi_ready(VL53LX_MultiSensor_t *pm, uint8_t sensor);
+
+/**
+ * @brief  Stops ranging, powers the sensors down and releases their lines
+ */
+void VL53LX_multi_close(VL53LX_MultiSensor_t *pm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef _VL53LX_PLATFORM_PACK_H_
+#define _VL53LX_PLATFORM_PACK_H_
+
+#include <stdint.h>
+#include "vl53lx_platform_pool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_pack.h
+ *
+ * @brief  Packs the frames of a topic into one message, within a latency
+ *         budget
+ *
+ * At high frame rates every message costs more than the frame it carries,
+ * in the publisher as in subscribers. A packer appends the frames of each
+ * topic to a buffer of its own pool and flushes the buffer once it holds
+ * max_frames frames, once the next frame would not fit, or once the first
+ * frame waited latency_ns, whichever comes first.
+ *
+ * Frames stay separable: text frames are joined by a separator byte they
+ * never contain, binary frames need none since their header tells their
+ * size.
+ *
+ * Usage:
+ *
+ *   VL53LX_pack_init(&pk, 32768, 256, 16, 5000000, flush, user);
+ *   if (VL53LX_pack_add(&pk, topic, data, len, '\n', now) != 0)
+ *       send data on its own
+ *   wait at most VL53LX_pack_deadline(&pk) - now
+ *   VL53LX_pack_expire(&pk, now);
+ */
+
+#define VL53LX_PACK_MAX_TOPICS          256
+#define VL53LX_PACK_TOPIC_SIZE          64
+#define VL53LX_PACK_NO_SEPARATOR        -1
+
+/**
+ * @brief  Called with a full or expired buffer of the pool of the packer,
+ *         to hand on with VL53LX_pool_release() or return with
+ *         VL53LX_pool_put()
+ */
+typedef void (VL53LX_PackFlush_t)(void *user, const char *topic, void *data, uint32_t len);
+
+/**
+ * @struct VL53LX_Pack_t
+ * @brief  Frames of one topic waiting to be flushed
+ */
+typedef struct {
+
+	char      topic[VL53LX_PACK_TOPIC_SIZE];
+	/*!< topic of all the frames */
+	uint8_t  *data;
+	/*!< pool buffer the frames are appended to */
+	uint32_t  len;
+	/*!< bytes used in data */
+	uint32_t  frames;
+	/*!< frames in data */
+	uint64_t  deadline_ns;
+	/*!< flush time, latency_ns after the first frame */
+	int       separator;
+	/*!< byte between frames, VL53LX_PACK_NO_SEPARATOR for none */
+
+} VL53LX_Pack_t;
+
+/**
+ * @struct VL53LX_Packer_t
+ * @brief  Packer state
+ */
+typedef struct {
+
+	VL53LX_Pool_t pool;
+	/*!< buffers of the packs, one per topic in use */
+	VL53LX_Pack_t pack[VL53LX_PACK_MAX_TOPICS];
+	/*!< open packs, the first count are in use */
+	uint32_t  count;
+	/*!< number of open packs */
+	uint32_t  max_frames;
+	/*!< frames flushing a pack */
+	uint64_t  latency_ns;
+	/*!< longest a frame waits in a pack */
+	VL53LX_PackFlush_t *flush;
+	/*!< sends a pack */
+	void     *user;
+	/*!< passed to flush */
+	uint64_t  frames;
+	/*!< frames packed */
+	uint64_t  messages;
+	/*!< packs flushed */
+
+} VL53LX_Packer_t;
+
+/**
+ * @brief  Allocates buffer_count buffers of buffer_size bytes
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_pack_init(VL53LX_Packer_t *pk, uint32_t buffer_size, uint32_t buffer_count,
+	uint32_t max_frames, uint64_t latency_ns, VL53LX_PackFlush_t *flush, void *user);
+
+/**
+ * @brief  Frees the buffers, flushed ones may no longer be referenced
+ */
+void VL53LX_pack_free(VL53LX_Packer_t *pk);
+
+/**
+ * @brief  Appends a frame to the pack of its topic, copying it
+ *
+ * separator is the byte put between the frames of the topic,
+ * VL53LX_PACK_NO_SEPARATOR for none. All frames of a topic use the same.
+ *
+ * @return  0 when packed, -1 when the frame has to be sent on its own: it
+ *          is larger than a buffer, no buffer is free or every topic slot is
+ *          taken
+ */
+int VL53LX_pack_add(VL53LX_Packer_t *pk, const char *topic, const void *data, uint32_t len,
+	int separator, uint64_t now_ns);
+
+/**
+ * @brief  Flushes the packs whose deadline passed
+ */
+void VL53LX_pack_expire(VL53LX_Packer_t *pk, uint64_t now_ns);
+
+/**
+ * @brief  Flushes every pack
+ */
+void VL53LX_pack_flush(VL53LX_Packer_t *pk);
+
+/**
+ * @brief  Returns the earliest deadline of the open packs, 0 when none is
+ *         open
+ */
+uint64_t VL53LX_pack_deadline(VL53LX_Packer_t *pk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
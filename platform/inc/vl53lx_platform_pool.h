@@ -0,0 +1,106 @@
+#ifndef _VL53LX_PLATFORM_POOL_H_
+#define _VL53LX_PLATFORM_POOL_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_pool.h
+ *
+ * @brief  Preallocated, reference counted buffers for zero copy publishing
+ *
+ * Frames are formatted straight into a pool buffer and handed to
+ * zmq_msg_init_data() with VL53LX_pool_release() as free function, so
+ * publishing neither copies nor allocates. ZeroMQ drops its reference from
+ * its I/O thread once every subscriber got the frame, which is why buffers
+ * go back to a lock-free free list instead of a plain array only the
+ * publisher touches.
+ *
+ * Usage:
+ *
+ *   buf = VL53LX_pool_get(&pool);
+ *   fill buf
+ *   zmq_msg_init_data(&msg, buf, len, VL53LX_pool_release, &pool);
+ *   zmq_msg_send(&msg, publisher, 0);
+ */
+
+/**
+ * @struct VL53LX_Pool_t
+ * @brief  Pool state
+ */
+typedef struct {
+
+	uint8_t  *buffers;
+	/*!< count buffers of buffer_size bytes, allocated once */
+	uint32_t  buffer_size;
+	/*!< bytes per buffer, a multiple of 8 */
+	uint32_t  count;
+	/*!< number of buffers */
+	atomic_uint *refs;
+	/*!< reference count of each buffer, 0 when free */
+	uint32_t *next;
+	/*!< free list link of each buffer */
+	atomic_uint_fast64_t free_head;
+	/*!< index of the first free buffer in the low half, a tag bumped on
+	     every change in the high half against ABA */
+	atomic_uint exhausted;
+	/*!< VL53LX_pool_get() calls that found no free buffer */
+
+} VL53LX_Pool_t;
+
+/**
+ * @brief  Allocates count buffers of buffer_size bytes
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_pool_init(VL53LX_Pool_t *pp, uint32_t buffer_size, uint32_t count);
+
+/**
+ * @brief  Frees the buffers, none may still be referenced
+ */
+void VL53LX_pool_free(VL53LX_Pool_t *pp);
+
+/**
+ * @brief  Takes a free buffer with one reference
+ *
+ * @return  the buffer, NULL when all of them are in use
+ */
+void *VL53LX_pool_get(VL53LX_Pool_t *pp);
+
+/**
+ * @brief  Adds a reference, e.g. before handing the buffer to a second
+ *         socket
+ */
+void VL53LX_pool_ref(VL53LX_Pool_t *pp, void *buffer);
+
+/**
+ * @brief  Drops a reference, the last one returns the buffer to the pool
+ */
+void VL53LX_pool_put(VL53LX_Pool_t *pp, void *buffer);
+
+/**
+ * @brief  VL53LX_pool_put() with the signature of zmq_free_fn, hint is the
+ *         pool
+ */
+void VL53LX_pool_release(void *buffer, void *hint);
+
+/**
+ * @brief  Tells whether buffer belongs to the pool
+ */
+int VL53LX_pool_owns(VL53LX_Pool_t *pp, const void *buffer);
+
+/**
+ * @brief  Returns the number of VL53LX_pool_get() calls that failed
+ */
+uint32_t VL53LX_pool_exhausted(VL53LX_Pool_t *pp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef _VL53LX_PLATFORM_RAW_H_
+#define _VL53LX_PLATFORM_RAW_H_
+
+#include "vl53lx_def.h"
+#include "vl53lx_platform_user_data.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_raw.h
+ *
+ * @brief  Histogram capture without host side range processing
+ *
+ * VL53LX_GetMultiRangingData() runs the whole of
+ * VL53LX_get_device_results() on every range: crosstalk correction, the
+ * two pulse extraction passes, dmax and the phase and xmonitor consistency
+ * checks. When only the histograms are wanted, VL53LX_GetRawHistogramData()
+ * reads the histogram result block and nothing else, so the processing can
+ * run later or on another host with VL53LX_hist_process_data().
+ *
+ * Some processing inputs change from range to range: with hist_merge set,
+ * the number of histograms merged and the crosstalk plane offset that goes
+ * with it, with per VCSEL offsets the offset of the A or B period, and
+ * with the ROI the effective SPAD count dmax is computed for.
+ * VL53LX_GetRawHistogramInputs() tells them for the histogram just read.
+ */
+
+/**
+ * @struct VL53LX_RawInputs_t
+ * @brief  Processing inputs of one histogram that the range set
+ */
+typedef struct {
+
+	uint32_t  xtalk_plane_offset_kcps;
+	/*!< algo__crosstalk_compensation_plane_offset_kcps, margin included */
+	int16_t   range_offset_mm;
+	/*!< range_offset_mm of the offset correction mode */
+	uint16_t  max_effective_spads;
+	/*!< dmax_cfg.max_effective_spads of the ROI of the range */
+	uint8_t   histo_merge_nb;
+	/*!< histograms merged into this one, 1 without merging */
+
+} VL53LX_RawInputs_t;
+
+/**
+ * @brief  Reads the histogram of the range that completed
+ *
+ * Replaces VL53LX_GetMultiRangingData() followed by
+ * VL53LX_GetAdditionalData(), the range is then restarted with
+ * VL53LX_ClearInterruptAndStartMeasurement() as usual. Ranges without
+ * ambient bins get the ambient estimate of the previous range, as they
+ * would in VL53LX_get_device_results(). The post processing configuration
+ * is brought up to date for the range as well.
+ *
+ * @param[in]   Dev             : device handle, ranging in histogram mode
+ * @param[out]  pAdditionalData : histogram with its bin sequence, VCSEL
+ *                                timing and the ranging configuration
+ *
+ * @return  VL53LX_ERROR_NONE on success,
+ *          VL53LX_ERROR_MODE_NOT_SUPPORTED outside histogram mode
+ */
+VL53LX_Error VL53LX_GetRawHistogramData(VL53LX_DEV Dev,
+	VL53LX_AdditionalData_t *pAdditionalData);
+
+/**
+ * @brief  Copies the inputs of the histogram last read with
+ *         VL53LX_GetRawHistogramData()
+ *
+ * @param[in]   Dev      : device handle
+ * @param[out]  pinputs  : inputs to VL53LX_hist_process_data() for it
+ */
+void VL53LX_GetRawHistogramInputs(VL53LX_DEV Dev, VL53LX_RawInputs_t *pinputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef _VL53LX_PLATFORM_RING_H_
+#define _VL53LX_PLATFORM_RING_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_ring.h
+ *
+ * @brief  Bounded single producer, single consumer ring of fixed size slots
+ *
+ * Decouples acquisition from processing and publishing: the producer fills
+ * slots in place and never takes a lock, so a slow consumer no longer
+ * delays the next sensor read.
+ *
+ * When the ring is full the producer either drops the oldest slot
+ * (VL53LX_RING_DROP_OLDEST) or waits for the consumer to free one
+ * (VL53LX_RING_BLOCK). Both count an overflow. Dropping moves the consumer
+ * index with a compare and swap, a consumer that raced with it notices its
+ * own swap failing, discards the copy it made and takes the next slot.
+ *
+ * Usage:
+ *
+ *   producer                            consumer
+ *   p = VL53LX_ring_claim(&r, 100);     while (VL53LX_ring_pop(&r, &frame))
+ *   fill *p                                 use frame
+ *   VL53LX_ring_push(&r);
+ */
+
+#define VL53LX_RING_DROP_OLDEST          0
+#define VL53LX_RING_BLOCK                1
+
+#define VL53LX_RING_CACHE_LINE           64
+
+/**
+ * @struct VL53LX_Ring_t
+ * @brief  Ring state, the indices run freely and wrap modulo 2^32
+ */
+typedef struct {
+
+	uint8_t  *slots;
+	/*!< slot_count slots of slot_size bytes, allocated once */
+	uint32_t  slot_size;
+	/*!< bytes per slot */
+	uint32_t  mask;
+	/*!< slot_count - 1, slot_count is a power of two */
+	uint8_t   policy;
+	/*!< VL53LX_RING_DROP_OLDEST or VL53LX_RING_BLOCK */
+	int       notify_fd;
+	/*!< eventfd signalled on every push, -1 for none */
+	_Alignas(VL53LX_RING_CACHE_LINE) atomic_uint head;
+	/*!< next slot to fill, written by the producer only */
+	uint8_t   overflowed;
+	/*!< the slot at head already counted an overflow, producer only */
+	_Alignas(VL53LX_RING_CACHE_LINE) atomic_uint tail;
+	/*!< next slot to take, moved by the consumer and by drops */
+	atomic_uint producer_waiting;
+	/*!< the producer sleeps on tail */
+	atomic_uint overflows;
+	/*!< frames that found the ring full, once however often they are
+	     claimed again */
+
+} VL53LX_Ring_t;
+
+/**
+ * @brief  Allocates slot_count slots, rounded up to a power of two
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_ring_init(VL53LX_Ring_t *pr, uint32_t slot_size, uint32_t slot_count, uint8_t policy);
+
+/**
+ * @brief  Frees the slots
+ */
+void VL53LX_ring_free(VL53LX_Ring_t *pr);
+
+/**
+ * @brief  Returns the slot to fill next, producer side
+ *
+ * A full ring drops its oldest slot, or with VL53LX_RING_BLOCK waits up to
+ * timeout_ms for the consumer.
+ *
+ * @return  the slot, NULL if the ring was still full after timeout_ms
+ */
+void *VL53LX_ring_claim(VL53LX_Ring_t *pr, int32_t timeout_ms);
+
+/**
+ * @brief  Hands the claimed slot to the consumer
+ */
+void VL53LX_ring_push(VL53LX_Ring_t *pr);
+
+/**
+ * @brief  Copies the oldest slot to out and frees it, consumer side
+ *
+ * @return  1 if a slot was copied, 0 if the ring is empty
+ */
+int VL53LX_ring_pop(VL53LX_Ring_t *pr, void *out);
+
+/**
+ * @brief  Returns the number of frames that found the ring full, a blocked
+ *         frame counts once however many claims it takes
+ */
+uint32_t VL53LX_ring_overflows(VL53LX_Ring_t *pr);
+
+/**
+ * @brief  Returns the number of slots waiting for the consumer, from any
+ *         thread
+ */
+uint32_t VL53LX_ring_depth(VL53LX_Ring_t *pr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
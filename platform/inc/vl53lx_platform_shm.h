@@ -0,0 +1,174 @@
+#ifndef _VL53LX_PLATFORM_SHM_H_
+#define _VL53LX_PLATFORM_SHM_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_shm.h
+ *
+ * @brief  Shared memory ring of frames for consumers on the same host
+ *
+ * One writer appends frames to a ring of fixed size slots in /dev/shm,
+ * any number of readers in other processes map it and follow along
+ * without locks, copies through the kernel or syscalls per frame.
+ *
+ * Frames are numbered from 0. Each slot holds the number of its frame
+ * plus one, cleared while the writer fills the slot, so a reader checks
+ * the number before and after copying and notices a frame overwritten
+ * under it. Readers never slow the writer down: one that falls more than
+ * a ring behind skips the frames it lost and counts them.
+ *
+ * Readers that have nothing to do sleep on a futex in the shared header,
+ * the writer only calls into the kernel to wake them while one sleeps.
+ *
+ * Usage:
+ *
+ *   writer                                reader
+ *   VL53LX_shm_create(&shm, name, ...);   VL53LX_shm_open(&shm, name);
+ *   p = VL53LX_shm_claim(&shm);           VL53LX_shm_reader_init(&shm, &r);
+ *   fill p                                while (VL53LX_shm_wait(&r, 100) >= 0)
+ *   VL53LX_shm_commit(&shm, len);             while ((len = VL53LX_shm_read(&r, buf, size)) > 0)
+ *                                                 use buf
+ */
+
+#define VL53LX_SHM_MAGIC                "VL53LXSM"
+#define VL53LX_SHM_VERSION              1
+#define VL53LX_SHM_CACHE_LINE           64
+
+/**
+ * @struct VL53LX_ShmHeader_t
+ * @brief  Start of the shared memory, followed by the slots
+ */
+typedef struct {
+
+	char      magic[8];
+	/*!< VL53LX_SHM_MAGIC, not NUL terminated */
+	uint32_t  version;
+	/*!< VL53LX_SHM_VERSION */
+	uint32_t  slot_size;
+	/*!< bytes from one slot to the next */
+	uint32_t  slot_count;
+	/*!< number of slots, a power of two */
+	uint32_t  data_size;
+	/*!< largest frame a slot holds */
+	_Alignas(VL53LX_SHM_CACHE_LINE) atomic_uint_fast64_t head;
+	/*!< number of frames written, the next frame to write */
+	_Alignas(VL53LX_SHM_CACHE_LINE) atomic_uint futex;
+	/*!< bumped on every frame, readers sleep on it */
+	atomic_uint waiters;
+	/*!< readers sleeping on futex */
+
+} VL53LX_ShmHeader_t;
+
+/**
+ * @struct VL53LX_ShmSlot_t
+ * @brief  Slot header, followed by the frame
+ */
+typedef struct {
+
+	atomic_uint_fast64_t seq;
+	/*!< frame number + 1, 0 while written or never written */
+	uint32_t  len;
+	/*!< bytes of the frame */
+	uint32_t  reserved;
+	/*!< 0 */
+
+} VL53LX_ShmSlot_t;
+
+/**
+ * @struct VL53LX_Shm_t
+ * @brief  Mapping of the ring in one process
+ */
+typedef struct {
+
+	VL53LX_ShmHeader_t *header;
+	/*!< start of the mapping */
+	uint8_t  *slots;
+	/*!< first slot */
+	uint32_t  mask;
+	/*!< slot_count - 1 */
+	size_t    size;
+	/*!< bytes mapped */
+
+} VL53LX_Shm_t;
+
+/**
+ * @struct VL53LX_ShmReader_t
+ * @brief  Position of one reader
+ */
+typedef struct {
+
+	VL53LX_Shm_t *shm;
+	/*!< ring read */
+	uint64_t  next;
+	/*!< next frame to read */
+	uint64_t  lost;
+	/*!< frames overwritten before they were read */
+
+} VL53LX_ShmReader_t;
+
+/**
+ * @brief  Creates or replaces /dev/shm/name for the writer
+ *
+ * @param   data_size   : largest frame
+ * @param   slot_count  : rounded up to a power of two
+ *
+ * @return  0 on success, -1 on failure
+ */
+int VL53LX_shm_create(VL53LX_Shm_t *ps, const char *name, uint32_t data_size, uint32_t slot_count);
+
+/**
+ * @brief  Maps an existing ring for a reader
+ *
+ * @return  0 on success, -1 on failure or when it is no such ring
+ */
+int VL53LX_shm_open(VL53LX_Shm_t *ps, const char *name);
+
+/**
+ * @brief  Unmaps the ring, the writer also removes its name
+ */
+void VL53LX_shm_close(VL53LX_Shm_t *ps, const char *name);
+
+/**
+ * @brief  Returns the slot of the next frame to fill, at least data_size
+ *         bytes, 8 byte aligned
+ */
+void *VL53LX_shm_claim(VL53LX_Shm_t *ps);
+
+/**
+ * @brief  Publishes the claimed frame of len bytes and wakes sleeping
+ *         readers
+ */
+void VL53LX_shm_commit(VL53LX_Shm_t *ps, uint32_t len);
+
+/**
+ * @brief  Starts a reader at the next frame written
+ */
+void VL53LX_shm_reader_init(VL53LX_Shm_t *ps, VL53LX_ShmReader_t *pr);
+
+/**
+ * @brief  Copies the next frame
+ *
+ * @return  its length, 0 when there is none yet, -1 when it is larger
+ *          than size
+ */
+int VL53LX_shm_read(VL53LX_ShmReader_t *pr, void *out, uint32_t size);
+
+/**
+ * @brief  Waits up to timeout_ms for a frame to read, -1 forever
+ *
+ * @return  1 when there is one, 0 on timeout, -1 on error
+ */
+int VL53LX_shm_wait(VL53LX_ShmReader_t *pr, int32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
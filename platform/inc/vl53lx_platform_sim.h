@@ -0,0 +1,173 @@
+#ifndef _VL53LX_PLATFORM_SIM_H_
+#define _VL53LX_PLATFORM_SIM_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_sim.h
+ *
+ * @brief  Behavioural model of a VL53L3CX behind the platform I2C calls
+ *
+ * Selected through the device path given to VL53LX_i2c_init():
+ *
+ *   sim:[KEY=VALUE,...]      no bus, every VL53LX_ReadMulti/WriteMulti is
+ *                            answered by the model
+ *
+ *   target=MM[/KCPS]   add a target at MM millimetres returning KCPS kcps,
+ *                      repeatable up to VL53LX_SIM_MAX_TARGETS times. Without
+ *                      KCPS the rate falls off with the square of the distance
+ *                      from VL53LX_SIM_SIGNAL_KCPS_AT_1M.
+ *   ambient=KCPS       ambient rate seen by the whole array
+ *   period=US          data ready US microseconds after a range is started,
+ *                      0 (default) for ranges that complete immediately
+ *   noise=0|1          shot noise on the bins, on by default
+ *   seed=N             noise generator seed, runs are reproducible per seed
+ *   clock=HZ           I2C clock, every transfer blocks the caller for the
+ *                      time its bytes take on the bus, 0 (default) for none
+ *
+ * The model boots at once, serves the NVM through the NVM_CTRL read
+ * protocol and raises GPIO__TIO_HV_STATUS with the polarity programmed by
+ * the host. Each range fills the histogram result block with the stream
+ * count and grouped parameter hold id the driver expects in back to back
+ * mode and with bins synthesised from the VCSEL period, timeout and VCSEL
+ * width currently programmed. Bins are laid out in groups of 4 following
+ * the low ambient bin sequence the driver programs for each stream parity.
+ *
+ * GPIO1 is modelled by a timerfd expiring when each range completes, see
+ * VL53LX_sim_get_interrupt_fd().
+ */
+
+#define VL53LX_SIM_MAX_OPEN              8
+#define VL53LX_SIM_MAX_TARGETS           4
+
+#define VL53LX_SIM_SIGNAL_KCPS_AT_1M  5000
+#define VL53LX_SIM_FAST_OSC_FREQUENCY 0xBCCC
+#define VL53LX_SIM_REFERENCE_PHASE    0x1400
+#define VL53LX_SIM_EFFECTIVE_SPADS    0x1A00
+#define VL53LX_SIM_PULSE_HALF_WIDTH   0x0C00
+
+/**
+ * @struct VL53LX_SimTarget_t
+ * @brief  One reflecting target in the field of view
+ */
+typedef struct {
+
+	uint16_t  distance_mm;
+	/*!< distance from the sensor */
+	uint32_t  signal_kcps;
+	/*!< return signal rate */
+
+} VL53LX_SimTarget_t;
+
+/**
+ * @struct VL53LX_SimConfig_t
+ * @brief  Scene and timing simulated by the model
+ */
+typedef struct {
+
+	uint8_t   target_count;
+	/*!< number of valid entries in target */
+	VL53LX_SimTarget_t target[VL53LX_SIM_MAX_TARGETS];
+	/*!< targets, in any order */
+	uint32_t  ambient_kcps;
+	/*!< ambient rate */
+	uint32_t  period_us;
+	/*!< time from range start to data ready, 0 for immediate */
+	uint8_t   noise;
+	/*!< apply shot noise to the bins */
+	uint32_t  seed;
+	/*!< noise generator seed */
+	uint32_t  clock_hz;
+	/*!< I2C clock transfers are timed at, 0 for instant transfers */
+
+} VL53LX_SimConfig_t;
+
+/**
+ * @struct VL53LX_SimStats_t
+ * @brief  Model activity counters
+ */
+typedef struct {
+
+	uint32_t  ranges;
+	/*!< ranges completed since open */
+	uint32_t  nvm_reads;
+	/*!< NVM words latched through NVM_CTRL__READN */
+
+} VL53LX_SimStats_t;
+
+/**
+ * @brief  Creates a powered up model configured from the KEY=VALUE list
+ *
+ * @return  a descriptor standing in for the bus fd, -1 on failure
+ */
+int VL53LX_sim_open(const char *params);
+
+/**
+ * @brief  Releases the model attached to fd, if any
+ */
+void VL53LX_sim_close(int fd);
+
+/**
+ * @brief  Tells whether fd is a model descriptor
+ */
+int VL53LX_sim_is_sim(int fd);
+
+/**
+ * @brief  Reads count registers from index, completing a pending range
+ *         first if it is due
+ */
+int VL53LX_sim_read(int fd, uint16_t index, uint8_t *data, uint32_t count);
+
+/**
+ * @brief  Writes count registers from index and acts on the NVM control,
+ *         interrupt clear and mode start registers it covers
+ */
+int VL53LX_sim_write(int fd, uint16_t index, const uint8_t *data, uint32_t count);
+
+/**
+ * @brief  Returns a descriptor that becomes readable when a range
+ *         completes, created on first use
+ *
+ * @return  the descriptor, -1 if fd is not a model
+ */
+int VL53LX_sim_get_interrupt_fd(int fd);
+
+/**
+ * @brief  Waits up to timeout_ms for a range to complete, same semantics as
+ *         VL53LX_gpio_wait_edge()
+ *
+ * @return  the number of completions, 0 on timeout, -1 on failure
+ */
+int VL53LX_sim_wait_interrupt(int fd, int32_t timeout_ms);
+
+/**
+ * @brief  Copies the scene simulated by the model attached to fd
+ *
+ * @return  0 on success, -1 if fd is not a model
+ */
+int VL53LX_sim_get_config(int fd, VL53LX_SimConfig_t *pconfig);
+
+/**
+ * @brief  Changes the scene, applied from the next range on
+ *
+ * @return  0 on success, -1 if fd is not a model
+ */
+int VL53LX_sim_set_config(int fd, const VL53LX_SimConfig_t *pconfig);
+
+/**
+ * @brief  Copies the counters of the model attached to fd
+ *
+ * @return  0 on success, -1 if fd is not a model
+ */
+int VL53LX_sim_get_stats(int fd, VL53LX_SimStats_t *pstats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
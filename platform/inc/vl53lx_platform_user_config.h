@@ -19,6 +19,11 @@
 #define    VL53LX_BYTES_PER_WORD              2
 #define    VL53LX_BYTES_PER_DWORD             4
 
+#define    VL53LX_MAX_I2C_XFER_SIZE         256
+
+#define    VL53LX_REGISTER_SHADOW_SIZE      0x0083
+#define    VL53LX_REGISTER_SHADOW_MERGE_GAP   4
+
 
 #define VL53LX_BOOT_COMPLETION_POLLING_TIMEOUT_MS     500
 #define VL53LX_RANGE_COMPLETION_POLLING_TIMEOUT_MS   2000
@@ -26,6 +31,11 @@
 
 #define VL53LX_POLLING_DELAY_MS                         1
 
+#define VL53LX_POLLING_BACKOFF_MIN_US                 100
+#define VL53LX_POLLING_BACKOFF_MAX_FACTOR               4
+#define VL53LX_POLLING_SPIN_US                         80
+#define VL53LX_WAIT_HISTORY_SIZE                       16
+
 
 #define VL53LX_TUNINGPARM_PUBLIC_PAGE_BASE_ADDRESS  0x8000
 #define VL53LX_TUNINGPARM_PRIVATE_PAGE_BASE_ADDRESS 0xC000
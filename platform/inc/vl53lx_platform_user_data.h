@@ -30,6 +30,156 @@ extern "C"
   int32_t VL53LX_i2c_close(void);
 
 
+/**
+ * @struct VL53LX_PlatformStats_t
+ * @brief  Bus traffic counters kept by the platform layer for each device
+ *
+ * syscalls, errors and interrupt_timeouts are incremented atomically, other
+ * threads may read them with relaxed atomic loads while the device ranges.
+ * The same holds for polls and timeouts of VL53LX_WaitStats_t.
+ */
+typedef struct {
+
+	uint32_t  syscalls;
+	/*!< number of I2C_RDWR ioctls issued */
+	uint32_t  reads;
+	/*!< number of completed register reads */
+	uint32_t  writes;
+	/*!< number of completed register writes */
+	uint32_t  bytes_read;
+	/*!< payload bytes read, register index excluded */
+	uint32_t  bytes_written;
+	/*!< payload bytes written, register index excluded */
+	uint32_t  errors;
+	/*!< number of failed transfers */
+	uint32_t  bytes_elided;
+	/*!< payload bytes not written because the register shadow matched */
+	uint32_t  interrupts;
+	/*!< GPIO1 edges consumed by VL53LX_WaitInterrupt() */
+	uint32_t  interrupt_timeouts;
+	/*!< VL53LX_WaitInterrupt() calls that saw no edge */
+
+} VL53LX_PlatformStats_t;
+
+
+/**
+ * @struct VL53LX_WaitRecord_t
+ * @brief  Outcome of one VL53LX_WaitValueMaskEx() call
+ */
+typedef struct {
+
+	uint16_t  index;
+	/*!< register polled */
+	int8_t    status;
+	/*!< VL53LX_Error returned */
+	uint32_t  polls;
+	/*!< register reads issued */
+	uint32_t  wait_us;
+	/*!< time from the call to the matching read or the timeout */
+
+} VL53LX_WaitRecord_t;
+
+
+/**
+ * @struct VL53LX_WaitStats_t
+ * @brief  VL53LX_WaitValueMaskEx() counters kept for each device
+ */
+typedef struct {
+
+	uint32_t  calls;
+	/*!< number of waits */
+	uint32_t  polls;
+	/*!< register reads issued by all waits */
+	uint32_t  timeouts;
+	/*!< waits that ended with VL53LX_ERROR_TIME_OUT */
+	uint64_t  wait_us;
+	/*!< total time spent waiting */
+	uint32_t  max_wait_us;
+	/*!< longest wait */
+	VL53LX_WaitRecord_t  history[VL53LX_WAIT_HISTORY_SIZE];
+	/*!< most recent waits, history[(calls - 1) % VL53LX_WAIT_HISTORY_SIZE]
+	 * being the last one */
+
+} VL53LX_WaitStats_t;
+
+
+/**
+ * @brief  Stages of a range timed when built with VL53LX_PROFILE_ENABLE
+ */
+#define VL53LX_PROFILE_DEVICE_RESULTS      0
+	/*!< VL53LX_get_device_results(), every stage below but the last */
+#define VL53LX_PROFILE_HISTOGRAM_READ      1
+	/*!< I2C read of the histogram result block */
+#define VL53LX_PROFILE_HISTO_MERGE         2
+	/*!< vl53lx_histo_merge(), only with tuning parameter hist_merge */
+#define VL53LX_PROFILE_OFFSET_SELECT       3
+	/*!< range offset of the ROI or VCSEL period */
+#define VL53LX_PROFILE_HIST_PROCESS        4
+	/*!< VL53LX_ipp_hist_process_data() */
+#define VL53LX_PROFILE_WRAP_DMAX           5
+	/*!< VL53LX_hist_wrap_dmax() */
+#define VL53LX_PROFILE_PHASE_CHECK         6
+	/*!< VL53LX_hist_phase_consistency_check() */
+#define VL53LX_PROFILE_XMONITOR_CHECK      7
+	/*!< VL53LX_hist_xmonitor_consistency_check() */
+#define VL53LX_PROFILE_XTALK_CORRECTION    8
+	/*!< VL53LX_dynamic_xtalk_correction_corrector() */
+#define VL53LX_PROFILE_SET_MEASUREMENT     9
+	/*!< SetMeasurementData() of VL53LX_GetMultiRangingData() */
+#define VL53LX_PROFILE_STAGES             10
+
+#define VL53LX_PROFILE_BUCKETS            32
+
+
+/**
+ * @struct VL53LX_ProfileStage_t
+ * @brief  Durations of one stage
+ */
+typedef struct {
+
+	uint32_t  count;
+	/*!< number of runs */
+	uint64_t  total_ns;
+	/*!< time spent in all runs */
+	uint32_t  max_ns;
+	/*!< longest run */
+	uint32_t  histogram[VL53LX_PROFILE_BUCKETS];
+	/*!< histogram[b] counts the runs of 2^b to 2^(b+1) - 1 ns,
+	 * histogram[0] those under 2 ns */
+
+} VL53LX_ProfileStage_t;
+
+
+/**
+ * @struct VL53LX_ProfileStats_t
+ * @brief  Stage durations kept for each device
+ */
+typedef struct {
+
+	uint32_t  seq;
+	/*!< odd while a stage is being recorded */
+	VL53LX_ProfileStage_t  stage[VL53LX_PROFILE_STAGES];
+	/*!< indexed by VL53LX_PROFILE_* */
+
+} VL53LX_ProfileStats_t;
+
+
+/**
+ * @struct VL53LX_RegisterShadow_t
+ * @brief  Last known image of the host written config registers
+ *
+ * Covers the register map below the system control block. Bytes are
+ * marked valid once written or read back.
+ */
+typedef struct {
+
+	uint8_t   enabled;
+	uint8_t   valid[(VL53LX_REGISTER_SHADOW_SIZE + 7) / 8];
+	uint8_t   image[VL53LX_REGISTER_SHADOW_SIZE];
+
+} VL53LX_RegisterShadow_t;
+
+
 typedef struct {
 
 	VL53LX_DevData_t   Data;
@@ -47,6 +197,37 @@ typedef struct {
 	    /*!< user specific field */
     int   fd;
 
+	VL53LX_PlatformStats_t  stats;
+	    /*!< platform bus counters, see VL53LX_GetPlatformStats() */
+
+	VL53LX_RegisterShadow_t  shadow;
+	    /*!< optional redundant write filter, see VL53LX_EnableRegisterShadow() */
+
+	VL53LX_WaitStats_t  wait_stats;
+	    /*!< register wait counters, see VL53LX_GetWaitStats() */
+
+	VL53LX_ProfileStats_t  profile;
+	    /*!< stage durations, see VL53LX_GetProfileStats() */
+
+	uint8_t   gpio1_enabled;
+	int       gpio1_fd;
+	    /*!< GPIO1 edge event descriptor, valid when gpio1_enabled, see
+	     * VL53LX_EnableInterrupt() */
+
+	uint8_t   power_lines_set;
+	char      gpio_chip[64];
+	int32_t   xshut_line;
+	int32_t   power_line;
+	int       xshut_fd;
+	int       power_fd;
+	    /*!< XSHUT and power enable lines, valid when power_lines_set, a
+	     * line is -1 when not wired and its descriptor -1 until first
+	     * driven, see VL53LX_GpioSetLines() */
+
+	uint8_t   xfer_buf[VL53LX_MAX_I2C_XFER_SIZE + 2];
+	    /*!< register index + payload staging for writes, avoids a
+	     * heap allocation per transfer */
+
 } VL53LX_Dev_t;
 
 
@@ -54,6 +235,163 @@ typedef struct {
 typedef VL53LX_Dev_t *VL53LX_DEV;
 
 
+/**
+ * @brief  Copies the bus counters accumulated for the device
+ *
+ * @param[in]   Dev       : device handle
+ * @param[out]  pstats    : pointer to the counters to fill
+ */
+void VL53LX_GetPlatformStats(VL53LX_DEV Dev, VL53LX_PlatformStats_t *pstats);
+
+/**
+ * @brief  Clears the bus counters of the device
+ *
+ * @param[in]   Dev       : device handle
+ */
+void VL53LX_ResetPlatformStats(VL53LX_DEV Dev);
+
+/**
+ * @brief  Copies the VL53LX_WaitValueMaskEx() counters of the device
+ *
+ * Each wait polls at once, then after 100 us doubling the delay after every
+ * miss up to VL53LX_POLLING_BACKOFF_MAX_FACTOR times the poll delay asked
+ * for. The history shows how many polls and how long each boot, firmware
+ * ready or test completion wait took.
+ *
+ * @param[in]   Dev       : device handle
+ * @param[out]  pstats    : pointer to the counters to fill
+ */
+void VL53LX_GetWaitStats(VL53LX_DEV Dev, VL53LX_WaitStats_t *pstats);
+
+/**
+ * @brief  Clears the VL53LX_WaitValueMaskEx() counters of the device
+ * @param[in]   Dev       : device handle
+ */
+void VL53LX_ResetWaitStats(VL53LX_DEV Dev);
+
+/**
+ * @brief  Copies the stage durations of the device
+ *
+ * The driver times the stages of VL53LX_get_device_results() and
+ * SetMeasurementData() when built with VL53LX_PROFILE_ENABLE (make
+ * PROFILE=1), otherwise the counters stay 0. Comparing the histogram read
+ * with the processing stages tells whether the bus or the CPU bounds the
+ * frame rate. Safe to call from any thread while the device ranges.
+ *
+ * @param[in]   Dev       : device handle
+ * @param[out]  pstats    : pointer to the durations to fill
+ */
+void VL53LX_GetProfileStats(VL53LX_DEV Dev, VL53LX_ProfileStats_t *pstats);
+
+/**
+ * @brief  Clears the stage durations of the device, from the thread ranging
+ *         it
+ * @param[in]   Dev       : device handle
+ */
+void VL53LX_ResetProfileStats(VL53LX_DEV Dev);
+
+/**
+ * @brief  Returns the name of a VL53LX_PROFILE_* stage, e.g. "hist_process"
+ */
+const char *VL53LX_ProfileStageName(uint8_t stage);
+
+/**
+ * @brief  Monotonic time in ns, the start of a stage
+ */
+uint64_t VL53LX_ProfileClock(void);
+
+/**
+ * @brief  Records a stage that started at start_ns
+ */
+void VL53LX_ProfileRecord(VL53LX_DEV Dev, uint8_t stage, uint64_t start_ns);
+
+#ifdef VL53LX_PROFILE_ENABLE
+	#define VL53LX_PROFILE_DECLARE(start) \
+		uint64_t start = 0
+	#define VL53LX_PROFILE_START(start) \
+		start = VL53LX_ProfileClock()
+	#define VL53LX_PROFILE_END(Dev, stage, start) \
+		VL53LX_ProfileRecord(Dev, stage, start)
+#else
+	#define VL53LX_PROFILE_DECLARE(start)
+	#define VL53LX_PROFILE_START(start)
+	#define VL53LX_PROFILE_END(Dev, stage, start)
+#endif
+
+/**
+ * @brief  Enables or disables the register shadow of the device
+ *
+ * When enabled, writes to the config registers skip the bytes that already
+ * hold the same value and send the remaining ones as merged runs. The
+ * shadow starts empty, see VL53LX_InvalidateRegisterShadow().
+ *
+ * @param[in]   Dev       : device handle
+ * @param[in]   enable    : 1 to enable, 0 to disable
+ */
+void VL53LX_EnableRegisterShadow(VL53LX_DEV Dev, uint8_t enable);
+
+/**
+ * @brief  Forgets the cached register image of the device
+ *
+ * Must be called whenever the device is reset or power cycled outside the
+ * driver (e.g. through XSHUT).
+ *
+ * @param[in]   Dev       : device handle
+ */
+void VL53LX_InvalidateRegisterShadow(VL53LX_DEV Dev);
+
+/**
+ * @brief  Delivers data ready through the GPIO1 line of the device
+ *
+ * Requests line of the gpiochip as an input reporting the edge that
+ * asserts GPIO1 with the polarity currently programmed, so it must be
+ * called after VL53LX_DataInit(). A simulated device ignores chip and line
+ * and signals its own range completions.
+ *
+ * @param[in]   Dev       : device handle
+ * @param[in]   chip      : gpiochip device path, e.g. /dev/gpiochip0
+ * @param[in]   line      : line offset wired to GPIO1
+ *
+ * @return  VL53LX_ERROR_NONE on success,
+ *          VL53LX_ERROR_GPIO_NOT_EXISTING if the line can not be requested
+ */
+VL53LX_Error VL53LX_EnableInterrupt(VL53LX_DEV Dev, const char *chip, uint32_t line);
+
+/**
+ * @brief  Releases the GPIO1 line of the device, data ready is polled again
+ * @param[in]   Dev       : device handle
+ */
+void VL53LX_DisableInterrupt(VL53LX_DEV Dev);
+
+/**
+ * @brief  Returns the GPIO1 event descriptor of the device
+ *
+ * The descriptor turns readable when GPIO1 asserts and can be watched by an
+ * external event loop, which then calls VL53LX_WaitInterrupt() with a 0
+ * timeout to consume the edge.
+ *
+ * @param[in]   Dev       : device handle
+ *
+ * @return  the descriptor, -1 when the interrupt is not enabled
+ */
+int VL53LX_GetInterruptFd(VL53LX_DEV Dev);
+
+/**
+ * @brief  Waits for GPIO1 to assert
+ *
+ * Queued edges are all consumed, an edge that arrived before the call
+ * returns at once.
+ *
+ * @param[in]   Dev        : device handle
+ * @param[in]   timeout_ms : maximum wait, -1 for none
+ *
+ * @return  VL53LX_ERROR_NONE on an edge, VL53LX_ERROR_TIME_OUT without,
+ *          VL53LX_ERROR_GPIO_FUNCTIONALITY_NOT_SUPPORTED when not enabled,
+ *          VL53LX_ERROR_CONTROL_INTERFACE on failure
+ */
+VL53LX_Error VL53LX_WaitInterrupt(VL53LX_DEV Dev, int32_t timeout_ms);
+
+
 
 #define VL53LXDevDataGet(Dev, field) (Dev->Data.field)
 
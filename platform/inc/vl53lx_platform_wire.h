@@ -0,0 +1,138 @@
+#ifndef _VL53LX_PLATFORM_WIRE_H_
+#define _VL53LX_PLATFORM_WIRE_H_
+
+#include <stdint.h>
+#include "vl53lx_platform_worker.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_wire.h
+ *
+ * @brief  Fixed layout binary encoding of published frames
+ *
+ * A frame is a VL53LX_WireFrame_t: header, the 24 histogram bins and
+ * VL53LX_MAX_RANGE_RESULTS target records, of which object_count are
+ * valid. Raw frames (VL53LX_WIRE_FLAG_RAW) carry no targets and are
+ * followed by a VL53LX_WireRaw_t with what range processing needs besides
+ * the bins. All fields are little endian and naturally aligned, so the
+ * structures have no padding and decode with a single numpy.frombuffer()
+ * (python/subscriber.py). Rates and sigma stay in the 16.16 fixed point
+ * of VL53LX_TargetRangeData_t.
+ *
+ * The magic starts with a byte no text frame starts with, subscribers
+ * tell both formats apart from the first byte. Fields are only ever added
+ * in a new version, decoders check version before anything else.
+ */
+
+#define VL53LX_WIRE_MAGIC               0x4CB5
+#define VL53LX_WIRE_VERSION             1
+
+#define VL53LX_WIRE_FLAG_RAW            0x01
+#define VL53LX_WIRE_FLAG_HIST_A         0x02
+
+#define VL53LX_WIRE_BINS                24
+#define VL53LX_WIRE_BIN_SEQUENCE_LENGTH 6
+
+/**
+ * @struct VL53LX_WireTarget_t
+ * @brief  One target, as in VL53LX_TargetRangeData_t
+ */
+typedef struct {
+
+	uint32_t  signal_rate_mcps;
+	/*!< SignalRateRtnMegaCps, 16.16 */
+	uint32_t  ambient_rate_mcps;
+	/*!< AmbientRateRtnMegaCps, 16.16 */
+	uint32_t  sigma_mm;
+	/*!< SigmaMilliMeter, 16.16 */
+	int16_t   range_min_mm;
+	/*!< RangeMinMilliMeter */
+	int16_t   range_mm;
+	/*!< RangeMilliMeter */
+	int16_t   range_max_mm;
+	/*!< RangeMaxMilliMeter */
+	uint8_t   range_status;
+	/*!< RangeStatus */
+	uint8_t   extended_range;
+	/*!< ExtendedRange */
+
+} VL53LX_WireTarget_t;
+
+/**
+ * @struct VL53LX_WireFrame_t
+ * @brief  One published frame, 192 bytes
+ */
+typedef struct {
+
+	uint16_t  magic;
+	/*!< VL53LX_WIRE_MAGIC */
+	uint8_t   version;
+	/*!< VL53LX_WIRE_VERSION */
+	uint8_t   flags;
+	/*!< VL53LX_WIRE_FLAG_* */
+	uint8_t   sensor_id;
+	/*!< position of the sensor on the command line, from 0 */
+	uint8_t   stream_count;
+	/*!< result__stream_count */
+	uint8_t   object_count;
+	/*!< valid entries of target */
+	uint8_t   reserved;
+	/*!< 0 */
+	uint64_t  timestamp_ns;
+	/*!< CLOCK_MONOTONIC time data ready was observed */
+	int32_t   bins[VL53LX_WIRE_BINS];
+	/*!< bin_data, all 24 bins of A and B ranges alike */
+	VL53LX_WireTarget_t target[VL53LX_MAX_RANGE_RESULTS];
+	/*!< targets, zero past object_count */
+
+} VL53LX_WireFrame_t;
+
+/**
+ * @struct VL53LX_WireRaw_t
+ * @brief  Follows the frame of a raw histogram, 48 bytes
+ */
+typedef struct {
+
+	uint32_t  total_periods_elapsed;
+	uint32_t  peak_duration_us;
+	uint32_t  woi_duration_us;
+	int32_t   ambient_events_sum;
+	uint16_t  fast_osc_frequency;
+	uint16_t  vcsel_width;
+	uint16_t  reference_phase;
+	uint16_t  zero_distance_phase;
+	uint16_t  effective_spads;
+	uint8_t   vcsel_period;
+	uint8_t   vcsel_start;
+	uint8_t   cal_vcsel_start;
+	uint8_t   number_of_ambient_bins;
+	uint8_t   roi_centre_spad;
+	uint8_t   roi_xy_size;
+	uint8_t   bin_seq[VL53LX_WIRE_BIN_SEQUENCE_LENGTH];
+	uint8_t   bin_rep[VL53LX_WIRE_BIN_SEQUENCE_LENGTH];
+	uint8_t   reserved[4];
+
+} VL53LX_WireRaw_t;
+
+#define VL53LX_WIRE_MAX_SIZE    (sizeof(VL53LX_WireFrame_t) + sizeof(VL53LX_WireRaw_t))
+
+/**
+ * @brief  Encodes a frame
+ *
+ * @param   pframe     : frame from an acquisition thread
+ * @param   sensor_id  : stored in the header
+ * @param   out        : at least VL53LX_WIRE_MAX_SIZE bytes, 8 byte aligned
+ *
+ * @return  number of bytes to publish
+ */
+uint32_t VL53LX_wire_encode(const VL53LX_Frame_t *pframe, uint8_t sensor_id, void *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
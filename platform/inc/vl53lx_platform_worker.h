@@ -0,0 +1,157 @@
+#ifndef _VL53LX_PLATFORM_WORKER_H_
+#define _VL53LX_PLATFORM_WORKER_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "vl53lx_def.h"
+#include "vl53lx_platform_multi.h"
+#include "vl53lx_platform_raw.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file   vl53lx_platform_worker.h
+ *
+ * @brief  One acquisition thread per I2C bus
+ *
+ * Sensors on different buses are independent, a worker owns the
+ * VL53LX_MultiSensor_t of one bus and is the only thread issuing its
+ * transfers. It waits for data ready, reads the results of every sensor
+ * that has some and hands them to a frame handler, then restarts the
+ * range. Sensors configured raw only have their histogram read.
+ * Throughput so scales with the number of buses instead of being bounded
+ * by the transfers of all the sensors in one loop.
+ *
+ * What is read follows the demand set for each sensor: nothing, only the
+ * histogram or the full range processing, so results nobody consumes cost
+ * no transfers or processing. A paused worker stops ranging altogether
+ * until it is resumed.
+ *
+ * Checks that found no data and failures are counted per sensor, other
+ * threads read the counters at any time without stopping the worker.
+ *
+ * The handler runs on the worker thread, handlers shared by several
+ * workers serialize themselves. Workers block all signals, the thread
+ * that installed the handlers receives them and calls
+ * VL53LX_worker_cancel().
+ */
+
+#define VL53LX_WORKER_READ_NONE         0
+#define VL53LX_WORKER_READ_RAW          1
+#define VL53LX_WORKER_READ_FULL         2
+
+#define VL53LX_WORKER_PAUSE_WAIT_MS     100
+
+/**
+ * @struct VL53LX_Frame_t
+ * @brief  Results of one range of one sensor
+ */
+typedef struct {
+
+	uint8_t   sensor;
+	/*!< index of the sensor in its VL53LX_MultiSensor_t */
+	uint64_t  timestamp_ns;
+	/*!< CLOCK_MONOTONIC time data ready was observed */
+	uint32_t  syscalls;
+	/*!< bus syscalls spent on the sensor since its previous frame */
+	uint8_t   raw;
+	/*!< only additional is filled, ranging holds no objects. Set for
+	     sensors configured raw and when only the histogram is in demand */
+	VL53LX_MultiRangingData_t ranging;
+	/*!< VL53LX_GetMultiRangingData() */
+	VL53LX_AdditionalData_t additional;
+	/*!< VL53LX_GetAdditionalData() or VL53LX_GetRawHistogramData(), the
+	     histogram of the range */
+	VL53LX_RawInputs_t inputs;
+	/*!< VL53LX_GetRawHistogramInputs(), only filled when raw */
+
+} VL53LX_Frame_t;
+
+/**
+ * @brief  Receives every frame, pframe is only valid during the call
+ */
+typedef void (*VL53LX_FrameHandler_t)(void *user, VL53LX_Sensor_t *ps,
+	const VL53LX_Frame_t *pframe);
+
+/**
+ * @struct VL53LX_Worker_t
+ * @brief  Acquisition thread of one bus
+ */
+typedef struct {
+
+	VL53LX_MultiSensor_t *pm;
+	/*!< sensors of the bus, started with VL53LX_multi_start() */
+	int32_t   poll_period_ms;
+	/*!< as for VL53LX_multi_wait() */
+	VL53LX_FrameHandler_t handler;
+	/*!< frame consumer */
+	void     *user;
+	/*!< passed to handler */
+	pthread_t thread;
+	/*!< acquisition thread */
+	volatile int running;
+	/*!< cleared to stop the thread */
+	VL53LX_Error status;
+	/*!< why the thread stopped, VL53LX_ERROR_NONE when cancelled */
+	uint32_t  frames;
+	/*!< frames handed to handler */
+	uint32_t  last_syscalls[VL53LX_MULTI_MAX_SENSORS];
+	/*!< per sensor syscall count at its previous frame */
+	atomic_uint demand[VL53LX_MULTI_MAX_SENSORS];
+	/*!< per sensor VL53LX_WORKER_READ_*, VL53LX_WORKER_READ_FULL at start */
+	atomic_uint not_ready[VL53LX_MULTI_MAX_SENSORS];
+	/*!< per sensor data ready checks that found no data yet */
+	atomic_uint errors[VL53LX_MULTI_MAX_SENSORS];
+	/*!< per sensor failed data ready checks and range reads, the range is
+	     restarted after a failed read */
+	volatile int pause;
+	/*!< set to stop ranging, cleared to resume */
+	int       paused;
+	/*!< ranging is stopped, thread side of pause */
+
+} VL53LX_Worker_t;
+
+/**
+ * @brief  Starts the acquisition thread of the bus managed by pm
+ *
+ * @return  VL53LX_ERROR_NONE on success, VL53LX_ERROR_UNDEFINED if the
+ *          thread can not be created
+ */
+VL53LX_Error VL53LX_worker_start(VL53LX_Worker_t *pw, VL53LX_MultiSensor_t *pm,
+	int32_t poll_period_ms, VL53LX_FrameHandler_t handler, void *user);
+
+/**
+ * @brief  Sets what the thread reads from a sensor, VL53LX_WORKER_READ_*
+ *
+ * Sensors configured raw never read more than the histogram.
+ */
+void VL53LX_worker_set_demand(VL53LX_Worker_t *pw, uint8_t sensor, uint32_t level);
+
+/**
+ * @brief  Stops ranging on all the sensors of the bus when pause is set,
+ *         restarts it when cleared, from the worker thread
+ */
+void VL53LX_worker_pause(VL53LX_Worker_t *pw, int pause);
+
+/**
+ * @brief  Asks the thread to stop after its current wait, async signal safe
+ */
+void VL53LX_worker_cancel(VL53LX_Worker_t *pw);
+
+/**
+ * @brief  Waits for the thread to stop, on its own when a replay runs out
+ *         or after VL53LX_worker_cancel()
+ *
+ * @return  the status the thread stopped with
+ */
+VL53LX_Error VL53LX_worker_join(VL53LX_Worker_t *pw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,13 +4,22 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <time.h>
+#include <string.h>
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <unistd.h>
-#include <sys/uio.h>
 #include "vl53lx_platform.h"
+#include "vl53lx_platform_capture.h"
+#include "vl53lx_platform_sim.h"
+#include "vl53lx_platform_gpio.h"
 #include "vl53lx_api.h"
+#include "vl53lx_register_map.h"
+#include "vl53lx_ll_device.h"
 
-int VL53LX_i2c_init(char * devPath, int devAddr)
+// Counters other threads read while the device is in use, e.g. for metrics
+#define COUNT(field, n) __atomic_fetch_add(&(field), (n), __ATOMIC_RELAXED)
+
+static int i2c_open(char * devPath, int devAddr)
 {
     int file;
     if ((file = open(devPath, O_RDWR)) < 0) {
@@ -31,57 +40,396 @@ int VL53LX_i2c_init(char * devPath, int devAddr)
     return file;
 }
 
+int VL53LX_i2c_init(char * devPath, int devAddr)
+{
+    char path[256];
+    char *bus;
+    int file;
+
+    if (strncmp(devPath, "replay:", 7) == 0)
+        return VL53LX_capture_open_replay(devPath + 7);
+
+    if (strncmp(devPath, "sim:", 4) == 0)
+        return VL53LX_sim_open(devPath + 4);
+
+    if (strncmp(devPath, "record:", 7) == 0) {
+        // record:FILE:/dev/i2c-N
+        snprintf(path, sizeof(path), "%s", devPath + 7);
+        bus = strrchr(path, ':');
+        if (bus == NULL) {
+            printf("Expected record:FILE:DEVICE, got %s.\n", devPath);
+            return -1;
+        }
+        *bus++ = '\0';
+        if ((file = i2c_open(bus, devAddr)) < 0)
+            return -1;
+        if (VL53LX_capture_open_record(path, file) < 0) {
+            close(file);
+            return -1;
+        }
+        return file;
+    }
+
+    return i2c_open(devPath, devAddr);
+}
+
 int32_t VL53LX_i2c_close(void)
 {
     printf("%s\n", __FUNCTION__);
     return VL53LX_ERROR_NOT_IMPLEMENTED;
 }
 
-static int i2c_write(int fd, uint16_t cmd, uint8_t * data, uint8_t len){
+static int i2c_write(VL53LX_Dev_t *pdev, uint16_t cmd, uint8_t * data, uint32_t len){
 
-#if 0
-    // Looks like i2c-dev doesn't support writev
-    struct iovec vec[2];
-    uint8_t buf[2] = { cmd >> 8, cmd & 0xff };
-    vec[0].iov_base = buf;
-    vec[0].iov_len = 2;
-    vec[1].iov_base = data;
-    vec[2].iov_len = len;
-    if (writev(fd, vec, 2) != len+2) {
-        printf("Failed to write to the i2c bus due to %s.\n", strerror(errno));
-        return VL53LX_ERROR_CONTROL_INTERFACE;
+    struct i2c_msg msg;
+    struct i2c_rdwr_ioctl_data xfer;
+    uint8_t *buf = pdev->xfer_buf;
+    uint32_t chunk;
+
+    if (VL53LX_sim_is_sim(pdev->fd)) {
+        pdev->stats.writes++;
+        pdev->stats.bytes_written += len;
+        return VL53LX_sim_write(pdev->fd, cmd, data, len);
     }
-#else
-    uint8_t *buf = malloc(len + 2);
-    buf[0] = cmd >> 8;
-    buf[1] = cmd & 0xff;
-    memcpy(buf + 2, data, len);
-    if (write(fd, buf, len + 2) != len+2) {
-        free(buf);
-        printf("Failed to write to the i2c bus due to %s.\n", strerror(errno));
-        return VL53LX_ERROR_CONTROL_INTERFACE;
+
+    // Staged in the per-device buffer, larger writes are split and rely
+    // on the register index auto-incrementing on the device.
+    do {
+        chunk = len > VL53LX_MAX_I2C_XFER_SIZE ? VL53LX_MAX_I2C_XFER_SIZE : len;
+        buf[0] = cmd >> 8;
+        buf[1] = cmd & 0xff;
+        memcpy(buf + 2, data, chunk);
+
+        // Single message addressed per transaction, so the fd does not need
+        // to follow the device around when its address is changed.
+        msg.addr = pdev->i2c_slave_address;
+        msg.flags = 0;
+        msg.len = chunk + 2;
+        msg.buf = buf;
+        xfer.msgs = &msg;
+        xfer.nmsgs = 1;
+
+        COUNT(pdev->stats.syscalls, 1);
+        if (ioctl(pdev->fd, I2C_RDWR, &xfer) != 1) {
+            COUNT(pdev->stats.errors, 1);
+            printf("Failed to write to the i2c bus due to %s.\n", strerror(errno));
+            return VL53LX_ERROR_CONTROL_INTERFACE;
+        }
+        pdev->stats.writes++;
+        pdev->stats.bytes_written += chunk;
+
+        cmd += chunk;
+        data += chunk;
+        len -= chunk;
+    } while (len > 0);
+
+    return VL53LX_ERROR_NONE;
+}
+
+static int i2c_read(VL53LX_Dev_t *pdev, uint16_t cmd, uint8_t * data, uint32_t len){
+
+    uint8_t buf[2];
+    struct i2c_msg msgs[2];
+    struct i2c_rdwr_ioctl_data xfer;
+    uint32_t chunk;
+
+    if (VL53LX_sim_is_sim(pdev->fd)) {
+        pdev->stats.reads++;
+        pdev->stats.bytes_read += len;
+        return VL53LX_sim_read(pdev->fd, cmd, data, len);
     }
-    free(buf);
-#endif
+
+    // Index write and data read in one transfer with a repeated start
+    // instead of write() + read() with a STOP in between. Split like
+    // writes, the length of a message is only 16 bits.
+    do {
+        chunk = len > VL53LX_MAX_I2C_XFER_SIZE ? VL53LX_MAX_I2C_XFER_SIZE : len;
+        buf[0] = cmd >> 8;
+        buf[1] = cmd & 0xff;
+
+        msgs[0].addr = pdev->i2c_slave_address;
+        msgs[0].flags = 0;
+        msgs[0].len = 2;
+        msgs[0].buf = buf;
+        msgs[1].addr = pdev->i2c_slave_address;
+        msgs[1].flags = I2C_M_RD;
+        msgs[1].len = chunk;
+        msgs[1].buf = data;
+        xfer.msgs = msgs;
+        xfer.nmsgs = 2;
+
+        COUNT(pdev->stats.syscalls, 1);
+        if (ioctl(pdev->fd, I2C_RDWR, &xfer) != 2) {
+            COUNT(pdev->stats.errors, 1);
+            printf("Failed to read from the i2c bus due to %s.\n", strerror(errno));
+            return VL53LX_ERROR_CONTROL_INTERFACE;
+        }
+        pdev->stats.reads++;
+        pdev->stats.bytes_read += chunk;
+
+        cmd += chunk;
+        data += chunk;
+        len -= chunk;
+    } while (len > 0);
+
     return VL53LX_ERROR_NONE;
 }
 
-static int i2c_read(int fd, uint16_t cmd, uint8_t * data, uint8_t len){
+#define SHADOW_VALID(pdev, i) ((pdev)->shadow.valid[(i) >> 3] & (1 << ((i) & 7)))
+
+static int shadow_cacheable(uint32_t index){
+    // Config blocks only: system control (interrupt clear, mode start) and
+    // the grouped parameter hold registers must reach the device every time.
+    if (index >= VL53LX_REGISTER_SHADOW_SIZE)
+        return 0;
+    return index != VL53LX_SOFT_RESET &&
+           index != VL53LX_SYSTEM__GROUPED_PARAMETER_HOLD_0 &&
+           index != VL53LX_SYSTEM__GROUPED_PARAMETER_HOLD_1 &&
+           index != VL53LX_SYSTEM__GROUPED_PARAMETER_HOLD;
+}
 
-    uint8_t buf[2] = { cmd >> 8, cmd & 0xff };
-    if (write(fd, buf, 2) != 2) {
-        printf("Failed to write to the i2c bus due to %s.\n", strerror(errno));
-        return VL53LX_ERROR_CONTROL_INTERFACE;
+static void shadow_store(VL53LX_Dev_t *pdev, uint16_t index, uint8_t *data, uint32_t count){
+    uint32_t i;
+    uint32_t reg;
+
+    for (i = 0; i < count; i++) {
+        reg = index + i;
+        if (!shadow_cacheable(reg))
+            continue;
+        pdev->shadow.image[reg] = data[i];
+        pdev->shadow.valid[reg >> 3] |= 1 << (reg & 7);
+    }
+}
+
+static int shadow_dirty(VL53LX_Dev_t *pdev, uint32_t reg, uint8_t value){
+    return !shadow_cacheable(reg) || !SHADOW_VALID(pdev, reg) ||
+           pdev->shadow.image[reg] != value;
+}
+
+static int read_regs(VL53LX_Dev_t *pdev, uint16_t index, uint8_t *data, uint32_t count){
+    int ret;
+
+    if (VL53LX_capture_is_replay(pdev->fd)) {
+        ret = VL53LX_capture_replay(pdev->fd, VL53LX_CAPTURE_OP_READ, pdev->i2c_slave_address,
+            index, data, count);
+    } else {
+        ret = i2c_read(pdev, index, data, count);
+        VL53LX_capture_record(pdev->fd, VL53LX_CAPTURE_OP_READ, ret, pdev->i2c_slave_address,
+            index, data, count);
     }
 
-    if (read(fd, data, len) != len) {
-        printf("Failed to read from the i2c bus due to %s.\n", strerror(errno));
+    if (ret == VL53LX_ERROR_NONE && pdev->shadow.enabled)
+        shadow_store(pdev, index, data, count);
+    return ret;
+}
+
+static int shadow_write(VL53LX_Dev_t *pdev, uint16_t index, uint8_t *data, uint32_t count){
+    int ret = VL53LX_ERROR_NONE;
+    uint32_t i = 0;
+    uint32_t j;
+    uint32_t last;
+    uint32_t written = 0;
+
+    if (!pdev->shadow.enabled)
+        return i2c_write(pdev, index, data, count);
+
+    if (index == VL53LX_SOFT_RESET) {
+        // The device reloads its defaults, nothing cached is trusted after this
+        VL53LX_InvalidateRegisterShadow(pdev);
+        return i2c_write(pdev, index, data, count);
+    }
+
+    // Write only the bytes that differ from the shadow, merging dirty runs
+    // separated by a short clean gap since a new transfer costs more than
+    // resending a few unchanged bytes.
+    while (ret == VL53LX_ERROR_NONE && i < count) {
+        if (!shadow_dirty(pdev, index + i, data[i])) {
+            i++;
+            continue;
+        }
+        last = i;
+        for (j = i + 1; j < count && j - last <= VL53LX_REGISTER_SHADOW_MERGE_GAP; j++) {
+            if (shadow_dirty(pdev, index + j, data[j]))
+                last = j;
+        }
+        ret = i2c_write(pdev, index + i, data + i, last - i + 1);
+        written += last - i + 1;
+        i = last + 1;
+    }
+
+    if (ret == VL53LX_ERROR_NONE) {
+        shadow_store(pdev, index, data, count);
+        pdev->stats.bytes_elided += count - written;
+    } else {
+        VL53LX_InvalidateRegisterShadow(pdev);
+    }
+    return ret;
+}
+
+static int write_regs(VL53LX_Dev_t *pdev, uint16_t index, uint8_t *data, uint32_t count){
+    int ret;
+
+    // Recorded as issued by the driver, before the shadow drops anything,
+    // so a capture replays the same way whatever the shadow setting.
+    if (VL53LX_capture_is_replay(pdev->fd))
+        return VL53LX_capture_replay(pdev->fd, VL53LX_CAPTURE_OP_WRITE, pdev->i2c_slave_address,
+            index, data, count);
+
+    ret = shadow_write(pdev, index, data, count);
+    VL53LX_capture_record(pdev->fd, VL53LX_CAPTURE_OP_WRITE, ret, pdev->i2c_slave_address,
+        index, data, count);
+    return ret;
+}
+
+void VL53LX_EnableRegisterShadow(VL53LX_DEV Dev, uint8_t enable){
+    VL53LX_InvalidateRegisterShadow(Dev);
+    Dev->shadow.enabled = enable;
+}
+
+void VL53LX_InvalidateRegisterShadow(VL53LX_DEV Dev){
+    memset(Dev->shadow.valid, 0, sizeof(Dev->shadow.valid));
+}
+
+void VL53LX_GetPlatformStats(VL53LX_DEV Dev, VL53LX_PlatformStats_t *pstats){
+    *pstats = Dev->stats;
+}
+
+void VL53LX_ResetPlatformStats(VL53LX_DEV Dev){
+    memset(&Dev->stats, 0, sizeof(Dev->stats));
+}
+
+VL53LX_Error VL53LX_EnableInterrupt(VL53LX_DEV Dev, const char *chip, uint32_t line){
+    VL53LX_Error status;
+    uint8_t mux;
+    int fd;
+
+    VL53LX_DisableInterrupt(Dev);
+
+    if (VL53LX_sim_is_sim(Dev->fd)) {
+        fd = VL53LX_sim_get_interrupt_fd(Dev->fd);
+    } else {
+        // GPIO1 is driven to the level programmed as active on data ready
+        status = VL53LX_RdByte(Dev, VL53LX_GPIO_HV_MUX__CTRL, &mux);
+        if (status != VL53LX_ERROR_NONE)
+            return status;
+        fd = VL53LX_gpio_request_input(chip, line,
+            (mux & VL53LX_DEVICEINTERRUPTLEVEL_ACTIVE_MASK) == VL53LX_DEVICEINTERRUPTLEVEL_ACTIVE_HIGH ?
+                VL53LX_GPIO_EDGE_RISING : VL53LX_GPIO_EDGE_FALLING);
+    }
+    if (fd < 0)
+        return VL53LX_ERROR_GPIO_NOT_EXISTING;
+
+    Dev->gpio1_fd = fd;
+    Dev->gpio1_enabled = 1;
+    return VL53LX_ERROR_NONE;
+}
+
+void VL53LX_DisableInterrupt(VL53LX_DEV Dev){
+    if (!Dev->gpio1_enabled)
+        return;
+    // The simulated line belongs to the model
+    if (!VL53LX_sim_is_sim(Dev->fd))
+        VL53LX_gpio_release(Dev->gpio1_fd);
+    Dev->gpio1_enabled = 0;
+}
+
+int VL53LX_GetInterruptFd(VL53LX_DEV Dev){
+    return Dev->gpio1_enabled ? Dev->gpio1_fd : -1;
+}
+
+VL53LX_Error VL53LX_WaitInterrupt(VL53LX_DEV Dev, int32_t timeout_ms){
+    int edges;
+
+    if (!Dev->gpio1_enabled)
+        return VL53LX_ERROR_GPIO_FUNCTIONALITY_NOT_SUPPORTED;
+
+    if (VL53LX_sim_is_sim(Dev->fd))
+        edges = VL53LX_sim_wait_interrupt(Dev->fd, timeout_ms);
+    else
+        edges = VL53LX_gpio_wait_edge(Dev->gpio1_fd, timeout_ms);
+
+    if (edges < 0)
         return VL53LX_ERROR_CONTROL_INTERFACE;
+    if (edges == 0) {
+        COUNT(Dev->stats.interrupt_timeouts, 1);
+        return VL53LX_ERROR_TIME_OUT;
+    }
+    Dev->stats.interrupts += edges;
+    return VL53LX_ERROR_NONE;
+}
+
+// Requests the line with the value on first use, no separate set
+static VL53LX_Error drive_line(VL53LX_Dev_t *pdev, int32_t line, int *pfd, uint8_t value){
+    if (!pdev->power_lines_set || line < 0)
+        return VL53LX_ERROR_NONE;
+    if (*pfd < 0) {
+        *pfd = VL53LX_gpio_request_output(pdev->gpio_chip, line, value);
+        return *pfd < 0 ? VL53LX_ERROR_GPIO_NOT_EXISTING : VL53LX_ERROR_NONE;
     }
+    return VL53LX_gpio_set_value(*pfd, value) < 0 ? VL53LX_ERROR_CONTROL_INTERFACE : VL53LX_ERROR_NONE;
+}
 
+VL53LX_Error VL53LX_GpioSetLines(VL53LX_Dev_t *pdev, const char *chip, int32_t xshut, int32_t power){
+    VL53LX_GpioReleaseLines(pdev);
+    snprintf(pdev->gpio_chip, sizeof(pdev->gpio_chip), "%s", chip);
+    pdev->xshut_line = xshut;
+    pdev->power_line = power;
+    pdev->xshut_fd = -1;
+    pdev->power_fd = -1;
+    pdev->power_lines_set = 1;
     return VL53LX_ERROR_NONE;
 }
 
+void VL53LX_GpioReleaseLines(VL53LX_Dev_t *pdev){
+    if (!pdev->power_lines_set)
+        return;
+    VL53LX_gpio_release(pdev->xshut_fd);
+    VL53LX_gpio_release(pdev->power_fd);
+    pdev->xshut_fd = -1;
+    pdev->power_fd = -1;
+    pdev->power_lines_set = 0;
+}
+
+VL53LX_Error VL53LX_GpioXshutdown(VL53LX_Dev_t *pdev, uint8_t value){
+    return drive_line(pdev, pdev->xshut_line, &pdev->xshut_fd, value);
+}
+
+VL53LX_Error VL53LX_GpioPowerEnable(VL53LX_Dev_t *pdev, uint8_t value){
+    return drive_line(pdev, pdev->power_line, &pdev->power_fd, value);
+}
+
+VL53LX_Error VL53LX_PowerOn(VL53LX_Dev_t *pdev){
+    VL53LX_Error status;
+
+    if (!pdev->power_lines_set || (pdev->xshut_line < 0 && pdev->power_line < 0))
+        return VL53LX_ERROR_NONE;
+
+    status = VL53LX_GpioXshutdown(pdev, 0);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GpioPowerEnable(pdev, 1);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_WaitUs(pdev, pdev->power_line < 0 ? VL53LX_XSHUT_RESET_US : VL53LX_POWER_SETTLE_US);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GpioXshutdown(pdev, 1);
+    if (status == VL53LX_ERROR_NONE && pdev->xshut_line >= 0)
+        status = VL53LX_WaitUs(pdev, VL53LX_BOOT_US);
+
+    // Whatever was written before is gone
+    VL53LX_InvalidateRegisterShadow(pdev);
+    return status;
+}
+
+VL53LX_Error VL53LX_PowerOff(VL53LX_Dev_t *pdev){
+    VL53LX_Error status;
+
+    status = VL53LX_GpioXshutdown(pdev, 0);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GpioPowerEnable(pdev, 0);
+
+    VL53LX_InvalidateRegisterShadow(pdev);
+    return status;
+}
+
 VL53LX_Error VL53LX_LockSequenceAccess(VL53LX_DEV Dev){
     VL53LX_Error Status = VL53LX_ERROR_NONE;
     return Status;
@@ -93,22 +441,22 @@ VL53LX_Error VL53LX_UnlockSequenceAccess(VL53LX_DEV Dev){
 }
 
 VL53LX_Error VL53LX_WriteMulti(VL53LX_DEV Dev, uint16_t index, uint8_t *pdata, uint32_t count){
-    return i2c_write(Dev->fd, index, pdata, count);
+    return write_regs(Dev, index, pdata, count);
 }
 
 VL53LX_Error VL53LX_ReadMulti(VL53LX_DEV Dev, uint16_t index, uint8_t *pdata, uint32_t count){
-    return i2c_read(Dev->fd, index, pdata, count);
+    return read_regs(Dev, index, pdata, count);
 }
 
 VL53LX_Error VL53LX_WrByte(VL53LX_DEV Dev, uint16_t index, uint8_t data){
-	return i2c_write(Dev->fd, index, &data, 1);
+	return write_regs(Dev, index, &data, 1);
 }
 
 VL53LX_Error VL53LX_WrWord(VL53LX_DEV Dev, uint16_t index, uint16_t data){
     uint8_t buf[4];
     buf[1] = data>>0&0xFF;
     buf[0] = data>>8&0xFF;
-    return i2c_write(Dev->fd, index, buf, 2);
+    return write_regs(Dev, index, buf, 2);
 }
 
 VL53LX_Error VL53LX_WrDWord(VL53LX_DEV Dev, uint16_t index, uint32_t data){
@@ -117,7 +465,7 @@ VL53LX_Error VL53LX_WrDWord(VL53LX_DEV Dev, uint16_t index, uint32_t data){
     buf[2] = data>>8&0xFF;
     buf[1] = data>>16&0xFF;
     buf[0] = data>>24&0xFF;
-    return i2c_write(Dev->fd, index, buf, 4);
+    return write_regs(Dev, index, buf, 4);
 }
 
 VL53LX_Error VL53LX_UpdateByte(VL53LX_DEV Dev, uint16_t index, uint8_t AndData, uint8_t OrData){
@@ -125,19 +473,19 @@ VL53LX_Error VL53LX_UpdateByte(VL53LX_DEV Dev, uint16_t index, uint8_t AndData,
     int32_t status_int;
     uint8_t data;
 
-    status_int = i2c_read(Dev->fd, index, &data, 1);
+    status_int = read_regs(Dev, index, &data, 1);
 
     if (status_int != 0){
         return  status_int;
     }
 
     data = (data & AndData) | OrData;
-    return i2c_write(Dev->fd, index, &data, 1);
+    return write_regs(Dev, index, &data, 1);
 }
 
 VL53LX_Error VL53LX_RdByte(VL53LX_DEV Dev, uint16_t index, uint8_t *data){
     uint8_t tmp = 0;
-    int ret = i2c_read(Dev->fd, index, &tmp, 1);
+    int ret = read_regs(Dev, index, &tmp, 1);
     *data = tmp;
     // printf("%u\n", tmp);
     return ret;
@@ -145,7 +493,7 @@ VL53LX_Error VL53LX_RdByte(VL53LX_DEV Dev, uint16_t index, uint8_t *data){
 
 VL53LX_Error VL53LX_RdWord(VL53LX_DEV Dev, uint16_t index, uint16_t *data){
     uint8_t buf[2];
-    int ret = i2c_read(Dev->fd, index, buf, 2);
+    int ret = read_regs(Dev, index, buf, 2);
     uint16_t tmp = 0;
     tmp |= buf[1]<<0;
     tmp |= buf[0]<<8;
@@ -156,7 +504,7 @@ VL53LX_Error VL53LX_RdWord(VL53LX_DEV Dev, uint16_t index, uint16_t *data){
 
 VL53LX_Error  VL53LX_RdDWord(VL53LX_DEV Dev, uint16_t index, uint32_t *data){
     uint8_t buf[4];
-    int ret = i2c_read(Dev->fd, index, buf, 4);
+    int ret = read_regs(Dev, index, buf, 4);
     uint32_t tmp = 0;
     tmp |= buf[3]<<0;
     tmp |= buf[2]<<8;
@@ -195,81 +543,185 @@ VL53LX_Error VL53LX_GetTickCount(
   return VL53LX_ERROR_NONE;
 }
 
-VL53LX_Error VL53LX_WaitValueMaskEx(
-  VL53LX_Dev_t* pdev,
-  uint32_t      timeout_ms,
-  uint16_t      index,
-  uint8_t       value,
-  uint8_t       mask,
-  uint32_t      poll_delay_ms)
-{
+static uint64_t wait_clock_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
+// Sleeps overshoot by tens of microseconds, so sub-millisecond delays
+// sleep most of the way and spin the rest
+static void wait_delay_us(uint64_t delay_us){
+    uint64_t end_us = wait_clock_us() + delay_us;
+    uint64_t wake_us;
+    struct timespec ts;
 
-  VL53LX_Error status = VL53LX_ERROR_NONE;
-  uint32_t     start_time_ms = 0;
-  uint32_t     current_time_ms = 0;
-  uint32_t     polling_time_ms = 0;
-  uint8_t      byte_value = 0;
-  uint8_t      found = 0;
-#ifdef VL53LX_LOG_ENABLE
-  uint32_t     trace_functions = 0;
-#endif
+    if (delay_us >= 1000) {
+        usleep(delay_us);
+        return;
+    }
+    if (delay_us > VL53LX_POLLING_SPIN_US) {
+        wake_us = end_us - VL53LX_POLLING_SPIN_US;
+        ts.tv_sec = wake_us / 1000000;
+        ts.tv_nsec = (wake_us % 1000000) * 1000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while (wait_clock_us() < end_us)
+        ;
+}
 
-//   //_LOG_STRING_BUFFER(register_name);
+static void wait_record(VL53LX_Dev_t *pdev, uint16_t index, VL53LX_Error status,
+    uint32_t polls, uint32_t wait_us){
 
-//   SUPPRESS_UNUSED_WARNING(poll_delay_ms);
+    VL53LX_WaitStats_t *pws = &pdev->wait_stats;
+    VL53LX_WaitRecord_t *prec = &pws->history[pws->calls % VL53LX_WAIT_HISTORY_SIZE];
 
-// #ifdef VL53LX_LOG_ENABLE
+    prec->index = index;
+    prec->status = status;
+    prec->polls = polls;
+    prec->wait_us = wait_us;
 
-//   VL53LX_get_register_name(
-//     index,
-//     register_name);
+    pws->calls++;
+    COUNT(pws->polls, polls);
+    pws->wait_us += wait_us;
+    if (wait_us > pws->max_wait_us)
+        pws->max_wait_us = wait_us;
+    if (status == VL53LX_ERROR_TIME_OUT)
+        COUNT(pws->timeouts, 1);
+}
 
+void VL53LX_GetWaitStats(VL53LX_DEV Dev, VL53LX_WaitStats_t *pstats){
+    *pstats = Dev->wait_stats;
+}
 
-//   trace_i2c("WaitValueMaskEx(%5d, %s, 0x%02X, 0x%02X, %5d);\n",
-//     timeout_ms, register_name, value, mask, poll_delay_ms);
-// #endif
+void VL53LX_ResetWaitStats(VL53LX_DEV Dev){
+    memset(&Dev->wait_stats, 0, sizeof(Dev->wait_stats));
+}
 
+static const char *profile_stage_names[VL53LX_PROFILE_STAGES] = {
+    "device_results",
+    "histogram_read",
+    "histo_merge",
+    "offset_select",
+    "hist_process",
+    "wrap_dmax",
+    "phase_check",
+    "xmonitor_check",
+    "xtalk_correction",
+    "set_measurement"
+};
+
+const char *VL53LX_ProfileStageName(uint8_t stage){
+    return stage < VL53LX_PROFILE_STAGES ? profile_stage_names[stage] : "unknown";
+}
 
+uint64_t VL53LX_ProfileClock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-  VL53LX_GetTickCount(pdev, &start_time_ms);
-  //pdev->new_data_ready_poll_duration_ms = 0;
+// Only the ranging thread writes, seq is odd meanwhile so that readers of
+// other threads retry instead of taking a lock
+void VL53LX_ProfileRecord(VL53LX_DEV Dev, uint8_t stage, uint64_t start_ns){
+    VL53LX_ProfileStats_t *pps = &Dev->profile;
+    VL53LX_ProfileStage_t *pst = &pps->stage[stage];
+    uint64_t ns = VL53LX_ProfileClock() - start_ns;
+    uint32_t seq = __atomic_load_n(&pps->seq, __ATOMIC_RELAXED);
+    int bucket = ns < 2 ? 0 : 63 - __builtin_clzll(ns);
+
+    if (bucket >= VL53LX_PROFILE_BUCKETS)
+        bucket = VL53LX_PROFILE_BUCKETS - 1;
+
+    __atomic_store_n(&pps->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    pst->count++;
+    pst->total_ns += ns;
+    if (ns > pst->max_ns)
+        pst->max_ns = ns > UINT32_MAX ? UINT32_MAX : ns;
+    pst->histogram[bucket]++;
+    __atomic_store_n(&pps->seq, seq + 2, __ATOMIC_RELEASE);
+}
 
+void VL53LX_GetProfileStats(VL53LX_DEV Dev, VL53LX_ProfileStats_t *pstats){
+    VL53LX_ProfileStats_t *pps = &Dev->profile;
+    uint32_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&pps->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        memcpy(pstats->stage, pps->stage, sizeof(pstats->stage));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&pps->seq, __ATOMIC_RELAXED) != seq);
+    pstats->seq = seq;
+}
 
+void VL53LX_ResetProfileStats(VL53LX_DEV Dev){
+    VL53LX_ProfileStats_t *pps = &Dev->profile;
+    uint32_t seq = __atomic_load_n(&pps->seq, __ATOMIC_RELAXED);
 
-#ifdef VL53LX_LOG_ENABLE
-  trace_functions = _LOG_GET_TRACE_FUNCTIONS();
-#endif
-  //_LOG_SET_TRACE_FUNCTIONS(VL53LX_TRACE_FUNCTION_NONE);
+    __atomic_store_n(&pps->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(pps->stage, 0, sizeof(pps->stage));
+    __atomic_store_n(&pps->seq, seq + 2, __ATOMIC_RELEASE);
+}
 
+VL53LX_Error VL53LX_WaitValueMaskEx(
+  VL53LX_Dev_t* pdev,
+  uint32_t      timeout_ms,
+  uint16_t      index,
+  uint8_t       value,
+  uint8_t       mask,
+  uint32_t      poll_delay_ms)
+{
+  VL53LX_Error status = VL53LX_ERROR_NONE;
+  uint64_t     start_us = wait_clock_us();
+  uint64_t     timeout_us = (uint64_t)timeout_ms * 1000;
+  uint64_t     elapsed_us = 0;
+  uint64_t     delay_us = VL53LX_POLLING_BACKOFF_MIN_US;
+  uint64_t     max_delay_us;
+  uint32_t     polls = 0;
+  uint8_t      byte_value = 0;
+  uint8_t      found = 0;
 
+  // Quick completions are caught by the first short delays, long ones
+  // settle at a multiple of the poll delay instead of hammering the bus
+  max_delay_us = (uint64_t)poll_delay_ms * 1000 * VL53LX_POLLING_BACKOFF_MAX_FACTOR;
+  if (max_delay_us < VL53LX_POLLING_BACKOFF_MIN_US)
+    max_delay_us = VL53LX_POLLING_BACKOFF_MIN_US;
 
-  while ((status == VL53LX_ERROR_NONE) &&
-    (polling_time_ms < timeout_ms) &&
-    (found == 0))
+  for (;;)
   {
     status = VL53LX_RdByte(
       pdev,
       index,
       &byte_value);
+    polls++;
+
+    if (status != VL53LX_ERROR_NONE)
+      break;
 
     if ((byte_value & mask) == value)
     {
       found = 1;
+      break;
     }
 
+    elapsed_us = wait_clock_us() - start_us;
+    if (elapsed_us >= timeout_us)
+      break;
 
+    // The last poll lands on the timeout
+    wait_delay_us(delay_us < timeout_us - elapsed_us ? delay_us : timeout_us - elapsed_us);
 
-
-    VL53LX_GetTickCount(pdev, &current_time_ms);
-    polling_time_ms = current_time_ms - start_time_ms;
+    delay_us *= 2;
+    if (delay_us > max_delay_us)
+      delay_us = max_delay_us;
   }
 
-
-  //_LOG_SET_TRACE_FUNCTIONS(trace_functions);
-
   if (found == 0 && status == VL53LX_ERROR_NONE)
     status = VL53LX_ERROR_TIME_OUT;
 
+  wait_record(pdev, index, status, polls, wait_clock_us() - start_us);
   return status;
 }
@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vl53lx_platform_batch.h"
+#include "vl53lx_api.h"
+#include "vl53lx_api_core.h"
+#include "vl53lx_core.h"
+#include "vl53lx_hist_funcs.h"
+
+#define CONTEXT_SIZE    ((sizeof(VL53LX_BatchContext_t) + 7) & ~(size_t)7)
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  context_size;
+    uint32_t  frame_size;
+    uint32_t  reserved;
+} batch_header_t;
+
+typedef struct {
+    const char *name;
+    size_t    offset;
+    uint8_t   size;
+    uint8_t   is_signed;
+} batch_param_t;
+
+#define PARAM(field, is_signed) \
+    { #field, offsetof(VL53LX_hist_post_process_config_t, field), \
+      sizeof(((VL53LX_hist_post_process_config_t *)0)->field), is_signed }
+
+static const batch_param_t params[] = {
+    PARAM(hist_algo_select, 0),
+    PARAM(hist_target_order, 0),
+    PARAM(filter_woi0, 0),
+    PARAM(filter_woi1, 0),
+    PARAM(hist_amb_est_method, 0),
+    PARAM(ambient_thresh_sigma0, 0),
+    PARAM(ambient_thresh_sigma1, 0),
+    PARAM(ambient_thresh_events_scaler, 0),
+    PARAM(min_ambient_thresh_events, 1),
+    PARAM(noise_threshold, 0),
+    PARAM(signal_total_events_limit, 1),
+    PARAM(sigma_estimator__sigma_ref_mm, 0),
+    PARAM(sigma_thresh, 0),
+    PARAM(range_offset_mm, 1),
+    PARAM(gain_factor, 0),
+    PARAM(valid_phase_low, 0),
+    PARAM(valid_phase_high, 0),
+    PARAM(algo__consistency_check__phase_tolerance, 0),
+    PARAM(algo__consistency_check__event_sigma, 0),
+    PARAM(algo__consistency_check__event_min_spad_count, 0),
+    PARAM(algo__consistency_check__min_max_tolerance, 0),
+    PARAM(algo__crosstalk_compensation_enable, 0),
+    PARAM(algo__crosstalk_compensation_plane_offset_kcps, 0),
+    PARAM(algo__crosstalk_compensation_x_plane_gradient_kcps, 1),
+    PARAM(algo__crosstalk_compensation_y_plane_gradient_kcps, 1),
+    PARAM(algo__crosstalk_detect_min_valid_range_mm, 1),
+    PARAM(algo__crosstalk_detect_max_valid_range_mm, 1),
+    PARAM(algo__crosstalk_detect_max_valid_rate_kcps, 0),
+    PARAM(algo__crosstalk_detect_max_sigma_mm, 0),
+    PARAM(algo__crosstalk_detect_event_sigma, 0),
+    PARAM(algo__crosstalk_detect_min_max_tolerance, 0),
+};
+
+#define PARAM_COUNT     (sizeof(params) / sizeof(params[0]))
+
+// Per thread state, the work areas are what keeps the threads apart
+typedef struct {
+    _Alignas(16) uint8_t area1[VL53LX_BATCH_WORK_AREA1_SIZE];
+    _Alignas(16) uint8_t area2[VL53LX_BATCH_WORK_AREA2_SIZE];
+    VL53LX_BatchContext_t context;
+    VL53LX_histogram_bin_data_t hist;
+    VL53LX_range_results_t results;
+    int64_t   plane_offset_tuning;
+    int32_t   range_offset_tuning;
+    const VL53LX_Batch_t *pb;
+    atomic_uint_fast64_t *next;
+    VL53LX_BatchHandler_t handler;
+    void     *user;
+    uint64_t  frames;
+    uint64_t  errors;
+    pthread_t thread;
+} batch_worker_t;
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+VL53LX_Error VL53LX_GetBatchContext(VL53LX_DEV Dev, VL53LX_BatchContext_t *pctx){
+    VL53LX_LLDriverData_t *pdev = VL53LXDevStructGetLLDriverHandle(Dev);
+    VL53LX_Error status;
+
+    memset(pctx, 0, sizeof(*pctx));
+    status = VL53LX_get_dmax_calibration_data(Dev, pdev->dmax_mode, &pctx->dmax_cal);
+    if (status != VL53LX_ERROR_NONE)
+        return status;
+
+    pctx->dmax_cfg = pdev->dmax_cfg;
+    pctx->post_cfg = pdev->histpostprocess;
+    pctx->xtalk_shape = pdev->xtalk_shapes;
+    pctx->hist_merge = pdev->tuning_parms.tp_hist_merge;
+    return VL53LX_ERROR_NONE;
+}
+
+FILE *VL53LX_batch_create(const char *path, const VL53LX_BatchContext_t *pctx){
+    uint8_t context[CONTEXT_SIZE];
+    batch_header_t header;
+    FILE *fp;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("Failed to create batch file %s due to %s.\n", path, strerror(errno));
+        return NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VL53LX_BATCH_MAGIC, sizeof(header.magic));
+    header.version = VL53LX_BATCH_VERSION;
+    header.context_size = CONTEXT_SIZE;
+    header.frame_size = sizeof(VL53LX_BatchFrame_t);
+    memset(context, 0, sizeof(context));
+    memcpy(context, pctx, sizeof(*pctx));
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite(context, sizeof(context), 1, fp) != 1) {
+        printf("Failed to write batch file %s due to %s.\n", path, strerror(errno));
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+int VL53LX_batch_append(FILE *fp, uint64_t timestamp_ns, const VL53LX_histogram_bin_data_t *phist,
+    const VL53LX_RawInputs_t *pinputs){
+
+    VL53LX_BatchFrame_t frame;
+
+    // Padding is zeroed rather than left to whatever the stack held
+    memset(&frame, 0, sizeof(frame));
+    frame.timestamp_ns = timestamp_ns;
+    frame.hist = *phist;
+    frame.inputs = *pinputs;
+    if (fwrite(&frame, sizeof(frame), 1, fp) != 1) {
+        printf("Failed to append to batch file due to %s.\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int VL53LX_batch_map(VL53LX_Batch_t *pb, const char *path){
+    const batch_header_t *header;
+    struct stat st;
+    size_t frames_offset;
+    int fd;
+
+    memset(pb, 0, sizeof(*pb));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Failed to open batch file %s due to %s.\n", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        printf("Failed to stat batch file %s due to %s.\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < VL53LX_BATCH_FILE_HEADER_SIZE + CONTEXT_SIZE) {
+        printf("Failed to read batch file %s, it is truncated.\n", path);
+        close(fd);
+        return -1;
+    }
+
+    pb->map_size = st.st_size;
+    pb->map = mmap(NULL, pb->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pb->map == MAP_FAILED) {
+        printf("Failed to map batch file %s due to %s.\n", path, strerror(errno));
+        pb->map = NULL;
+        return -1;
+    }
+
+    header = pb->map;
+    if (memcmp(header->magic, VL53LX_BATCH_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != VL53LX_BATCH_VERSION) {
+        printf("Failed to read batch file %s, it is not a version %d batch.\n", path,
+            VL53LX_BATCH_VERSION);
+        VL53LX_batch_unmap(pb);
+        return -1;
+    }
+    if (header->context_size != CONTEXT_SIZE || header->frame_size != sizeof(VL53LX_BatchFrame_t)) {
+        printf("Failed to read batch file %s, it was written with other structure sizes.\n", path);
+        VL53LX_batch_unmap(pb);
+        return -1;
+    }
+
+    frames_offset = VL53LX_BATCH_FILE_HEADER_SIZE + CONTEXT_SIZE;
+    memcpy(&pb->context, (const uint8_t *)pb->map + VL53LX_BATCH_FILE_HEADER_SIZE, sizeof(pb->context));
+    pb->frames = (const VL53LX_BatchFrame_t *)((const uint8_t *)pb->map + frames_offset);
+    // A trailing partial frame is a write cut short, it is ignored
+    pb->count = (pb->map_size - frames_offset) / sizeof(VL53LX_BatchFrame_t);
+    return 0;
+}
+
+void VL53LX_batch_unmap(VL53LX_Batch_t *pb){
+    if (pb->map != NULL)
+        munmap(pb->map, pb->map_size);
+    pb->map = NULL;
+    pb->frames = NULL;
+    pb->count = 0;
+}
+
+int VL53LX_batch_set_param(VL53LX_hist_post_process_config_t *pcfg, const char *key_value){
+    const char *eq = strchr(key_value, '=');
+    uint8_t *field;
+    char *end;
+    long long value;
+    size_t i;
+
+    if (eq == NULL)
+        return -1;
+    for (i = 0; i < PARAM_COUNT; i++) {
+        if (strlen(params[i].name) == (size_t)(eq - key_value) &&
+            strncmp(params[i].name, key_value, eq - key_value) == 0)
+            break;
+    }
+    if (i == PARAM_COUNT)
+        return -1;
+
+    errno = 0;
+    value = strtoll(eq + 1, &end, 0);
+    if (errno != 0 || end == eq + 1 || *end != '\0')
+        return -1;
+
+    field = (uint8_t *)pcfg + params[i].offset;
+    switch (params[i].size) {
+    case 1:
+        *field = (uint8_t)value;
+        break;
+    case 2:
+        if (params[i].is_signed)
+            *(int16_t *)field = (int16_t)value;
+        else
+            *(uint16_t *)field = (uint16_t)value;
+        break;
+    default:
+        if (params[i].is_signed)
+            *(int32_t *)field = (int32_t)value;
+        else
+            *(uint32_t *)field = (uint32_t)value;
+        break;
+    }
+    return 0;
+}
+
+void VL53LX_batch_print_params(FILE *fp, const VL53LX_hist_post_process_config_t *pcfg){
+    const uint8_t *field;
+    long long value;
+    size_t i;
+
+    for (i = 0; i < PARAM_COUNT; i++) {
+        field = (const uint8_t *)pcfg + params[i].offset;
+        switch (params[i].size) {
+        case 1:
+            value = *field;
+            break;
+        case 2:
+            value = params[i].is_signed ? *(const int16_t *)field : *(const uint16_t *)field;
+            break;
+        default:
+            value = params[i].is_signed ? *(const int32_t *)field : *(const uint32_t *)field;
+            break;
+        }
+        fprintf(fp, "%s=%lld\n", params[i].name, value);
+    }
+}
+
+static VL53LX_Error process_frame(batch_worker_t *pw, const VL53LX_BatchFrame_t *pframe){
+    VL53LX_BatchContext_t *pctx = &pw->context;
+    VL53LX_range_data_t *pdata;
+    uint8_t histo_merge_nb = pframe->inputs.histo_merge_nb;
+    int64_t plane_offset_kcps;
+    VL53LX_Error status;
+    int i;
+
+    // The offsets the range was processed with live, and any tuning on top
+    plane_offset_kcps = pframe->inputs.xtalk_plane_offset_kcps + pw->plane_offset_tuning;
+    pctx->post_cfg.algo__crosstalk_compensation_plane_offset_kcps =
+        plane_offset_kcps > 0 ? (uint32_t)plane_offset_kcps : 0;
+    pctx->post_cfg.range_offset_mm = pframe->inputs.range_offset_mm + pw->range_offset_tuning;
+    pctx->dmax_cfg.max_effective_spads = pframe->inputs.max_effective_spads;
+
+    // Processing writes to its inputs, the mapping stays untouched
+    pw->hist = pframe->hist;
+    memset(&pw->results, 0, sizeof(pw->results));
+    status = VL53LX_hist_process_data(&pctx->dmax_cal, &pctx->dmax_cfg, &pctx->post_cfg,
+        &pw->hist, &pctx->xtalk_shape, pw->area1, pw->area2, &pw->results, &histo_merge_nb);
+
+    if (pctx->hist_merge == 1 && histo_merge_nb > 1)
+        for (i = 0; i < VL53LX_MAX_RANGE_RESULTS; i++) {
+            pdata = &pw->results.VL53LX_p_003[i];
+            pdata->VL53LX_p_016 /= histo_merge_nb;
+            pdata->VL53LX_p_017 /= histo_merge_nb;
+            pdata->VL53LX_p_010 /= histo_merge_nb;
+            pdata->peak_signal_count_rate_mcps /= histo_merge_nb;
+            pdata->avg_signal_count_rate_mcps /= histo_merge_nb;
+            pdata->ambient_count_rate_mcps /= histo_merge_nb;
+            pdata->VL53LX_p_009 /= histo_merge_nb;
+        }
+
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_hist_wrap_dmax(&pctx->post_cfg, &pw->hist, &pw->results.wrap_dmax_mm);
+    return status;
+}
+
+static void *batch_main(void *arg){
+    batch_worker_t *pw = arg;
+    uint64_t first, last, i;
+
+    for (;;) {
+        first = atomic_fetch_add(pw->next, VL53LX_BATCH_CHUNK_FRAMES);
+        if (first >= pw->pb->count)
+            break;
+        last = first + VL53LX_BATCH_CHUNK_FRAMES;
+        if (last > pw->pb->count)
+            last = pw->pb->count;
+
+        for (i = first; i < last; i++) {
+            if (process_frame(pw, &pw->pb->frames[i]) != VL53LX_ERROR_NONE) {
+                pw->errors++;
+                continue;
+            }
+            pw->frames++;
+            if (pw->handler != NULL)
+                pw->handler(pw->user, i, &pw->results);
+        }
+    }
+    return NULL;
+}
+
+VL53LX_Error VL53LX_batch_process(const VL53LX_Batch_t *pb, const VL53LX_BatchContext_t *pctx,
+    uint32_t threads, VL53LX_BatchHandler_t handler, void *user, VL53LX_BatchStats_t *pstats){
+
+    atomic_uint_fast64_t next;
+    batch_worker_t *workers;
+    uint32_t started, used, i;
+    double start;
+    int rc;
+
+    if (threads == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+
+    workers = calloc(threads, sizeof(*workers));
+    if (workers == NULL) {
+        printf("Failed to allocate %u batch workers.\n", threads);
+        return VL53LX_ERROR_UNDEFINED;
+    }
+
+    atomic_init(&next, 0);
+    start = now_s();
+    for (started = 0; started < threads; started++) {
+        batch_worker_t *pw = &workers[started];
+        pw->context = *pctx;
+        pw->plane_offset_tuning = (int64_t)pctx->post_cfg.algo__crosstalk_compensation_plane_offset_kcps -
+            pb->context.post_cfg.algo__crosstalk_compensation_plane_offset_kcps;
+        pw->range_offset_tuning = pctx->post_cfg.range_offset_mm - pb->context.post_cfg.range_offset_mm;
+        pw->pb = pb;
+        pw->next = &next;
+        pw->handler = handler;
+        pw->user = user;
+        rc = pthread_create(&pw->thread, NULL, batch_main, pw);
+        if (rc != 0) {
+            printf("Failed to start batch worker due to %s.\n", strerror(rc));
+            break;
+        }
+    }
+
+    // The threads already running finish the whole batch between them,
+    // with none the caller does the work
+    used = started;
+    if (started == 0) {
+        batch_main(&workers[0]);
+        used = 1;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    if (pstats != NULL) {
+        memset(pstats, 0, sizeof(*pstats));
+        for (i = 0; i < used; i++) {
+            pstats->frames += workers[i].frames;
+            pstats->errors += workers[i].errors;
+        }
+        pstats->threads = used;
+        pstats->seconds = now_s() - start;
+        if (pstats->seconds > 0) {
+            pstats->fps = (pstats->frames + pstats->errors) / pstats->seconds;
+            pstats->fps_per_core = pstats->fps / used;
+        }
+    }
+    free(workers);
+    return VL53LX_ERROR_NONE;
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vl53lx_platform_capture.h"
+#include "vl53lx_error_codes.h"
+
+typedef struct {
+    int       fd;
+    int       replay;
+    FILE     *file;         // record
+    uint8_t  *map;          // replay
+    size_t    size;
+    size_t    pos;
+    VL53LX_CaptureStats_t stats;
+} capture_t;
+
+static capture_t captures[VL53LX_CAPTURE_MAX_OPEN];
+static int capture_count = 0;
+
+static capture_t *capture_get(int fd){
+    int i;
+    for (i = 0; i < capture_count; i++) {
+        if (captures[i].fd == fd)
+            return &captures[i];
+    }
+    return NULL;
+}
+
+static capture_t *capture_add(int fd){
+    capture_t *cap;
+    if (capture_count == VL53LX_CAPTURE_MAX_OPEN) {
+        printf("Too many open I2C captures.\n");
+        return NULL;
+    }
+    cap = &captures[capture_count++];
+    memset(cap, 0, sizeof(*cap));
+    cap->fd = fd;
+    return cap;
+}
+
+static void put_le(uint8_t *p, uint64_t value, int bytes){
+    int i;
+    for (i = 0; i < bytes; i++)
+        p[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint64_t get_le(const uint8_t *p, int bytes){
+    uint64_t value = 0;
+    int i;
+    for (i = 0; i < bytes; i++)
+        value |= (uint64_t)p[i] << (8 * i);
+    return value;
+}
+
+int VL53LX_capture_open_record(const char *path, int fd){
+    uint8_t header[VL53LX_CAPTURE_FILE_HEADER_SIZE];
+    capture_t *cap;
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        printf("Failed to create capture %s due to %s.\n", path, strerror(errno));
+        return -1;
+    }
+    cap = capture_add(fd);
+    if (cap == NULL) {
+        fclose(file);
+        return -1;
+    }
+    // Histogram frames are ~100 bytes, let stdio batch them into few writes
+    setvbuf(file, NULL, _IOFBF, 64 * 1024);
+
+    memcpy(header, VL53LX_CAPTURE_MAGIC, 8);
+    put_le(header + 8, VL53LX_CAPTURE_VERSION, 4);
+    fwrite(header, 1, sizeof(header), file);
+    cap->file = file;
+    return 0;
+}
+
+int VL53LX_capture_open_replay(const char *path){
+    struct stat st;
+    capture_t *cap;
+    uint8_t *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        printf("Failed to open capture %s due to %s.\n", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < VL53LX_CAPTURE_FILE_HEADER_SIZE) {
+        printf("Capture %s is truncated.\n", path);
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to map capture %s due to %s.\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (memcmp(map, VL53LX_CAPTURE_MAGIC, 8) != 0 ||
+        get_le(map + 8, 4) != VL53LX_CAPTURE_VERSION) {
+        printf("%s is not a version %d capture.\n", path, VL53LX_CAPTURE_VERSION);
+        munmap(map, st.st_size);
+        close(fd);
+        return -1;
+    }
+    cap = capture_add(fd);
+    if (cap == NULL) {
+        munmap(map, st.st_size);
+        close(fd);
+        return -1;
+    }
+    cap->replay = 1;
+    cap->map = map;
+    cap->size = st.st_size;
+    cap->pos = VL53LX_CAPTURE_FILE_HEADER_SIZE;
+    return fd;
+}
+
+void VL53LX_capture_close(int fd){
+    capture_t *cap = capture_get(fd);
+
+    if (cap == NULL)
+        return;
+    if (cap->file)
+        fclose(cap->file);
+    if (cap->map) {
+        munmap(cap->map, cap->size);
+        close(fd);
+    }
+    *cap = captures[--capture_count];
+}
+
+int VL53LX_capture_is_replay(int fd){
+    capture_t *cap = capture_get(fd);
+    return cap != NULL && cap->replay;
+}
+
+void VL53LX_capture_record(int fd, uint8_t op, int status, uint8_t address,
+    uint16_t index, const uint8_t *data, uint32_t count){
+
+    uint8_t header[VL53LX_CAPTURE_RECORD_SIZE];
+    struct timespec ts;
+    capture_t *cap;
+
+    if (capture_count == 0)
+        return;
+    cap = capture_get(fd);
+    if (cap == NULL || cap->replay)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    put_le(header, (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec, 8);
+    header[8] = op;
+    header[9] = (uint8_t)(int8_t)status;
+    header[10] = address;
+    put_le(header + 11, index, 2);
+    put_le(header + 13, count, 2);
+    fwrite(header, 1, sizeof(header), cap->file);
+    fwrite(data, 1, count, cap->file);
+    cap->stats.records++;
+}
+
+int VL53LX_capture_replay(int fd, uint8_t op, uint8_t address,
+    uint16_t index, uint8_t *data, uint32_t count){
+
+    capture_t *cap = capture_get(fd);
+    const uint8_t *rec;
+    uint16_t rec_index;
+    uint16_t rec_count;
+    int8_t   rec_status;
+
+    if (cap == NULL || !cap->replay)
+        return VL53LX_ERROR_CONTROL_INTERFACE;
+
+    if (cap->pos + VL53LX_CAPTURE_RECORD_SIZE > cap->size) {
+        printf("Capture exhausted after %u records.\n", cap->stats.records);
+        return VL53LX_ERROR_CONTROL_INTERFACE;
+    }
+    rec = cap->map + cap->pos;
+    rec_index = get_le(rec + 11, 2);
+    rec_count = get_le(rec + 13, 2);
+    rec_status = (int8_t)rec[9];
+
+    if (rec[8] != op || rec[10] != address || rec_index != index || rec_count != count ||
+        cap->pos + VL53LX_CAPTURE_RECORD_SIZE + rec_count > cap->size) {
+        printf("Replay diverged at record %u: expected %c 0x%02X:0x%04X[%u], got %c 0x%02X:0x%04X[%u].\n",
+            cap->stats.records, rec[8], rec[10], rec_index, rec_count, op, address, index, count);
+        return VL53LX_ERROR_CONTROL_INTERFACE;
+    }
+
+    rec += VL53LX_CAPTURE_RECORD_SIZE;
+    if (op == VL53LX_CAPTURE_OP_READ)
+        memcpy(data, rec, count);
+    else if (memcmp(data, rec, count) != 0)
+        cap->stats.payload_mismatches++;
+
+    cap->pos += VL53LX_CAPTURE_RECORD_SIZE + rec_count;
+    cap->stats.records++;
+    return rec_status;
+}
+
+int VL53LX_capture_get_stats(int fd, VL53LX_CaptureStats_t *pstats){
+    capture_t *cap = capture_get(fd);
+
+    if (cap == NULL)
+        return -1;
+    *pstats = cap->stats;
+    return 0;
+}
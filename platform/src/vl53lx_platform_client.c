@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include "vl53lx_platform_client.h"
+
+int VL53LX_client_open(VL53LX_Client_t *pc, const char *address){
+    int linger = 0;
+
+    memset(pc, 0, sizeof(*pc));
+    pc->context = zmq_ctx_new();
+    pc->socket = pc->context ? zmq_socket(pc->context, ZMQ_SUB) : NULL;
+    if (pc->socket == NULL || zmq_connect(pc->socket, address) != 0) {
+        printf("Failed to connect to %s due to %s.\n", address, zmq_strerror(zmq_errno()));
+        VL53LX_client_close(pc);
+        return -1;
+    }
+    zmq_setsockopt(pc->socket, ZMQ_LINGER, &linger, sizeof(linger));
+    return 0;
+}
+
+int VL53LX_client_subscribe(VL53LX_Client_t *pc, const char *topic){
+    if (zmq_setsockopt(pc->socket, ZMQ_SUBSCRIBE, topic, strlen(topic)) != 0) {
+        printf("Failed to subscribe to %s due to %s.\n", topic, zmq_strerror(zmq_errno()));
+        return -1;
+    }
+    return 0;
+}
+
+void VL53LX_client_close(VL53LX_Client_t *pc){
+    if (pc->size != 0)
+        zmq_msg_close(&pc->message);
+    pc->size = 0;
+    if (pc->socket != NULL)
+        zmq_close(pc->socket);
+    if (pc->context != NULL)
+        zmq_ctx_destroy(pc->context);
+    pc->socket = NULL;
+    pc->context = NULL;
+}
+
+// Receives the next topic and payload pair, 1 when there is one, 0 when
+// nothing is queued, -1 on error
+static int client_next(VL53LX_Client_t *pc){
+    zmq_msg_t topic;
+    const uint8_t *data;
+
+    for (;;) {
+        zmq_msg_init(&topic);
+        if (zmq_msg_recv(&topic, pc->socket, ZMQ_DONTWAIT) < 0) {
+            zmq_msg_close(&topic);
+            return zmq_errno() == EAGAIN ? 0 : -1;
+        }
+        // Parts of a message arrive together, the payload is there
+        if (!zmq_msg_more(&topic)) {
+            zmq_msg_close(&topic);
+            pc->skipped++;
+            continue;
+        }
+        zmq_msg_close(&topic);
+
+        zmq_msg_init(&pc->message);
+        if (zmq_msg_recv(&pc->message, pc->socket, ZMQ_DONTWAIT) < 0) {
+            zmq_msg_close(&pc->message);
+            return -1;
+        }
+        pc->messages++;
+        data = zmq_msg_data(&pc->message);
+        // Text frames never start with the first byte of the magic
+        if (zmq_msg_size(&pc->message) < sizeof(VL53LX_WireFrame_t) ||
+            data[0] != (VL53LX_WIRE_MAGIC & 0xff)) {
+            zmq_msg_close(&pc->message);
+            pc->skipped++;
+            continue;
+        }
+        pc->offset = 0;
+        pc->size = zmq_msg_size(&pc->message);
+        return 1;
+    }
+}
+
+// Copies frames of the current message until it or the arrays run out
+static uint32_t client_copy(VL53LX_Client_t *pc, VL53LX_WireFrame_t *frames, VL53LX_WireRaw_t *raws,
+                            uint32_t n, uint32_t max_frames){
+    const uint8_t *data = zmq_msg_data(&pc->message);
+    const VL53LX_WireFrame_t *pwf;
+    uint32_t len;
+
+    while (n < max_frames && pc->size - pc->offset >= sizeof(VL53LX_WireFrame_t)) {
+        pwf = (const VL53LX_WireFrame_t *)(data + pc->offset);
+        len = sizeof(VL53LX_WireFrame_t);
+        if (pwf->flags & VL53LX_WIRE_FLAG_RAW)
+            len += sizeof(VL53LX_WireRaw_t);
+        if (le16toh(pwf->magic) != VL53LX_WIRE_MAGIC || pwf->version != VL53LX_WIRE_VERSION ||
+            pc->size - pc->offset < len)
+            break;
+
+        memcpy(&frames[n], pwf, sizeof(VL53LX_WireFrame_t));
+        if (raws != NULL && (pwf->flags & VL53LX_WIRE_FLAG_RAW))
+            memcpy(&raws[n], pwf + 1, sizeof(VL53LX_WireRaw_t));
+        pc->offset += len;
+        n++;
+    }
+
+    // Done with the message, or the rest is no frame of this version
+    if (n < max_frames || pc->offset == pc->size) {
+        if (pc->offset != pc->size)
+            pc->skipped++;
+        zmq_msg_close(&pc->message);
+        pc->size = 0;
+    }
+    return n;
+}
+
+int VL53LX_client_recv(VL53LX_Client_t *pc, VL53LX_WireFrame_t *frames, VL53LX_WireRaw_t *raws,
+                       uint32_t max_frames, int32_t timeout_ms){
+    zmq_pollitem_t item = {pc->socket, 0, ZMQ_POLLIN, 0};
+    uint32_t n = 0;
+    int rc = 0;
+
+    while (n < max_frames) {
+        if (pc->size == 0) {
+            rc = client_next(pc);
+            if (rc < 0)
+                break;
+            if (rc == 0) {
+                // Only the first frame is waited for
+                if (n > 0 || timeout_ms == 0)
+                    break;
+                rc = zmq_poll(&item, 1, timeout_ms);
+                if (rc < 0 && zmq_errno() == EINTR)
+                    return 0;
+                if (rc <= 0)
+                    break;
+                // Wait at most once
+                timeout_ms = 0;
+                continue;
+            }
+        }
+        n = client_copy(pc, frames, raws, n, max_frames);
+    }
+
+    if (n == 0 && rc < 0) {
+        printf("Failed to receive frames due to %s.\n", zmq_strerror(zmq_errno()));
+        return -1;
+    }
+    pc->frames += n;
+    return n;
+}
@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "vl53lx_platform_deadline.h"
+
+#define STEP_NS  ((uint64_t)VL53LX_DEADLINE_POLL_STEP_US * 1000)
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline_ns){
+    struct timespec ts;
+
+    ts.tv_sec = deadline_ns / 1000000000ULL;
+    ts.tv_nsec = deadline_ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+void VL53LX_deadline_init(VL53LX_Deadline_t *pdl, uint32_t period_us){
+    memset(pdl, 0, sizeof(*pdl));
+    pdl->period_ns = (uint64_t)period_us * 1000;
+    pdl->guard_ns = pdl->period_ns / 16;
+    if (pdl->guard_ns < STEP_NS)
+        pdl->guard_ns = STEP_NS;
+    pdl->last_ready_ns = now_ns();
+}
+
+uint64_t VL53LX_deadline_next_ns(const VL53LX_Deadline_t *pdl){
+    if (pdl->frame_polls == 0)
+        return pdl->last_ready_ns + pdl->period_ns - pdl->guard_ns;
+    return pdl->next_poll_ns;
+}
+
+void VL53LX_deadline_polled(VL53LX_Deadline_t *pdl){
+    uint64_t deadline = VL53LX_deadline_next_ns(pdl);
+    uint64_t now = now_ns();
+
+    // Running late, the following polls are spaced from now
+    if (deadline < now)
+        deadline = now;
+    pdl->next_poll_ns = deadline + STEP_NS;
+    pdl->frame_polls++;
+    pdl->polls++;
+}
+
+void VL53LX_deadline_wait(VL53LX_Deadline_t *pdl){
+    uint64_t deadline = VL53LX_deadline_next_ns(pdl);
+
+    if (deadline > now_ns())
+        sleep_until(deadline);
+    VL53LX_deadline_polled(pdl);
+}
+
+void VL53LX_deadline_ready(VL53LX_Deadline_t *pdl){
+    uint64_t now = now_ns();
+    int64_t interval = now - pdl->last_ready_ns;
+    int64_t error = interval - (int64_t)pdl->period_ns;
+    uint64_t excess;
+
+    // Intervals spanning missed frames say nothing about the period
+    if (interval < 2 * (int64_t)pdl->period_ns || pdl->period_ns == 0)
+        pdl->period_ns += error / 8;
+
+    if (pdl->frame_polls <= 1) {
+        // Found ready at once, the range may have completed long before
+        pdl->guard_ns *= 2;
+        if (pdl->guard_ns > pdl->period_ns / 2)
+            pdl->guard_ns = pdl->period_ns / 2;
+    } else if (pdl->frame_polls > VL53LX_DEADLINE_TARGET_POLLS) {
+        excess = (pdl->frame_polls - VL53LX_DEADLINE_TARGET_POLLS) * STEP_NS;
+        pdl->guard_ns = pdl->guard_ns > excess + STEP_NS ? pdl->guard_ns - excess : STEP_NS;
+    }
+    if (pdl->guard_ns < STEP_NS)
+        pdl->guard_ns = STEP_NS;
+
+    pdl->last_ready_ns = now;
+    pdl->frame_polls = 0;
+    pdl->frames++;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "vl53lx_platform_gpio.h"
+
+static int request_line(const char *chip, uint32_t line, struct gpio_v2_line_config *pconfig){
+    struct gpio_v2_line_request req;
+    int chip_fd = open(chip, O_RDWR | O_CLOEXEC);
+
+    if (chip_fd < 0) {
+        printf("Failed to open %s due to %s.\n", chip, strerror(errno));
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    snprintf(req.consumer, sizeof(req.consumer), "%s", VL53LX_GPIO_CONSUMER);
+    req.config = *pconfig;
+
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        printf("Failed to request line %u of %s due to %s.\n", line, chip, strerror(errno));
+        close(chip_fd);
+        return -1;
+    }
+    // The line stays requested through its own descriptor
+    close(chip_fd);
+    return req.fd;
+}
+
+int VL53LX_gpio_request_input(const char *chip, uint32_t line, uint8_t edges){
+    struct gpio_v2_line_config config;
+    int fd;
+
+    memset(&config, 0, sizeof(config));
+    config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    if (edges & VL53LX_GPIO_EDGE_RISING)
+        config.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+    if (edges & VL53LX_GPIO_EDGE_FALLING)
+        config.flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+    fd = request_line(chip, line, &config);
+    // Drained without blocking once poll() reported it readable
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int VL53LX_gpio_request_output(const char *chip, uint32_t line, uint8_t value){
+    struct gpio_v2_line_config config;
+
+    // The initial value is applied with the request, no glitch
+    memset(&config, 0, sizeof(config));
+    config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    config.num_attrs = 1;
+    config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    config.attrs[0].attr.values = value ? 1 : 0;
+    config.attrs[0].mask = 1;
+    return request_line(chip, line, &config);
+}
+
+int VL53LX_gpio_set_value(int fd, uint8_t value){
+    struct gpio_v2_line_values values;
+
+    values.bits = value ? 1 : 0;
+    values.mask = 1;
+    if (ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        printf("Failed to set GPIO line due to %s.\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int VL53LX_gpio_wait_edge(int fd, int32_t timeout_ms){
+    struct gpio_v2_line_event events[16];
+    struct pollfd pfd;
+    int edges = 0;
+    ssize_t n;
+    int rc;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+        printf("Failed to wait for a GPIO edge due to %s.\n", strerror(errno));
+        return -1;
+    }
+    if (rc == 0)
+        return 0;
+
+    while ((n = read(fd, events, sizeof(events))) > 0)
+        edges += n / sizeof(events[0]);
+    if (n < 0 && errno != EAGAIN) {
+        printf("Failed to read GPIO edges due to %s.\n", strerror(errno));
+        return -1;
+    }
+    return edges;
+}
+
+void VL53LX_gpio_release(int fd){
+    if (fd >= 0)
+        close(fd);
+}
@@ -43,11 +43,11 @@ VL53LX_Error VL53LX_platform_init(
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioXshutdown(0);
+		status = VL53LX_GpioXshutdown(pdev, 0);
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioPowerEnable(0);
+		status = VL53LX_GpioPowerEnable(pdev, 0);
 
 
 	if (status == VL53LX_ERROR_NONE)
@@ -59,7 +59,7 @@ VL53LX_Error VL53LX_platform_init(
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioPowerEnable(1);
+		status = VL53LX_GpioPowerEnable(pdev, 1);
 
 
 	if (status == VL53LX_ERROR_NONE)
@@ -67,7 +67,7 @@ VL53LX_Error VL53LX_platform_init(
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioXshutdown(1);
+		status = VL53LX_GpioXshutdown(pdev, 1);
 
 
 	if (status == VL53LX_ERROR_NONE)
@@ -86,11 +86,11 @@ VL53LX_Error VL53LX_platform_terminate(
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioXshutdown(0);
+		status = VL53LX_GpioXshutdown(pdev, 0);
 
 
 	if (status == VL53LX_ERROR_NONE)
-		status = VL53LX_GpioPowerEnable(0);
+		status = VL53LX_GpioPowerEnable(pdev, 0);
 
 
 	if (status == VL53LX_ERROR_NONE)
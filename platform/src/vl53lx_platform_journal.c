@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include "vl53lx_api.h"
+#include "vl53lx_platform_journal.h"
+
+#define JOURNAL_WAIT_MS         100
+
+static uint64_t clock_ns(clockid_t clock){
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t frame_size(const VL53LX_WireFrame_t *pwf){
+    return sizeof(VL53LX_WireFrame_t) + ((pwf->flags & VL53LX_WIRE_FLAG_RAW) ? sizeof(VL53LX_WireRaw_t) : 0);
+}
+
+static VL53LX_JournalHeader_t *segment_header(VL53LX_Journal_t *pl){
+    return (VL53LX_JournalHeader_t *)pl->map;
+}
+
+// Truncates the finished segment to the frames it holds
+static void segment_close(VL53LX_Journal_t *pl){
+    VL53LX_JournalHeader_t *ph = segment_header(pl);
+    uint64_t size;
+
+    if (pl->map == NULL)
+        return;
+    size = ph->data_offset + atomic_load(&ph->used);
+    munmap(pl->map, pl->segment_size);
+    if (ftruncate(pl->fd, size) != 0)
+        printf("Failed to truncate journal segment %u due to %s.\n", pl->segment, strerror(errno));
+    close(pl->fd);
+    pl->map = NULL;
+    pl->segment++;
+}
+
+static int segment_open(VL53LX_Journal_t *pl){
+    VL53LX_JournalHeader_t *ph;
+    uint32_t index_capacity = pl->segment_size / VL53LX_JOURNAL_INDEX_STRIDE + 1;
+    uint64_t data_offset;
+    char path[sizeof(pl->path) + 8];
+    long page = sysconf(_SC_PAGESIZE);
+    int rc;
+
+    data_offset = sizeof(VL53LX_JournalHeader_t) + sizeof(VL53LX_JournalSensor_t) * pl->sensor_count +
+                  sizeof(VL53LX_JournalIndex_t) * index_capacity;
+    data_offset = (data_offset + page - 1) / page * page;
+
+    snprintf(path, sizeof(path), "%s.%04u", pl->path, pl->segment);
+    pl->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (pl->fd < 0) {
+        printf("Failed to create journal segment %s due to %s.\n", path, strerror(errno));
+        return -1;
+    }
+    // Blocks are allocated up front, writing a frame never extends the file
+    rc = posix_fallocate(pl->fd, 0, pl->segment_size);
+    if (rc != 0) {
+        printf("Failed to allocate journal segment %s due to %s.\n", path, strerror(rc));
+        close(pl->fd);
+        return -1;
+    }
+    pl->map = mmap(NULL, pl->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, pl->fd, 0);
+    if (pl->map == MAP_FAILED) {
+        printf("Failed to map journal segment %s due to %s.\n", path, strerror(errno));
+        pl->map = NULL;
+        close(pl->fd);
+        return -1;
+    }
+    madvise(pl->map, pl->segment_size, MADV_SEQUENTIAL);
+
+    ph = segment_header(pl);
+    ph->version = VL53LX_JOURNAL_VERSION;
+    ph->segment = pl->segment;
+    ph->sensor_count = pl->sensor_count;
+    ph->index_capacity = index_capacity;
+    ph->data_offset = data_offset;
+    ph->segment_size = pl->segment_size;
+    ph->start_ns = pl->start_ns;
+    ph->start_realtime_ns = pl->start_realtime_ns;
+    atomic_init(&ph->used, 0);
+    atomic_init(&ph->index_count, 0);
+    memcpy(ph + 1, pl->sensor, sizeof(VL53LX_JournalSensor_t) * pl->sensor_count);
+    memcpy(ph->magic, VL53LX_JOURNAL_MAGIC, sizeof(ph->magic));
+    pl->next_index = 0;
+    return 0;
+}
+
+static void journal_write(VL53LX_Journal_t *pl, const VL53LX_WireFrame_t *pwf){
+    VL53LX_JournalHeader_t *ph;
+    VL53LX_JournalIndex_t *pindex;
+    uint32_t len = frame_size(pwf);
+    uint64_t used, timestamp_ns = le64toh(pwf->timestamp_ns);
+    uint32_t count;
+
+    ph = segment_header(pl);
+    if (pl->map != NULL && ph->data_offset + atomic_load(&ph->used) + len > pl->segment_size)
+        segment_close(pl);
+    // A segment that could not be created ends the journal
+    if (pl->map == NULL && (pl->errors > 0 || segment_open(pl) != 0)) {
+        pl->errors++;
+        return;
+    }
+
+    ph = segment_header(pl);
+    used = atomic_load_explicit(&ph->used, memory_order_relaxed);
+    memcpy(pl->map + ph->data_offset + used, pwf, len);
+
+    if (timestamp_ns > pl->latest_ns)
+        pl->latest_ns = timestamp_ns;
+    count = atomic_load_explicit(&ph->index_count, memory_order_relaxed);
+    if (used >= pl->next_index && count < ph->index_capacity) {
+        pindex = (VL53LX_JournalIndex_t *)((uint8_t *)(ph + 1) + sizeof(VL53LX_JournalSensor_t) * ph->sensor_count);
+        pindex[count].timestamp_ns = pl->latest_ns;
+        pindex[count].offset = ph->data_offset + used;
+        atomic_store_explicit(&ph->index_count, count + 1, memory_order_release);
+        pl->next_index = (used / VL53LX_JOURNAL_INDEX_STRIDE + 1) * VL53LX_JOURNAL_INDEX_STRIDE;
+    }
+
+    // Readers trust the frames up to used
+    atomic_store_explicit(&ph->used, used + len, memory_order_release);
+    pl->frames++;
+}
+
+static void *journal_main(void *arg){
+    VL53LX_Journal_t *pl = arg;
+    _Alignas(8) uint8_t frame[VL53LX_WIRE_MAX_SIZE];
+    struct pollfd pfd = {pl->queue.notify_fd, POLLIN, 0};
+    uint64_t pushes;
+    int running;
+
+    do {
+        running = pl->running;
+        poll(&pfd, 1, JOURNAL_WAIT_MS);
+        if (read(pfd.fd, &pushes, sizeof(pushes)) < 0)
+            pushes = 0;
+        // Whatever was queued before stopping still gets written
+        while (VL53LX_ring_pop(&pl->queue, frame))
+            journal_write(pl, (const VL53LX_WireFrame_t *)frame);
+    } while (running);
+    return NULL;
+}
+
+VL53LX_Error VL53LX_journal_add_sensor(VL53LX_Journal_t *pl, uint8_t sensor_id, VL53LX_Sensor_t *ps){
+    VL53LX_DEV Dev = &ps->dev;
+    VL53LX_JournalSensor_t *pjs;
+    VL53LX_DistanceModes distance_mode;
+    VL53LX_Error status;
+
+    if (pl->sensor_count == VL53LX_JOURNAL_MAX_SENSORS)
+        return VL53LX_ERROR_INVALID_PARAMS;
+
+    pjs = &pl->sensor[pl->sensor_count];
+    memset(pjs, 0, sizeof(*pjs));
+    memcpy(pjs->name, ps->config.name, sizeof(pjs->name));
+    pjs->sensor_id = sensor_id;
+    pjs->address = Dev->i2c_slave_address;
+    pjs->raw = ps->config.raw;
+    pjs->preset_mode = VL53LXDevStructGetLLDriverHandle(Dev)->preset_mode;
+
+    status = VL53LX_GetDistanceMode(Dev, &distance_mode);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GetMeasurementTimingBudgetMicroSeconds(Dev, &pjs->timing_budget_us);
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_GetCalibrationData(Dev, &pjs->calibration);
+    if (status != VL53LX_ERROR_NONE)
+        return status;
+
+    pjs->distance_mode = distance_mode;
+    pl->sensor_count++;
+    return VL53LX_ERROR_NONE;
+}
+
+int VL53LX_journal_start(VL53LX_Journal_t *pl, const char *path, uint64_t segment_size){
+    sigset_t all, old;
+    int rc;
+
+    snprintf(pl->path, sizeof(pl->path), "%s", path);
+    pl->segment_size = segment_size < VL53LX_JOURNAL_MIN_SEGMENT_SIZE ? VL53LX_JOURNAL_MIN_SEGMENT_SIZE : segment_size;
+    pl->start_ns = clock_ns(CLOCK_MONOTONIC);
+    pl->start_realtime_ns = clock_ns(CLOCK_REALTIME);
+    pl->map = NULL;
+    pl->segment = 0;
+    pl->latest_ns = 0;
+    pl->frames = 0;
+    pl->errors = 0;
+
+    // Opening the first segment here reports a bad path at once
+    if (segment_open(pl) != 0)
+        return -1;
+    if (VL53LX_ring_init(&pl->queue, VL53LX_WIRE_MAX_SIZE, VL53LX_JOURNAL_QUEUE_FRAMES, VL53LX_RING_DROP_OLDEST) != 0) {
+        segment_close(pl);
+        return -1;
+    }
+    pl->queue.notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pl->running = 1;
+
+    // The thread inherits the mask, signals stay with the caller
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    rc = pthread_create(&pl->thread, NULL, journal_main, pl);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        printf("Failed to start the journal thread due to %s.\n", strerror(rc));
+        close(pl->queue.notify_fd);
+        VL53LX_ring_free(&pl->queue);
+        segment_close(pl);
+        return -1;
+    }
+    return 0;
+}
+
+void VL53LX_journal_append(VL53LX_Journal_t *pl, const VL53LX_Frame_t *pframe, uint8_t sensor_id){
+    void *slot = VL53LX_ring_claim(&pl->queue, 0);
+
+    if (slot == NULL)
+        return;
+    VL53LX_wire_encode(pframe, sensor_id, slot);
+    VL53LX_ring_push(&pl->queue);
+}
+
+void VL53LX_journal_stop(VL53LX_Journal_t *pl){
+    pl->running = 0;
+    pthread_join(pl->thread, NULL);
+    segment_close(pl);
+    close(pl->queue.notify_fd);
+    VL53LX_ring_free(&pl->queue);
+}
+
+uint32_t VL53LX_journal_dropped(VL53LX_Journal_t *pl){
+    return VL53LX_ring_overflows(&pl->queue);
+}
+
+int VL53LX_journal_map(const char *path, VL53LX_JournalSegment_t *pseg){
+    const VL53LX_JournalHeader_t *ph;
+    struct stat st;
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Failed to open %s due to %s.\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(VL53LX_JournalHeader_t)) {
+        printf("Failed to open %s, not a journal segment.\n", path);
+        close(fd);
+        return -1;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Failed to map %s due to %s.\n", path, strerror(errno));
+        return -1;
+    }
+
+    ph = base;
+    if (memcmp(ph->magic, VL53LX_JOURNAL_MAGIC, sizeof(ph->magic)) != 0 || ph->version != VL53LX_JOURNAL_VERSION ||
+        ph->data_offset > (uint64_t)st.st_size || ph->sensor_count > VL53LX_JOURNAL_MAX_SENSORS) {
+        printf("Failed to open %s, not a version %d journal segment.\n", path, VL53LX_JOURNAL_VERSION);
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    pseg->base = base;
+    pseg->size = st.st_size;
+    pseg->header = ph;
+    pseg->sensor = (const VL53LX_JournalSensor_t *)(ph + 1);
+    pseg->index = (const VL53LX_JournalIndex_t *)(pseg->sensor + ph->sensor_count);
+    return 0;
+}
+
+void VL53LX_journal_unmap(VL53LX_JournalSegment_t *pseg){
+    munmap((void *)pseg->base, pseg->size);
+    pseg->base = NULL;
+}
+
+uint64_t VL53LX_journal_seek(const VL53LX_JournalSegment_t *pseg, uint64_t timestamp_ns){
+    const VL53LX_WireFrame_t *pwf;
+    uint32_t lo = 0, hi, mid;
+    uint64_t offset, frame;
+
+    // Last entry before timestamp_ns, every frame ahead of it is earlier
+    hi = atomic_load_explicit(&((VL53LX_JournalHeader_t *)pseg->header)->index_count, memory_order_acquire);
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (pseg->index[mid].timestamp_ns < timestamp_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    offset = lo > 0 ? pseg->index[lo - 1].offset : pseg->header->data_offset;
+
+    for (;;) {
+        frame = offset;
+        pwf = VL53LX_journal_next(pseg, &offset);
+        if (pwf == NULL || le64toh(pwf->timestamp_ns) >= timestamp_ns)
+            return frame;
+    }
+}
+
+const VL53LX_WireFrame_t *VL53LX_journal_next(const VL53LX_JournalSegment_t *pseg, uint64_t *poffset){
+    VL53LX_JournalHeader_t *ph = (VL53LX_JournalHeader_t *)pseg->header;
+    const VL53LX_WireFrame_t *pwf;
+    uint64_t end;
+
+    end = ph->data_offset + atomic_load_explicit(&ph->used, memory_order_acquire);
+    if (end > pseg->size)
+        end = pseg->size;
+    if (*poffset + sizeof(VL53LX_WireFrame_t) > end)
+        return NULL;
+
+    pwf = (const VL53LX_WireFrame_t *)(pseg->base + *poffset);
+    if (le16toh(pwf->magic) != VL53LX_WIRE_MAGIC || *poffset + frame_size(pwf) > end)
+        return NULL;
+    *poffset += frame_size(pwf);
+    return pwf;
+}
@@ -0,0 +1,305 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "vl53lx_platform_metrics.h"
+
+#define METRICS_PREFIX          "vl53lx_"
+
+// Appends to the text, growing it as needed. What does not fit after a
+// failed allocation is left out
+static void append(VL53LX_Metrics_t *pm, const char *format, ...){
+    va_list args;
+    uint32_t size;
+    char *text;
+    int len;
+
+    for (;;) {
+        va_start(args, format);
+        len = vsnprintf(pm->text + pm->len, pm->size - pm->len, format, args);
+        va_end(args);
+        if (len < 0)
+            return;
+        if (pm->len + len < pm->size) {
+            pm->len += len;
+            return;
+        }
+        size = pm->size * 2;
+        text = realloc(pm->text, size);
+        if (text == NULL) {
+            pm->text[pm->len] = '\0';
+            return;
+        }
+        pm->text = text;
+        pm->size = size;
+    }
+}
+
+// Drops the connection being served
+static void hang_up(VL53LX_Metrics_t *pm){
+    close(pm->conn);
+    pm->conn = -1;
+    pm->sending = 0;
+}
+
+// Takes in what the client sent so far
+//
+// @return  1 once the request is complete, 0 while more is due, -1 when
+//          the client went away
+static int receive(VL53LX_Metrics_t *pm){
+    ssize_t got;
+
+    // Only the request line matters, the headers are read to not reset the
+    // connection by closing it with unread data
+    while (pm->request_len < sizeof(pm->request) - 1) {
+        got = recv(pm->conn, pm->request + pm->request_len,
+                   sizeof(pm->request) - 1 - pm->request_len, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        if (got <= 0)
+            return -1;
+        pm->request_len += got;
+        pm->request[pm->request_len] = '\0';
+        if (strstr(pm->request, "\r\n\r\n") != NULL)
+            return 1;
+    }
+    return 1;
+}
+
+// Sends as much of the reply as the socket takes
+//
+// @return  1 once all of it is sent, 0 while more is due, -1 when the
+//          client went away
+static int transmit(VL53LX_Metrics_t *pm){
+    struct iovec iov[2];
+    struct msghdr msg;
+    uint32_t total = pm->header_len + pm->len;
+    ssize_t sent;
+
+    while (pm->sent < total) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        if (pm->sent < pm->header_len) {
+            iov[0].iov_base = pm->header + pm->sent;
+            iov[0].iov_len = pm->header_len - pm->sent;
+            iov[1].iov_base = pm->text;
+            iov[1].iov_len = pm->len;
+            msg.msg_iovlen = 2;
+        } else {
+            iov[0].iov_base = pm->text + (pm->sent - pm->header_len);
+            iov[0].iov_len = total - pm->sent;
+            msg.msg_iovlen = 1;
+        }
+        sent = sendmsg(pm->conn, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        if (sent <= 0)
+            return -1;
+        pm->sent += sent;
+    }
+    return 1;
+}
+
+// Starts sending the header and the text, what the socket does not take
+// right away goes out as it becomes writable
+static void respond(VL53LX_Metrics_t *pm, const char *status){
+    int rc;
+
+    pm->header_len = snprintf(pm->header, sizeof(pm->header),
+                              "HTTP/1.1 %s\r\n"
+                              "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                              "Content-Length: %u\r\n"
+                              "Connection: close\r\n\r\n",
+                              status, pm->len);
+    pm->sent = 0;
+    pm->sending = 1;
+    rc = transmit(pm);
+    if (rc != 0)
+        hang_up(pm);
+}
+
+int VL53LX_metrics_open(VL53LX_Metrics_t *pm, const char *address){
+    struct addrinfo hints, *res = NULL;
+    char host[256];
+    const char *port = strrchr(address, ':');
+    int one = 1;
+    int rc;
+
+    memset(pm, 0, sizeof(*pm));
+    pm->fd = -1;
+    pm->conn = -1;
+    if (port == NULL) {
+        snprintf(host, sizeof(host), "%s", VL53LX_METRICS_DEFAULT_HOST);
+        port = address;
+    } else {
+        snprintf(host, sizeof(host), "%.*s", (int)(port - address), address);
+        port++;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    rc = getaddrinfo(strcmp(host, "*") == 0 ? NULL : host, port, &hints, &res);
+    if (rc != 0) {
+        printf("Failed to resolve metrics address %s due to %s.\n", address, gai_strerror(rc));
+        return -1;
+    }
+
+    pm->fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (pm->fd >= 0)
+        setsockopt(pm->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (pm->fd < 0 || bind(pm->fd, res->ai_addr, res->ai_addrlen) != 0 || listen(pm->fd, 4) != 0) {
+        printf("Failed to listen for metrics on %s due to %s.\n", address, strerror(errno));
+        freeaddrinfo(res);
+        VL53LX_metrics_close(pm);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    pm->size = VL53LX_METRICS_INITIAL_SIZE;
+    pm->text = malloc(pm->size);
+    if (pm->text == NULL) {
+        printf("Failed to allocate the metrics text due to %s.\n", strerror(errno));
+        VL53LX_metrics_close(pm);
+        return -1;
+    }
+    return 0;
+}
+
+void VL53LX_metrics_close(VL53LX_Metrics_t *pm){
+    if (pm->conn >= 0)
+        hang_up(pm);
+    if (pm->fd >= 0)
+        close(pm->fd);
+    pm->fd = -1;
+    free(pm->text);
+    pm->text = NULL;
+}
+
+int VL53LX_metrics_fd(const VL53LX_Metrics_t *pm){
+    return pm->conn >= 0 ? pm->conn : pm->fd;
+}
+
+int VL53LX_metrics_sending(const VL53LX_Metrics_t *pm){
+    return pm->sending;
+}
+
+int VL53LX_metrics_serve(VL53LX_Metrics_t *pm, int ready, uint64_t now_ns){
+    int rc;
+
+    if (pm->conn >= 0 && now_ns >= pm->deadline_ns) {
+        hang_up(pm);
+        return 0;
+    }
+    if (!ready)
+        return 0;
+
+    if (pm->conn < 0) {
+        pm->conn = accept4(pm->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (pm->conn < 0)
+            return 0;
+        pm->deadline_ns = now_ns + VL53LX_METRICS_TIMEOUT_MS * 1000000ULL;
+        pm->request_len = 0;
+        pm->request[0] = '\0';
+    }
+
+    if (pm->sending) {
+        rc = transmit(pm);
+        if (rc != 0)
+            hang_up(pm);
+        return 0;
+    }
+
+    rc = receive(pm);
+    if (rc < 0)
+        hang_up(pm);
+    if (rc <= 0)
+        return 0;
+    pm->len = 0;
+    pm->text[0] = '\0';
+    if (strncmp(pm->request, "GET ", 4) != 0) {
+        respond(pm, "405 Method Not Allowed");
+        return 0;
+    }
+    return 1;
+}
+
+void VL53LX_metrics_family(VL53LX_Metrics_t *pm, const char *name, const char *type,
+    const char *help){
+
+    append(pm, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n", name, help, name, type);
+}
+
+void VL53LX_metrics_sample(VL53LX_Metrics_t *pm, const char *name, const char *labels,
+    double value){
+
+    if (labels[0])
+        append(pm, METRICS_PREFIX "%s{%s} %.15g\n", name, labels, value);
+    else
+        append(pm, METRICS_PREFIX "%s %.15g\n", name, value);
+}
+
+void VL53LX_metrics_histogram(VL53LX_Metrics_t *pm, const char *name, const char *labels,
+    const VL53LX_ProfileStage_t *pst){
+
+    const char *comma = labels[0] ? "," : "";
+    char series[128];
+    uint64_t below = 0;
+    int b;
+
+    // The last bucket also holds everything longer, it is +Inf
+    for (b = 0; b < VL53LX_PROFILE_BUCKETS - 1; b++) {
+        below += pst->histogram[b];
+        append(pm, METRICS_PREFIX "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, comma,
+               (double)(2ULL << b) / 1e9, (unsigned long long)below);
+    }
+    append(pm, METRICS_PREFIX "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, comma, pst->count);
+    snprintf(series, sizeof(series), "%s_sum", name);
+    VL53LX_metrics_sample(pm, series, labels, (double)pst->total_ns / 1e9);
+    snprintf(series, sizeof(series), "%s_count", name);
+    VL53LX_metrics_sample(pm, series, labels, pst->count);
+}
+
+int VL53LX_metrics_label(char *labels, size_t size, const char *name, const char *value){
+    size_t start = strlen(labels);
+    size_t len = start;
+    int n;
+
+    n = snprintf(labels + len, size - len, "%s%s=\"", len ? "," : "", name);
+    if (n < 0 || (size_t)n >= size - len)
+        goto too_small;
+    len += n;
+    for (; *value; value++) {
+        if (len + 3 >= size)
+            goto too_small;
+        if (*value == '\\' || *value == '"' || *value == '\n') {
+            labels[len++] = '\\';
+            labels[len++] = *value == '\n' ? 'n' : *value;
+        } else {
+            labels[len++] = *value;
+        }
+    }
+    labels[len++] = '"';
+    labels[len] = '\0';
+    return 0;
+
+too_small:
+    labels[start] = '\0';
+    return -1;
+}
+
+void VL53LX_metrics_reply(VL53LX_Metrics_t *pm){
+    respond(pm, "200 OK");
+    pm->scrapes++;
+}
@@ -0,0 +1,339 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "vl53lx_platform_multi.h"
+#include "vl53lx_platform_capture.h"
+#include "vl53lx_platform_sim.h"
+#include "vl53lx_api.h"
+
+#define DEFAULT_ADDRESS      0x29
+#define IDLE_WAIT_NS         100000000ULL
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int VL53LX_multi_parse_sensor(VL53LX_SensorConfig_t *pconfig, const char *spec){
+    char buf[256];
+    char *save = NULL;
+    char *item;
+    char *value;
+    const char *colon = strchr(spec, ':');
+    size_t name_len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    memset(pconfig, 0, sizeof(*pconfig));
+    pconfig->xshut_line = -1;
+    pconfig->power_line = -1;
+    pconfig->irq_line = -1;
+
+    if (name_len == 0 || name_len >= sizeof(pconfig->name)) {
+        printf("Invalid sensor name in %s\n", spec);
+        return -1;
+    }
+    memcpy(pconfig->name, spec, name_len);
+    if (colon == NULL)
+        return 0;
+
+    snprintf(buf, sizeof(buf), "%s", colon + 1);
+    for (item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        value = strchr(item, '=');
+        if (value == NULL) {
+            printf("Expected KEY=VALUE in sensor %s, got %s\n", pconfig->name, item);
+            return -1;
+        }
+        *value++ = '\0';
+        if (strcmp(item, "xshut") == 0) {
+            pconfig->xshut_line = atoi(value);
+        } else if (strcmp(item, "power") == 0) {
+            pconfig->power_line = atoi(value);
+        } else if (strcmp(item, "irq") == 0) {
+            pconfig->irq_line = atoi(value);
+        } else if (strcmp(item, "raw") == 0) {
+            pconfig->raw = atoi(value) != 0;
+        } else if (strcmp(item, "address") == 0) {
+            pconfig->address = (uint8_t)strtol(value, NULL, 16);
+            if (pconfig->address < 0x08 || pconfig->address > 0x77) {
+                printf("Invalid address %s for sensor %s\n", value, pconfig->name);
+                return -1;
+            }
+        } else {
+            printf("Unknown sensor key %s\n", item);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Explicit addresses first, the others take the next free ones
+static void assign_addresses(VL53LX_MultiSensor_t *pm, uint8_t *paddress){
+    uint8_t next = VL53LX_MULTI_BASE_ADDRESS;
+    int i, j, used;
+
+    for (i = 0; i < pm->count; i++)
+        paddress[i] = pm->sensor[i].config.address;
+    if (pm->count == 1 && paddress[0] == 0) {
+        paddress[0] = DEFAULT_ADDRESS;
+        return;
+    }
+    for (i = 0; i < pm->count; i++) {
+        if (paddress[i] != 0)
+            continue;
+        do {
+            used = 0;
+            for (j = 0; j < pm->count; j++)
+                used |= pm->sensor[j].config.address == next;
+            if (used)
+                next++;
+        } while (used);
+        paddress[i] = next++;
+    }
+}
+
+// Whether VL53LX_PowerOff() shuts the sensor down
+static int switched(const VL53LX_Sensor_t *ps){
+    return ps->dev.power_lines_set && (ps->dev.xshut_line >= 0 || ps->dev.power_line >= 0);
+}
+
+static VL53LX_Error bring_up(VL53LX_MultiSensor_t *pm, VL53LX_Sensor_t *ps, uint8_t address){
+    VL53LX_DEV Dev = &ps->dev;
+    VL53LX_Error status = VL53LX_ERROR_NONE;
+
+    status = VL53LX_PowerOn(Dev);
+    VL53LX_EnableRegisterShadow(Dev, ps->config.shadow);
+
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_WaitDeviceBooted(Dev);
+    if (status == VL53LX_ERROR_NONE && address != DEFAULT_ADDRESS) {
+        // The API takes the 8-bit form of the address
+        status = VL53LX_SetDeviceAddress(Dev, address << 1);
+        if (status == VL53LX_ERROR_NONE)
+            Dev->i2c_slave_address = address;
+    }
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_DataInit(Dev);
+    if (status == VL53LX_ERROR_NONE && ps->config.irq_line >= 0)
+        status = VL53LX_EnableInterrupt(Dev, pm->gpio_chip, ps->config.irq_line);
+
+    if (status != VL53LX_ERROR_NONE)
+        printf("Failed to bring up sensor %s at 0x%02X: %d\n", ps->config.name, address, status);
+    return status;
+}
+
+VL53LX_Error VL53LX_multi_init(VL53LX_MultiSensor_t *pm, const char *bus, const char *chip,
+    const VL53LX_SensorConfig_t *pconfig, uint8_t count){
+
+    uint8_t address[VL53LX_MULTI_MAX_SENSORS];
+    VL53LX_Sensor_t *ps;
+    VL53LX_Error status = VL53LX_ERROR_NONE;
+    int sim = strncmp(bus, "sim:", 4) == 0;
+    int gpio = !sim && strncmp(bus, "replay:", 7) != 0;
+    int unwired = -1;
+    int i;
+
+    memset(pm, 0, sizeof(*pm));
+    pm->shared_fd = -1;
+    if (count == 0 || count > VL53LX_MULTI_MAX_SENSORS) {
+        printf("Between 1 and %d sensors are supported.\n", VL53LX_MULTI_MAX_SENSORS);
+        return VL53LX_ERROR_INVALID_PARAMS;
+    }
+    pm->count = count;
+    snprintf(pm->gpio_chip, sizeof(pm->gpio_chip), "%s", chip);
+
+    for (i = 0; i < count; i++) {
+        ps = &pm->sensor[i];
+        ps->config = pconfig[i];
+        ps->dev.fd = -1;
+        if (gpio && ps->config.xshut_line < 0 && ps->config.power_line < 0) {
+            // Only one sensor can answer at 0x29 while the others are held
+            if (unwired >= 0) {
+                printf("Sensors %s and %s both lack an XSHUT and a power line.\n",
+                    pm->sensor[unwired].config.name, ps->config.name);
+                pm->count = 0;
+                return VL53LX_ERROR_INVALID_PARAMS;
+            }
+            unwired = i;
+        }
+    }
+    assign_addresses(pm, address);
+
+    if (!sim) {
+        pm->shared_fd = VL53LX_i2c_init((char *)bus, DEFAULT_ADDRESS);
+        if (pm->shared_fd < 0) {
+            pm->count = 0;
+            return VL53LX_ERROR_CONTROL_INTERFACE;
+        }
+    }
+    for (i = 0; i < count && status == VL53LX_ERROR_NONE; i++) {
+        ps = &pm->sensor[i];
+        ps->dev.i2c_slave_address = DEFAULT_ADDRESS;
+        ps->dev.fd = sim ? VL53LX_i2c_init((char *)bus, DEFAULT_ADDRESS) : pm->shared_fd;
+        if (ps->dev.fd < 0)
+            status = VL53LX_ERROR_CONTROL_INTERFACE;
+    }
+
+    // Hold every wired sensor in reset, VL53LX_PowerOn() then releases them
+    // one at a time
+    for (i = 0; i < count && status == VL53LX_ERROR_NONE && gpio; i++) {
+        ps = &pm->sensor[i];
+        VL53LX_GpioSetLines(&ps->dev, chip, ps->config.xshut_line, ps->config.power_line);
+        status = VL53LX_PowerOff(&ps->dev);
+    }
+
+    // The sensor without XSHUT sits at 0x29 already and moves first
+    if (status == VL53LX_ERROR_NONE && unwired >= 0)
+        status = bring_up(pm, &pm->sensor[unwired], address[unwired]);
+    for (i = 0; i < count && status == VL53LX_ERROR_NONE; i++) {
+        if (i != unwired)
+            status = bring_up(pm, &pm->sensor[i], address[i]);
+    }
+
+    if (status != VL53LX_ERROR_NONE)
+        VL53LX_multi_close(pm);
+    return status;
+}
+
+VL53LX_Error VL53LX_multi_start(VL53LX_MultiSensor_t *pm){
+    VL53LX_Error status = VL53LX_ERROR_NONE;
+    VL53LX_PlatformStats_t before, after;
+    VL53LX_Sensor_t *ps;
+    uint32_t budget_us;
+    int i;
+
+    for (i = 0; i < pm->count && status == VL53LX_ERROR_NONE; i++) {
+        ps = &pm->sensor[i];
+        VL53LX_GetMeasurementTimingBudgetMicroSeconds(&ps->dev, &budget_us);
+        VL53LX_deadline_init(&ps->deadline, budget_us);
+        // A missed edge only costs one timeout
+        ps->irq_timeout_ns = (2 * (uint64_t)budget_us + 100000) * 1000;
+        ps->last_ready_ns = now_ns();
+        VL53LX_GetPlatformStats(&ps->dev, &before);
+        status = VL53LX_StartMeasurement(&ps->dev);
+        VL53LX_GetPlatformStats(&ps->dev, &after);
+        __atomic_store_n(&ps->start_bytes_elided, after.bytes_elided - before.bytes_elided, __ATOMIC_RELAXED);
+    }
+    pm->started = 1;
+    return status;
+}
+
+VL53LX_Error VL53LX_multi_stop(VL53LX_MultiSensor_t *pm){
+    VL53LX_Error status = VL53LX_ERROR_NONE;
+    int i;
+
+    for (i = 0; i < pm->count; i++) {
+        if (VL53LX_StopMeasurement(&pm->sensor[i].dev) != VL53LX_ERROR_NONE)
+            status = VL53LX_ERROR_CONTROL_INTERFACE;
+    }
+    pm->started = 0;
+    return status;
+}
+
+uint32_t VL53LX_multi_wait(VL53LX_MultiSensor_t *pm, int32_t poll_period_ms){
+    struct pollfd pfd[VL53LX_MULTI_MAX_SENSORS];
+    int owner[VL53LX_MULTI_MAX_SENSORS];
+    VL53LX_Sensor_t *ps;
+    struct timespec ts;
+    uint64_t now = now_ns();
+    uint64_t wake = now + IDLE_WAIT_NS;
+    uint64_t due;
+    uint32_t mask = 0;
+    int nfds = 0;
+    int polled = 0;
+    int i, fd;
+
+    for (i = 0; i < pm->count; i++) {
+        ps = &pm->sensor[i];
+        fd = VL53LX_GetInterruptFd(&ps->dev);
+        if (fd >= 0) {
+            pfd[nfds].fd = fd;
+            pfd[nfds].events = POLLIN;
+            owner[nfds++] = i;
+            due = ps->last_ready_ns + ps->irq_timeout_ns;
+        } else if (poll_period_ms >= 0) {
+            due = now + (uint64_t)poll_period_ms * 1000000;
+            polled = 1;
+        } else {
+            due = VL53LX_deadline_next_ns(&ps->deadline);
+        }
+        if (due < wake)
+            wake = due;
+    }
+
+    if (wake > now) {
+        ts.tv_sec = (wake - now) / 1000000000ULL;
+        ts.tv_nsec = (wake - now) % 1000000000ULL;
+        if (ppoll(pfd, nfds, &ts, NULL) < 0 && errno != EINTR)
+            printf("Failed to wait for the sensors due to %s.\n", strerror(errno));
+    } else if (nfds > 0) {
+        // Still collect the edges that are pending
+        ts.tv_sec = 0;
+        ts.tv_nsec = 0;
+        ppoll(pfd, nfds, &ts, NULL);
+    }
+    now = now_ns();
+
+    for (i = 0; i < nfds; i++) {
+        ps = &pm->sensor[owner[i]];
+        if (pfd[i].revents & POLLIN)
+            VL53LX_WaitInterrupt(&ps->dev, 0);
+        if ((pfd[i].revents & POLLIN) || now >= ps->last_ready_ns + ps->irq_timeout_ns)
+            mask |= 1 << owner[i];
+    }
+    for (i = 0; i < pm->count; i++) {
+        ps = &pm->sensor[i];
+        if (VL53LX_GetInterruptFd(&ps->dev) >= 0)
+            continue;
+        if (polled) {
+            mask |= 1 << i;
+        } else if (now >= VL53LX_deadline_next_ns(&ps->deadline)) {
+            VL53LX_deadline_polled(&ps->deadline);
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+void VL53LX_multi_ready(VL53LX_MultiSensor_t *pm, uint8_t sensor){
+    VL53LX_Sensor_t *ps = &pm->sensor[sensor];
+
+    VL53LX_deadline_ready(&ps->deadline);
+    ps->last_ready_ns = now_ns();
+}
+
+void VL53LX_multi_close(VL53LX_MultiSensor_t *pm){
+    VL53LX_Sensor_t *ps;
+    int replay;
+    int i;
+
+    for (i = 0; i < pm->count; i++) {
+        ps = &pm->sensor[i];
+        // Sensors left powered would keep ranging
+        if (pm->started && !switched(ps) && ps->dev.fd >= 0)
+            VL53LX_StopMeasurement(&ps->dev);
+        VL53LX_DisableInterrupt(&ps->dev);
+        VL53LX_PowerOff(&ps->dev);
+        VL53LX_GpioReleaseLines(&ps->dev);
+        // Flushes a capture in progress
+        if (ps->dev.fd >= 0 && ps->dev.fd != pm->shared_fd) {
+            VL53LX_capture_close(ps->dev.fd);
+            VL53LX_sim_close(ps->dev.fd);
+        }
+    }
+    if (pm->shared_fd >= 0) {
+        // A replay closes its own file, a bus is closed once any capture
+        // of it is flushed
+        replay = VL53LX_capture_is_replay(pm->shared_fd);
+        VL53LX_capture_close(pm->shared_fd);
+        if (!replay)
+            close(pm->shared_fd);
+        pm->shared_fd = -1;
+    }
+    pm->count = 0;
+    pm->started = 0;
+}
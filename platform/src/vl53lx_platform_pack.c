@@ -0,0 +1,99 @@
+#include <string.h>
+#include "vl53lx_platform_pack.h"
+
+static void pack_flush(VL53LX_Packer_t *pk, uint32_t index){
+    VL53LX_Pack_t *pp = &pk->pack[index];
+
+    pk->flush(pk->user, pp->topic, pp->data, pp->len);
+    pk->messages++;
+
+    // Keeps the open packs first
+    *pp = pk->pack[--pk->count];
+}
+
+int VL53LX_pack_init(VL53LX_Packer_t *pk, uint32_t buffer_size, uint32_t buffer_count,
+    uint32_t max_frames, uint64_t latency_ns, VL53LX_PackFlush_t *flush, void *user){
+
+    memset(pk, 0, sizeof(*pk));
+    pk->max_frames = max_frames ? max_frames : 1;
+    pk->latency_ns = latency_ns;
+    pk->flush = flush;
+    pk->user = user;
+    return VL53LX_pool_init(&pk->pool, buffer_size, buffer_count);
+}
+
+void VL53LX_pack_free(VL53LX_Packer_t *pk){
+    VL53LX_pool_free(&pk->pool);
+}
+
+int VL53LX_pack_add(VL53LX_Packer_t *pk, const char *topic, const void *data, uint32_t len,
+    int separator, uint64_t now_ns){
+
+    uint32_t gap = separator == VL53LX_PACK_NO_SEPARATOR ? 0 : 1;
+    VL53LX_Pack_t *pp;
+    uint32_t i;
+
+    if (len + gap > pk->pool.buffer_size || strlen(topic) >= VL53LX_PACK_TOPIC_SIZE)
+        return -1;
+
+    for (i = 0; i < pk->count && strcmp(pk->pack[i].topic, topic) != 0; i++)
+        ;
+    if (i < pk->count && pk->pack[i].len + gap + len > pk->pool.buffer_size) {
+        pack_flush(pk, i);
+        i = pk->count;
+    }
+
+    pp = &pk->pack[i];
+    if (i == pk->count) {
+        if (pk->count == VL53LX_PACK_MAX_TOPICS)
+            return -1;
+        pp->data = VL53LX_pool_get(&pk->pool);
+        if (pp->data == NULL)
+            return -1;
+        strcpy(pp->topic, topic);
+        pp->len = 0;
+        pp->frames = 0;
+        pp->deadline_ns = now_ns + pk->latency_ns;
+        pp->separator = separator;
+        pk->count++;
+    }
+
+    if (pp->frames > 0 && gap)
+        pp->data[pp->len++] = (uint8_t)pp->separator;
+    memcpy(pp->data + pp->len, data, len);
+    pp->len += len;
+    pp->frames++;
+    pk->frames++;
+
+    if (pp->frames >= pk->max_frames || now_ns >= pp->deadline_ns)
+        pack_flush(pk, i);
+    return 0;
+}
+
+void VL53LX_pack_expire(VL53LX_Packer_t *pk, uint64_t now_ns){
+    uint32_t i = 0;
+
+    // A flush moves the last pack to i, which is checked next
+    while (i < pk->count) {
+        if (now_ns >= pk->pack[i].deadline_ns)
+            pack_flush(pk, i);
+        else
+            i++;
+    }
+}
+
+void VL53LX_pack_flush(VL53LX_Packer_t *pk){
+    while (pk->count > 0)
+        pack_flush(pk, pk->count - 1);
+}
+
+uint64_t VL53LX_pack_deadline(VL53LX_Packer_t *pk){
+    uint64_t deadline = 0;
+    uint32_t i;
+
+    for (i = 0; i < pk->count; i++) {
+        if (deadline == 0 || pk->pack[i].deadline_ns < deadline)
+            deadline = pk->pack[i].deadline_ns;
+    }
+    return deadline;
+}
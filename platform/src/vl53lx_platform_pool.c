@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vl53lx_platform_pool.h"
+
+#define POOL_NONE       0xFFFFFFFFu
+
+static uint32_t pool_index(VL53LX_Pool_t *pp, const void *buffer){
+    return (uint32_t)(((const uint8_t *)buffer - pp->buffers) / pp->buffer_size);
+}
+
+static void pool_push(VL53LX_Pool_t *pp, uint32_t index){
+    uint64_t head = atomic_load(&pp->free_head);
+    uint64_t update;
+
+    do {
+        pp->next[index] = (uint32_t)head;
+        update = ((head >> 32) + 1) << 32 | index;
+    } while (!atomic_compare_exchange_weak(&pp->free_head, &head, update));
+}
+
+int VL53LX_pool_init(VL53LX_Pool_t *pp, uint32_t buffer_size, uint32_t count){
+    uint32_t i;
+
+    memset(pp, 0, sizeof(*pp));
+    pp->buffer_size = (buffer_size + 7) & ~7u;
+    pp->count = count;
+    pp->buffers = aligned_alloc(64, ((size_t)pp->buffer_size * count + 63) & ~(size_t)63);
+    pp->refs = calloc(count, sizeof(*pp->refs));
+    pp->next = calloc(count, sizeof(*pp->next));
+    if (pp->buffers == NULL || pp->refs == NULL || pp->next == NULL) {
+        printf("Failed to allocate %u pool buffers.\n", count);
+        VL53LX_pool_free(pp);
+        return -1;
+    }
+
+    atomic_init(&pp->free_head, POOL_NONE);
+    atomic_init(&pp->exhausted, 0);
+    for (i = count; i > 0; i--) {
+        atomic_init(&pp->refs[i - 1], 0);
+        pool_push(pp, i - 1);
+    }
+    return 0;
+}
+
+void VL53LX_pool_free(VL53LX_Pool_t *pp){
+    free(pp->buffers);
+    free(pp->refs);
+    free(pp->next);
+    pp->buffers = NULL;
+    pp->refs = NULL;
+    pp->next = NULL;
+}
+
+void *VL53LX_pool_get(VL53LX_Pool_t *pp){
+    uint64_t head = atomic_load(&pp->free_head);
+    uint64_t update;
+    uint32_t index;
+
+    do {
+        index = (uint32_t)head;
+        if (index == POOL_NONE) {
+            atomic_fetch_add_explicit(&pp->exhausted, 1, memory_order_relaxed);
+            return NULL;
+        }
+        // next may be stale if another thread popped meanwhile, the tag
+        // then makes the swap fail
+        update = ((head >> 32) + 1) << 32 | pp->next[index];
+    } while (!atomic_compare_exchange_weak(&pp->free_head, &head, update));
+
+    atomic_store_explicit(&pp->refs[index], 1, memory_order_relaxed);
+    return pp->buffers + (size_t)index * pp->buffer_size;
+}
+
+void VL53LX_pool_ref(VL53LX_Pool_t *pp, void *buffer){
+    atomic_fetch_add_explicit(&pp->refs[pool_index(pp, buffer)], 1, memory_order_relaxed);
+}
+
+void VL53LX_pool_put(VL53LX_Pool_t *pp, void *buffer){
+    uint32_t index = pool_index(pp, buffer);
+
+    if (atomic_fetch_sub_explicit(&pp->refs[index], 1, memory_order_acq_rel) == 1)
+        pool_push(pp, index);
+}
+
+void VL53LX_pool_release(void *buffer, void *hint){
+    VL53LX_pool_put(hint, buffer);
+}
+
+int VL53LX_pool_owns(VL53LX_Pool_t *pp, const void *buffer){
+    const uint8_t *p = buffer;
+
+    return p >= pp->buffers && p < pp->buffers + (size_t)pp->buffer_size * pp->count;
+}
+
+uint32_t VL53LX_pool_exhausted(VL53LX_Pool_t *pp){
+    return atomic_load_explicit(&pp->exhausted, memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#include "vl53lx_platform_raw.h"
+#include "vl53lx_api.h"
+#include "vl53lx_register_settings.h"
+#include "vl53lx_api_core.h"
+#include "vl53lx_core.h"
+
+VL53LX_Error VL53LX_GetRawHistogramData(VL53LX_DEV Dev,
+    VL53LX_AdditionalData_t *pAdditionalData){
+
+    VL53LX_LLDriverData_t *pdev = VL53LXDevStructGetLLDriverHandle(Dev);
+    VL53LX_LLDriverResults_t *pres = VL53LXDevStructGetLLResultsHandle(Dev);
+    VL53LX_histogram_bin_data_t *pHD = &(pdev->hist_data);
+    VL53LX_zone_hist_info_t *phist_info;
+    uint8_t zid = pdev->ll_state.rd_zone_id;
+    uint8_t histo_merge_nb;
+    VL53LX_Error status;
+
+    if ((pdev->sys_ctrl.system__mode_start & VL53LX_DEVICESCHEDULERMODE_HISTOGRAM) !=
+        VL53LX_DEVICESCHEDULERMODE_HISTOGRAM)
+        return VL53LX_ERROR_MODE_NOT_SUPPORTED;
+
+    status = VL53LX_get_histogram_bin_data(Dev, pHD);
+    if (status == VL53LX_ERROR_NONE && pHD->number_of_ambient_bins == 0)
+        status = VL53LX_hist_copy_and_scale_ambient_info(&(pres->zone_hists.VL53LX_p_003[zid]), pHD);
+    // The merge count, crosstalk plane offset and range offset of this range
+    if (status == VL53LX_ERROR_NONE)
+        status = VL53LX_update_hist_post_process_config(Dev, &histo_merge_nb);
+    if (status != VL53LX_ERROR_NONE)
+        return status;
+    VL53LX_calc_max_effective_spads(pHD->roi_config__user_roi_centre_spad,
+        pHD->roi_config__user_roi_requested_global_xy_size, &(pdev->rtn_good_spads[0]),
+        (uint16_t)pdev->gen_cfg.dss_config__aperture_attenuation,
+        &(pdev->dmax_cfg.max_effective_spads));
+
+    // Ambient reference for the next range, kept as get_device_results() does
+    pHD->zone_id = zid;
+    if (zid < VL53LX_MAX_USER_ZONES) {
+        phist_info = &(pres->zone_hists.VL53LX_p_003[zid]);
+        phist_info->rd_device_state = pHD->rd_device_state;
+        phist_info->number_of_ambient_bins = pHD->number_of_ambient_bins;
+        phist_info->result__dss_actual_effective_spads = pHD->result__dss_actual_effective_spads;
+        phist_info->VL53LX_p_005 = pHD->VL53LX_p_005;
+        phist_info->total_periods_elapsed = pHD->total_periods_elapsed;
+        phist_info->ambient_events_sum = pHD->ambient_events_sum;
+    }
+
+    return VL53LX_GetAdditionalData(Dev, pAdditionalData);
+}
+
+void VL53LX_GetRawHistogramInputs(VL53LX_DEV Dev, VL53LX_RawInputs_t *pinputs){
+    VL53LX_LLDriverData_t *pdev = VL53LXDevStructGetLLDriverHandle(Dev);
+    VL53LX_hist_post_process_config_t *pHP = &(pdev->histpostprocess);
+
+    pinputs->xtalk_plane_offset_kcps = pHP->algo__crosstalk_compensation_plane_offset_kcps;
+    pinputs->range_offset_mm = pHP->range_offset_mm;
+    pinputs->max_effective_spads = pdev->dmax_cfg.max_effective_spads;
+    VL53LX_compute_histo_merge_nb(Dev, &pinputs->histo_merge_nb);
+    if (pinputs->histo_merge_nb == 0)
+        pinputs->histo_merge_nb = 1;
+}
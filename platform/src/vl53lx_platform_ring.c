@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "vl53lx_platform_ring.h"
+
+static void futex_wait(atomic_uint *word, uint32_t value, int32_t timeout_ms){
+    struct timespec ts;
+
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_PRIVATE, value, &ts, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *word){
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static uint64_t now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int VL53LX_ring_init(VL53LX_Ring_t *pr, uint32_t slot_size, uint32_t slot_count, uint8_t policy){
+    uint32_t count = 1;
+
+    while (count < slot_count)
+        count <<= 1;
+
+    memset(pr, 0, sizeof(*pr));
+    pr->slots = calloc(count, slot_size);
+    if (pr->slots == NULL) {
+        printf("Failed to allocate %u ring slots.\n", count);
+        return -1;
+    }
+    pr->slot_size = slot_size;
+    pr->mask = count - 1;
+    pr->policy = policy;
+    pr->notify_fd = -1;
+    atomic_init(&pr->head, 0);
+    atomic_init(&pr->tail, 0);
+    atomic_init(&pr->producer_waiting, 0);
+    atomic_init(&pr->overflows, 0);
+    return 0;
+}
+
+void VL53LX_ring_free(VL53LX_Ring_t *pr){
+    free(pr->slots);
+    pr->slots = NULL;
+}
+
+void *VL53LX_ring_claim(VL53LX_Ring_t *pr, int32_t timeout_ms){
+    uint32_t head = atomic_load_explicit(&pr->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&pr->tail, memory_order_acquire);
+    uint64_t deadline;
+    int64_t remaining;
+
+    if (head - tail <= pr->mask)
+        return pr->slots + (size_t)(head & pr->mask) * pr->slot_size;
+
+    // Claims retried after a timeout are still the same frame
+    if (!pr->overflowed)
+        atomic_fetch_add_explicit(&pr->overflows, 1, memory_order_relaxed);
+    pr->overflowed = 1;
+    if (pr->policy == VL53LX_RING_DROP_OLDEST) {
+        // Fails only if the consumer took the oldest slot meanwhile
+        atomic_compare_exchange_strong(&pr->tail, &tail, tail + 1);
+        return pr->slots + (size_t)(head & pr->mask) * pr->slot_size;
+    }
+
+    deadline = now_ms() + timeout_ms;
+    for (;;) {
+        // Announce the wait before the last look, the consumer checks the
+        // flag after moving tail so one of the two sees the other
+        atomic_store(&pr->producer_waiting, 1);
+        tail = atomic_load(&pr->tail);
+        remaining = (int64_t)(deadline - now_ms());
+        if (head - tail > pr->mask && remaining > 0)
+            futex_wait(&pr->tail, tail, remaining);
+        atomic_store(&pr->producer_waiting, 0);
+
+        tail = atomic_load_explicit(&pr->tail, memory_order_acquire);
+        if (head - tail <= pr->mask)
+            return pr->slots + (size_t)(head & pr->mask) * pr->slot_size;
+        if ((int64_t)(deadline - now_ms()) <= 0)
+            return NULL;
+    }
+}
+
+void VL53LX_ring_push(VL53LX_Ring_t *pr){
+    uint64_t one = 1;
+
+    pr->overflowed = 0;
+    atomic_fetch_add_explicit(&pr->head, 1, memory_order_release);
+    if (pr->notify_fd >= 0 && write(pr->notify_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        printf("Failed to signal the ring consumer due to %s.\n", strerror(errno));
+}
+
+int VL53LX_ring_pop(VL53LX_Ring_t *pr, void *out){
+    uint32_t tail = atomic_load_explicit(&pr->tail, memory_order_acquire);
+    uint32_t head;
+
+    for (;;) {
+        head = atomic_load_explicit(&pr->head, memory_order_acquire);
+        if (tail == head)
+            return 0;
+        memcpy(out, pr->slots + (size_t)(tail & pr->mask) * pr->slot_size, pr->slot_size);
+        // A failed swap means the producer dropped this slot and may be
+        // writing it, tail now holds the next one to try
+        if (atomic_compare_exchange_strong(&pr->tail, &tail, tail + 1))
+            break;
+    }
+    if (atomic_load(&pr->producer_waiting))
+        futex_wake(&pr->tail);
+    return 1;
+}
+
+uint32_t VL53LX_ring_overflows(VL53LX_Ring_t *pr){
+    return atomic_load_explicit(&pr->overflows, memory_order_relaxed);
+}
+
+uint32_t VL53LX_ring_depth(VL53LX_Ring_t *pr){
+    uint32_t tail = atomic_load_explicit(&pr->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&pr->head, memory_order_relaxed);
+
+    // A drop between the loads can leave tail ahead of head
+    return head - tail > pr->mask + 1 ? 0 : head - tail;
+}
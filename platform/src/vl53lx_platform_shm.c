@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "vl53lx_platform_shm.h"
+
+// Readers are other processes, the counters must not hide behind a lock
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64 bit atomics are not lock free");
+
+static VL53LX_ShmSlot_t *shm_slot(VL53LX_Shm_t *ps, uint64_t seq){
+    return (VL53LX_ShmSlot_t *)(ps->slots + (size_t)(seq & ps->mask) * ps->header->slot_size);
+}
+
+static int shm_map(VL53LX_Shm_t *ps, int fd, size_t size){
+    ps->header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ps->header == MAP_FAILED) {
+        printf("Failed to map shared memory due to %s.\n", strerror(errno));
+        ps->header = NULL;
+        return -1;
+    }
+    ps->size = size;
+    ps->slots = (uint8_t *)ps->header + sizeof(VL53LX_ShmHeader_t);
+    return 0;
+}
+
+int VL53LX_shm_create(VL53LX_Shm_t *ps, const char *name, uint32_t data_size, uint32_t slot_count){
+    VL53LX_ShmHeader_t *ph;
+    uint32_t slot_size, count = 1;
+    size_t size;
+    int fd;
+
+    while (count < slot_count)
+        count <<= 1;
+    slot_size = (sizeof(VL53LX_ShmSlot_t) + data_size + VL53LX_SHM_CACHE_LINE - 1) & ~(VL53LX_SHM_CACHE_LINE - 1);
+    size = sizeof(VL53LX_ShmHeader_t) + (size_t)slot_size * count;
+
+    // A fresh file so readers of a previous run see the new header only
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        printf("Failed to create shared memory %s due to %s.\n", name, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if (shm_map(ps, fd, size) != 0)
+        return -1;
+
+    // ftruncate() zeroed every slot, 0 being never written
+    ph = ps->header;
+    ph->version = VL53LX_SHM_VERSION;
+    ph->slot_size = slot_size;
+    ph->slot_count = count;
+    ph->data_size = slot_size - sizeof(VL53LX_ShmSlot_t);
+    atomic_init(&ph->head, 0);
+    atomic_init(&ph->futex, 0);
+    atomic_init(&ph->waiters, 0);
+    ps->mask = count - 1;
+    // Readers check the magic last written
+    atomic_thread_fence(memory_order_release);
+    memcpy(ph->magic, VL53LX_SHM_MAGIC, sizeof(ph->magic));
+    return 0;
+}
+
+int VL53LX_shm_open(VL53LX_Shm_t *ps, const char *name){
+    struct stat st;
+    int fd;
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Failed to open shared memory %s due to %s.\n", name, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(VL53LX_ShmHeader_t)) {
+        printf("Failed to open shared memory %s due to its size.\n", name);
+        close(fd);
+        return -1;
+    }
+    if (shm_map(ps, fd, st.st_size) != 0)
+        return -1;
+
+    if (memcmp(ps->header->magic, VL53LX_SHM_MAGIC, sizeof(ps->header->magic)) != 0 ||
+        ps->header->version != VL53LX_SHM_VERSION ||
+        sizeof(VL53LX_ShmHeader_t) + (size_t)ps->header->slot_size * ps->header->slot_count > ps->size) {
+        printf("Failed to open shared memory %s, not a version %d frame ring.\n", name, VL53LX_SHM_VERSION);
+        VL53LX_shm_close(ps, NULL);
+        return -1;
+    }
+    ps->mask = ps->header->slot_count - 1;
+    return 0;
+}
+
+void VL53LX_shm_close(VL53LX_Shm_t *ps, const char *name){
+    if (ps->header != NULL)
+        munmap(ps->header, ps->size);
+    ps->header = NULL;
+    if (name != NULL)
+        shm_unlink(name);
+}
+
+void *VL53LX_shm_claim(VL53LX_Shm_t *ps){
+    uint64_t head = atomic_load_explicit(&ps->header->head, memory_order_relaxed);
+    VL53LX_ShmSlot_t *slot = shm_slot(ps, head);
+
+    // Readers of the frame overwritten see it gone before it changes
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return slot + 1;
+}
+
+void VL53LX_shm_commit(VL53LX_Shm_t *ps, uint32_t len){
+    VL53LX_ShmHeader_t *ph = ps->header;
+    uint64_t head = atomic_load_explicit(&ph->head, memory_order_relaxed);
+    VL53LX_ShmSlot_t *slot = shm_slot(ps, head);
+
+    slot->len = len;
+    atomic_store_explicit(&slot->seq, head + 1, memory_order_release);
+    atomic_store_explicit(&ph->head, head + 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&ph->futex, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&ph->waiters, memory_order_seq_cst) > 0)
+        syscall(SYS_futex, &ph->futex, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+void VL53LX_shm_reader_init(VL53LX_Shm_t *ps, VL53LX_ShmReader_t *pr){
+    pr->shm = ps;
+    pr->next = atomic_load_explicit(&ps->header->head, memory_order_acquire);
+    pr->lost = 0;
+}
+
+int VL53LX_shm_read(VL53LX_ShmReader_t *pr, void *out, uint32_t size){
+    VL53LX_Shm_t *ps = pr->shm;
+    VL53LX_ShmSlot_t *slot;
+    uint64_t head, seq;
+    uint32_t len;
+
+    for (;;) {
+        head = atomic_load_explicit(&ps->header->head, memory_order_acquire);
+        if (pr->next >= head)
+            return 0;
+
+        // The slot of head is the next one written, start after it
+        if (head - pr->next >= ps->header->slot_count) {
+            pr->lost += head - ps->header->slot_count + 1 - pr->next;
+            pr->next = head - ps->header->slot_count + 1;
+        }
+
+        slot = shm_slot(ps, pr->next);
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        len = slot->len;
+        if (seq == pr->next + 1 && len <= size)
+            memcpy(out, slot + 1, len);
+        atomic_thread_fence(memory_order_acquire);
+
+        // Overwritten meanwhile, the writer lapped this reader
+        if (seq != pr->next + 1 || atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+            pr->lost++;
+            pr->next++;
+            continue;
+        }
+        if (len > size)
+            return -1;
+        pr->next++;
+        return len;
+    }
+}
+
+int VL53LX_shm_wait(VL53LX_ShmReader_t *pr, int32_t timeout_ms){
+    VL53LX_ShmHeader_t *ph = pr->shm->header;
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    unsigned int value;
+    long rc;
+
+    value = atomic_load_explicit(&ph->futex, memory_order_seq_cst);
+    if (atomic_load_explicit(&ph->head, memory_order_acquire) > pr->next)
+        return 1;
+
+    // The writer bumps futex before checking waiters, a frame written
+    // since value was read makes the wait return at once
+    atomic_fetch_add_explicit(&ph->waiters, 1, memory_order_seq_cst);
+    rc = syscall(SYS_futex, &ph->futex, FUTEX_WAIT, value, timeout_ms < 0 ? NULL : &timeout, NULL, 0);
+    atomic_fetch_sub_explicit(&ph->waiters, 1, memory_order_seq_cst);
+    if (rc != 0 && errno != EAGAIN && errno != ETIMEDOUT && errno != EINTR)
+        return -1;
+
+    return atomic_load_explicit(&ph->head, memory_order_acquire) > pr->next;
+}
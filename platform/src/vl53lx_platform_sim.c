@@ -0,0 +1,563 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "vl53lx_platform_sim.h"
+#include "vl53lx_error_codes.h"
+#include "vl53lx_register_map.h"
+#include "vl53lx_register_settings.h"
+#include "vl53lx_hist_map.h"
+#include "vl53lx_hist_structs.h"
+#include "vl53lx_nvm_map.h"
+#include "vl53lx_ll_device.h"
+#include "vl53lx_core.h"
+#include "vl53lx_core_support.h"
+
+#define SIM_REGISTER_SPACE  0x10000
+#define SIM_BINS            VL53LX_HISTOGRAM_BUFFER_SIZE
+#define SIM_GROUP_BINS      4
+#define SIM_AMBIENT_CODE    0x07
+#define SIM_PHASE_PER_BIN   2048
+#define SIM_BITS_PER_BYTE   9
+
+typedef struct {
+    int       fd;
+    uint8_t   regs[SIM_REGISTER_SPACE];
+    uint8_t   nvm[VL53LX_NVM_SIZE_IN_BYTES];
+    VL53LX_SimConfig_t config;
+    VL53LX_SimStats_t  stats;
+    int       running;      // measurement mode set, ranges follow each other
+    int       pending;      // a range is in progress
+    uint64_t  due_ns;       // when the pending range completes
+    uint32_t  range_count;  // ranges completed since the mode was started
+    uint8_t   gph_id;       // hold id the pending range was configured with
+    uint8_t   next_gph_id;  // hold id latched for the range after it
+    int       irq_fd;       // timerfd standing in for GPIO1, -1 until asked for
+    uint32_t  rng;
+} sim_t;
+
+static sim_t *sims[VL53LX_SIM_MAX_OPEN];
+static int sim_count = 0;
+
+static sim_t *sim_get(int fd){
+    int i;
+    for (i = 0; i < sim_count; i++) {
+        if (sims[i]->fd == fd)
+            return sims[i];
+    }
+    return NULL;
+}
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void put_be(uint8_t *p, uint32_t value, int bytes){
+    int i;
+    for (i = bytes - 1; i >= 0; i--) {
+        p[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+static uint32_t get_be(const uint8_t *p, int bytes){
+    uint32_t value = 0;
+    int i;
+    for (i = 0; i < bytes; i++)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+static uint32_t sim_random(sim_t *sim){
+    // xorshift32, plenty for shot noise and reproducible per seed
+    uint32_t x = sim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng = x;
+    return x;
+}
+
+static void sim_reset(sim_t *sim){
+    uint8_t *r = sim->regs;
+    int i;
+
+    memset(r, 0, SIM_REGISTER_SPACE);
+    r[VL53LX_I2C_SLAVE__DEVICE_ADDRESS] = 0x29;
+    put_be(&r[VL53LX_OSC_MEASURED__FAST_OSC__FREQUENCY], VL53LX_SIM_FAST_OSC_FREQUENCY, 2);
+    put_be(&r[VL53LX_RESULT__OSC_CALIBRATE_VAL], 0x00F0, 2);
+    r[VL53LX_FIRMWARE__SYSTEM_STATUS] = 0x01;
+    r[VL53LX_INTERRUPT_MANAGER__ENABLES] = 0x1F;
+    r[VL53LX_INTERRUPT_MANAGER__ENABLES + 1] = 0x1F;
+
+    r[VL53LX_IDENTIFICATION__MODEL_ID] = 0xEA;
+    r[VL53LX_IDENTIFICATION__MODULE_TYPE] = 0xAA;
+    r[VL53LX_IDENTIFICATION__REVISION_ID] = 0x10;
+    for (i = VL53LX_GLOBAL_CONFIG__SPAD_ENABLES_RTN_0; i <= VL53LX_GLOBAL_CONFIG__SPAD_ENABLES_RTN_31; i++)
+        r[i] = 0xFF;
+    r[VL53LX_ROI_CONFIG__MODE_ROI_CENTRE_SPAD] = 0xC7;
+    r[VL53LX_ROI_CONFIG__MODE_ROI_XY_SIZE] = 0xFF;
+
+    // NVM mirrors the identification, the calibration areas stay blank
+    memset(sim->nvm, 0, sizeof(sim->nvm));
+    sim->nvm[VL53LX_NVM__IDENTIFICATION__MODEL_ID] = 0xEA;
+    sim->nvm[VL53LX_NVM__IDENTIFICATION__MODULE_TYPE] = 0xAA;
+    sim->nvm[VL53LX_NVM__IDENTIFICATION__REVISION_ID] = 0x10;
+    sim->nvm[VL53LX_NVM__I2C_SLAVE__DEVICE_ADDRESS] = 0x29;
+    put_be(&sim->nvm[VL53LX_NVM__FMT__OSC_MEASURED__FAST_OSC_FREQUENCY],
+        VL53LX_SIM_FAST_OSC_FREQUENCY, 2);
+    sim->nvm[VL53LX_NVM__FMT__ROI_CONFIG__MODE_ROI_CENTRE_SPAD] = 0xC7;
+    sim->nvm[VL53LX_NVM__FMT__ROI_CONFIG__MODE_ROI_XY_SIZE] = 0xFF;
+
+    sim->running = 0;
+    sim->pending = 0;
+    sim->range_count = 0;
+}
+
+static int sim_parse(VL53LX_SimConfig_t *pconfig, const char *params){
+    char buf[256];
+    char *item;
+    char *save = NULL;
+    char *value;
+    char *slash;
+    VL53LX_SimTarget_t *target;
+    unsigned long mm;
+
+    memset(pconfig, 0, sizeof(*pconfig));
+    pconfig->ambient_kcps = 500;
+    pconfig->noise = 1;
+    pconfig->seed = 1;
+
+    snprintf(buf, sizeof(buf), "%s", params);
+    for (item = strtok_r(buf, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        value = strchr(item, '=');
+        if (value == NULL) {
+            printf("Expected KEY=VALUE in simulator parameters, got %s.\n", item);
+            return -1;
+        }
+        *value++ = '\0';
+        if (strcmp(item, "target") == 0) {
+            if (pconfig->target_count == VL53LX_SIM_MAX_TARGETS) {
+                printf("At most %d simulated targets.\n", VL53LX_SIM_MAX_TARGETS);
+                return -1;
+            }
+            target = &pconfig->target[pconfig->target_count++];
+            mm = strtoul(value, &slash, 10);
+            if (mm == 0 || mm > 0xFFFF) {
+                printf("Invalid simulated target distance %s.\n", value);
+                return -1;
+            }
+            target->distance_mm = mm;
+            if (*slash == '/')
+                target->signal_kcps = strtoul(slash + 1, NULL, 10);
+            else
+                target->signal_kcps = (uint64_t)VL53LX_SIM_SIGNAL_KCPS_AT_1M * 1000000 / (mm * mm);
+        } else if (strcmp(item, "ambient") == 0) {
+            pconfig->ambient_kcps = strtoul(value, NULL, 10);
+        } else if (strcmp(item, "period") == 0) {
+            pconfig->period_us = strtoul(value, NULL, 10);
+        } else if (strcmp(item, "noise") == 0) {
+            pconfig->noise = atoi(value) != 0;
+        } else if (strcmp(item, "seed") == 0) {
+            pconfig->seed = strtoul(value, NULL, 10);
+        } else if (strcmp(item, "clock") == 0) {
+            pconfig->clock_hz = strtoul(value, NULL, 10);
+        } else {
+            printf("Unknown simulator parameter %s.\n", item);
+            return -1;
+        }
+    }
+
+    if (pconfig->target_count == 0) {
+        pconfig->target_count = 1;
+        pconfig->target[0].distance_mm = 1000;
+        pconfig->target[0].signal_kcps = VL53LX_SIM_SIGNAL_KCPS_AT_1M;
+    }
+    return 0;
+}
+
+int VL53LX_sim_open(const char *params){
+    sim_t *sim;
+    int fd;
+
+    if (sim_count == VL53LX_SIM_MAX_OPEN) {
+        printf("Too many open simulated devices.\n");
+        return -1;
+    }
+    sim = calloc(1, sizeof(*sim));
+    if (sim == NULL) {
+        printf("Failed to allocate the simulated device.\n");
+        return -1;
+    }
+    if (sim_parse(&sim->config, params) < 0) {
+        free(sim);
+        return -1;
+    }
+    // A real descriptor, so it can not clash with an open bus or capture
+    fd = open("/dev/null", O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open /dev/null");
+        free(sim);
+        return -1;
+    }
+    sim->fd = fd;
+    sim->irq_fd = -1;
+    sim->rng = sim->config.seed ? sim->config.seed : 1;
+    sim_reset(sim);
+    sims[sim_count++] = sim;
+    return fd;
+}
+
+void VL53LX_sim_close(int fd){
+    int i;
+
+    for (i = 0; i < sim_count; i++) {
+        if (sims[i]->fd == fd) {
+            if (sims[i]->irq_fd >= 0)
+                close(sims[i]->irq_fd);
+            close(fd);
+            free(sims[i]);
+            sims[i] = sims[--sim_count];
+            return;
+        }
+    }
+}
+
+int VL53LX_sim_is_sim(int fd){
+    return sim_count > 0 && sim_get(fd) != NULL;
+}
+
+static void sim_set_interrupt(sim_t *sim, int asserted){
+    // GPIO__TIO_HV_STATUS bit 0 follows the polarity the host programmed
+    uint8_t active_high = (sim->regs[VL53LX_GPIO_HV_MUX__CTRL] &
+        VL53LX_DEVICEINTERRUPTLEVEL_ACTIVE_MASK) == VL53LX_DEVICEINTERRUPTLEVEL_ACTIVE_HIGH;
+
+    sim->regs[VL53LX_GPIO__TIO_HV_STATUS] = (asserted == active_high) ? 0x01 : 0x00;
+}
+
+/* Area of a triangular pulse of half width w centred on c between a and b,
+ * all in phase units, as a fraction of the pulse. */
+static double pulse_area(double c, double w, double a, double b){
+    double fa, fb, t;
+
+    t = a - c;
+    fa = t <= -w ? 0 : t < 0 ? (w + t) * (w + t) / (2 * w * w) :
+         t < w ? 1 - (w - t) * (w - t) / (2 * w * w) : 1;
+    t = b - c;
+    fb = t <= -w ? 0 : t < 0 ? (w + t) * (w + t) / (2 * w * w) :
+         t < w ? 1 - (w - t) * (w - t) / (2 * w * w) : 1;
+    return fb - fa;
+}
+
+static uint32_t sim_noise(sim_t *sim, double events){
+    int32_t sum = 0;
+    int i;
+
+    if (events <= 0)
+        return 0;
+    if (!sim->config.noise)
+        return (uint32_t)(events + 0.5);
+
+    // Irwin-Hall approximation of a normal deviate, scaled to the shot
+    // noise of a Poisson process
+    for (i = 0; i < 12; i++)
+        sum += sim_random(sim) >> 20;
+    events += (double)(sum - 6 * 4096) / 4096 * VL53LX_isqrt((uint32_t)events);
+    return events <= 0 ? 0 : (uint32_t)(events + 0.5);
+}
+
+static void sim_fill_histogram(sim_t *sim, uint8_t stream_count){
+    uint8_t *r = sim->regs;
+    VL53LX_SimConfig_t *cfg = &sim->config;
+    int timing_b = stream_count & 0x01;
+    uint8_t  vcsel_period;
+    uint16_t encoded_timeout;
+    uint16_t fast_osc;
+    uint32_t pll_period_us;
+    uint32_t duration_us;
+    uint32_t period_phase;
+    uint32_t bins[SIM_BINS];
+    double   ambient;
+    double   events;
+    double   centre;
+    uint8_t  seq[SIM_BINS / SIM_GROUP_BINS];
+    int      bin;
+    int      t;
+    int      k;
+
+    vcsel_period = VL53LX_decode_vcsel_period(
+        r[timing_b ? VL53LX_RANGE_CONFIG__VCSEL_PERIOD_B : VL53LX_RANGE_CONFIG__VCSEL_PERIOD_A]);
+    encoded_timeout = get_be(&r[timing_b ? VL53LX_RANGE_CONFIG__TIMEOUT_MACROP_B_HI :
+        VL53LX_RANGE_CONFIG__TIMEOUT_MACROP_A_HI], 2);
+    fast_osc = get_be(&r[VL53LX_OSC_MEASURED__FAST_OSC__FREQUENCY], 2);
+    pll_period_us = VL53LX_calc_pll_period_us(fast_osc);
+
+    // Same integration time the driver derives its rates from
+    duration_us = VL53LX_duration_maths(
+        pll_period_us,
+        ((uint32_t)r[VL53LX_GLOBAL_CONFIG__VCSEL_WIDTH] << 4) +
+            r[VL53LX_ANA_CONFIG__VCSEL_PULSE_WIDTH_OFFSET],
+        VL53LX_RANGING_WINDOW_VCSEL_PERIODS,
+        VL53LX_decode_timeout(encoded_timeout) + 1);
+
+    // Each group of 4 bins accumulates the 4 PLL clocks of its code, or
+    // ambient for code 7. The driver decodes the low ambient sequence,
+    // packed two codes per byte from RANGE_CONFIG__SIGMA_THRESH: 3 bytes
+    // for even streams then 3 for odd ones.
+    for (k = 0; k < 3; k++) {
+        uint8_t packed = r[VL53LX_RANGE_CONFIG__SIGMA_THRESH + 3 * timing_b + k];
+        seq[2 * k] = packed & 0x0F;
+        seq[2 * k + 1] = packed >> 4;
+    }
+
+    if (vcsel_period == 0 || pll_period_us == 0)
+        vcsel_period = SIM_BINS;
+    period_phase = vcsel_period * SIM_PHASE_PER_BIN;
+
+    ambient = (double)cfg->ambient_kcps * duration_us / 1000 / vcsel_period;
+    for (bin = 0; bin < SIM_BINS; bin++)
+        bins[bin] = sim_noise(sim, ambient);
+
+    for (t = 0; t < cfg->target_count; t++) {
+        events = (double)cfg->target[t].signal_kcps * duration_us / 1000;
+        // Inverse of VL53LX_range_maths(): quarter millimetres to phase
+        centre = VL53LX_SIM_REFERENCE_PHASE + (double)cfg->target[t].distance_mm * 4 *
+            (1 << 9) * (1 << 22) / ((double)pll_period_us * VL53LX_SPEED_OF_LIGHT_IN_AIR_DIV_8);
+        while (centre >= period_phase)
+            centre -= period_phase;
+
+        for (bin = 0; bin < SIM_BINS; bin++) {
+            uint8_t code = seq[bin / SIM_GROUP_BINS];
+            double lo;
+            double area = 0;
+
+            if ((code & SIM_AMBIENT_CODE) == SIM_AMBIENT_CODE)
+                continue;
+            lo = (double)((code * SIM_GROUP_BINS + bin % SIM_GROUP_BINS) % vcsel_period) *
+                SIM_PHASE_PER_BIN;
+            // Phase wraps on the VCSEL period, count the aliases either side
+            for (k = -1; k <= 1; k++)
+                area += pulse_area(centre + (double)k * period_phase,
+                    VL53LX_SIM_PULSE_HALF_WIDTH, lo, lo + SIM_PHASE_PER_BIN);
+            bins[bin] += sim_noise(sim, events * area);
+        }
+    }
+
+    for (bin = 0; bin < SIM_BINS; bin++) {
+        if (bins[bin] > 0xFFFFFF)
+            bins[bin] = 0xFFFFFF;
+        put_be(&r[VL53LX_RESULT__HISTOGRAM_BIN_0_2 + 3 * bin], bins[bin], 3);
+    }
+    // The low byte of the last bin is also reported split 6 + 2 bits
+    r[VL53LX_RESULT__HISTOGRAM_BIN_23_0_MSB] = (bins[SIM_BINS - 1] & 0xFF) >> 2;
+    r[VL53LX_RESULT__HISTOGRAM_BIN_23_0_LSB] = bins[SIM_BINS - 1] & 0x03;
+}
+
+static void sim_arm_interrupt(sim_t *sim, uint64_t due_ns){
+    struct itimerspec its;
+
+    if (sim->irq_fd < 0)
+        return;
+    // An expiry already in the past fires at once, 0 disarms
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = due_ns / 1000000000ULL;
+    its.it_value.tv_nsec = due_ns % 1000000000ULL;
+    timerfd_settime(sim->irq_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void sim_complete(sim_t *sim){
+    uint8_t *r = sim->regs;
+    uint8_t stream_count;
+
+    // The first range after a start is the hold sync range, the stream
+    // count then runs from 0 and wraps from 255 back to 128.
+    if (sim->range_count == 0)
+        stream_count = 0;
+    else if (sim->range_count - 1 < 0x100)
+        stream_count = sim->range_count - 1;
+    else
+        stream_count = 0x80 + (sim->range_count - 1 - 0x80) % 0x80;
+
+    r[VL53LX_RESULT__INTERRUPT_STATUS] = (sim->gph_id << 4) | 0x01;
+    r[VL53LX_RESULT__RANGE_STATUS] = VL53LX_DEVICEERROR_RANGECOMPLETE;
+    r[VL53LX_RESULT__REPORT_STATUS] = 0;
+    r[VL53LX_RESULT__STREAM_COUNT] = stream_count;
+    put_be(&r[VL53LX_RESULT__DSS_ACTUAL_EFFECTIVE_SPADS_SD0], VL53LX_SIM_EFFECTIVE_SPADS, 2);
+    put_be(&r[VL53LX_PHASECAL_RESULT__REFERENCE_PHASE], VL53LX_SIM_REFERENCE_PHASE, 2);
+    r[VL53LX_PHASECAL_RESULT__VCSEL_START] = r[VL53LX_CAL_CONFIG__VCSEL_START];
+    sim_fill_histogram(sim, stream_count);
+
+    sim->range_count++;
+    sim->stats.ranges++;
+    sim->pending = 0;
+    sim_set_interrupt(sim, 1);
+}
+
+static void sim_update(sim_t *sim){
+    if (sim->pending && now_ns() >= sim->due_ns)
+        sim_complete(sim);
+}
+
+static void sim_start_range(sim_t *sim){
+    uint8_t hold = sim->regs[VL53LX_SYSTEM__GROUPED_PARAMETER_HOLD] &
+        VL53LX_GROUPEDPARAMETERHOLD_ID_MASK;
+
+    if (!sim->running) {
+        sim->running = 1;
+        sim->range_count = 0;
+        sim->next_gph_id = hold;
+    }
+    // The parameters held with a range are applied to the one after it
+    sim->gph_id = sim->next_gph_id;
+    sim->next_gph_id = hold;
+
+    sim->pending = 1;
+    sim->due_ns = now_ns() + (uint64_t)sim->config.period_us * 1000;
+    sim_arm_interrupt(sim, sim->due_ns);
+    sim_update(sim);
+}
+
+// Blocks like the bus would, bytes counts the address and index bytes too
+static void sim_transfer(sim_t *sim, uint32_t bytes){
+    struct timespec ts;
+    uint64_t ns;
+
+    if (sim->config.clock_hz == 0)
+        return;
+    ns = (uint64_t)bytes * SIM_BITS_PER_BYTE * 1000000000ULL / sim->config.clock_hz;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+        ;
+}
+
+int VL53LX_sim_read(int fd, uint16_t index, uint8_t *data, uint32_t count){
+    sim_t *sim = sim_get(fd);
+
+    if (sim == NULL || index + count > SIM_REGISTER_SPACE)
+        return VL53LX_ERROR_CONTROL_INTERFACE;
+
+    // Address and index written, then the address again and the data
+    sim_transfer(sim, 4 + count);
+    sim_update(sim);
+    memcpy(data, &sim->regs[index], count);
+    return VL53LX_ERROR_NONE;
+}
+
+int VL53LX_sim_write(int fd, uint16_t index, const uint8_t *data, uint32_t count){
+    sim_t *sim = sim_get(fd);
+    uint32_t end = index + count;
+    uint8_t *r;
+    uint16_t nvm_addr;
+
+    if (sim == NULL || end > SIM_REGISTER_SPACE)
+        return VL53LX_ERROR_CONTROL_INTERFACE;
+    r = sim->regs;
+    sim_transfer(sim, 3 + count);
+
+    if (index == VL53LX_SOFT_RESET && data[0] == 0x00) {
+        // Reloads the defaults and reboots at once
+        sim_reset(sim);
+        return VL53LX_ERROR_NONE;
+    }
+
+    memcpy(&r[index], data, count);
+
+    if (index <= VL53LX_RANGING_CORE__NVM_CTRL__READN && end > VL53LX_RANGING_CORE__NVM_CTRL__READN &&
+        r[VL53LX_RANGING_CORE__NVM_CTRL__READN] == 0x01) {
+        nvm_addr = r[VL53LX_RANGING_CORE__NVM_CTRL__ADDR] * 4;
+        if (nvm_addr + 4 <= sizeof(sim->nvm))
+            memcpy(&r[VL53LX_RANGING_CORE__NVM_CTRL__DATAOUT_MMM], &sim->nvm[nvm_addr], 4);
+        sim->stats.nvm_reads++;
+    }
+
+    if (index <= VL53LX_SYSTEM__INTERRUPT_CLEAR && end > VL53LX_SYSTEM__INTERRUPT_CLEAR &&
+        (r[VL53LX_SYSTEM__INTERRUPT_CLEAR] & 0x01))
+        sim_set_interrupt(sim, 0);
+
+    if (index <= VL53LX_SYSTEM__MODE_START && end > VL53LX_SYSTEM__MODE_START) {
+        switch (r[VL53LX_SYSTEM__MODE_START] & VL53LX_DEVICEMEASUREMENTMODE_MODE_MASK) {
+        case VL53LX_DEVICEMEASUREMENTMODE_STOP:
+        case VL53LX_DEVICEMEASUREMENTMODE_ABORT:
+            sim->running = 0;
+            sim->pending = 0;
+            sim_set_interrupt(sim, 0);
+            sim_arm_interrupt(sim, 0);
+            break;
+        default:
+            sim_start_range(sim);
+            break;
+        }
+    }
+    return VL53LX_ERROR_NONE;
+}
+
+int VL53LX_sim_get_interrupt_fd(int fd){
+    sim_t *sim = sim_get(fd);
+
+    if (sim == NULL)
+        return -1;
+    if (sim->irq_fd < 0) {
+        sim->irq_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (sim->irq_fd < 0)
+            perror("Failed to create the simulated interrupt");
+        else if (sim->pending)
+            sim_arm_interrupt(sim, sim->due_ns);
+    }
+    return sim->irq_fd;
+}
+
+int VL53LX_sim_wait_interrupt(int fd, int32_t timeout_ms){
+    sim_t *sim = sim_get(fd);
+    struct pollfd pfd;
+    uint64_t expirations;
+    int rc;
+
+    if (sim == NULL || sim->irq_fd < 0)
+        return -1;
+
+    pfd.fd = sim->irq_fd;
+    pfd.events = POLLIN;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    if (rc <= 0)
+        return rc;
+    if (read(sim->irq_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+    return (int)expirations;
+}
+
+int VL53LX_sim_get_config(int fd, VL53LX_SimConfig_t *pconfig){
+    sim_t *sim = sim_get(fd);
+
+    if (sim == NULL)
+        return -1;
+    *pconfig = sim->config;
+    return 0;
+}
+
+int VL53LX_sim_set_config(int fd, const VL53LX_SimConfig_t *pconfig){
+    sim_t *sim = sim_get(fd);
+
+    if (sim == NULL || pconfig->target_count > VL53LX_SIM_MAX_TARGETS)
+        return -1;
+    sim->config = *pconfig;
+    return 0;
+}
+
+int VL53LX_sim_get_stats(int fd, VL53LX_SimStats_t *pstats){
+    sim_t *sim = sim_get(fd);
+
+    if (sim == NULL)
+        return -1;
+    *pstats = sim->stats;
+    return 0;
+}
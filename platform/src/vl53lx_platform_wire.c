@@ -0,0 +1,76 @@
+#include <string.h>
+#include <endian.h>
+#include "vl53lx_platform_wire.h"
+
+_Static_assert(sizeof(VL53LX_WireTarget_t) == 20, "wire target layout changed");
+_Static_assert(sizeof(VL53LX_WireFrame_t) == 192, "wire frame layout changed");
+_Static_assert(sizeof(VL53LX_WireRaw_t) == 48, "wire raw layout changed");
+
+// The byte swaps compile away on little endian hosts like the Pi
+static void encode_raw(const VL53LX_histogram_bin_data_t *pHD, VL53LX_WireRaw_t *praw){
+    memset(praw, 0, sizeof(*praw));
+    praw->total_periods_elapsed = htole32(pHD->total_periods_elapsed);
+    praw->peak_duration_us = htole32(pHD->peak_duration_us);
+    praw->woi_duration_us = htole32(pHD->woi_duration_us);
+    praw->ambient_events_sum = (int32_t)htole32((uint32_t)pHD->ambient_events_sum);
+    praw->fast_osc_frequency = htole16(pHD->VL53LX_p_015);
+    praw->vcsel_width = htole16(pHD->vcsel_width);
+    praw->reference_phase = htole16(pHD->phasecal_result__reference_phase);
+    praw->zero_distance_phase = htole16(pHD->zero_distance_phase);
+    praw->effective_spads = htole16(pHD->result__dss_actual_effective_spads);
+    praw->vcsel_period = pHD->VL53LX_p_005;
+    praw->vcsel_start = pHD->phasecal_result__vcsel_start;
+    praw->cal_vcsel_start = pHD->cal_config__vcsel_start;
+    praw->number_of_ambient_bins = pHD->number_of_ambient_bins;
+    praw->roi_centre_spad = pHD->roi_config__user_roi_centre_spad;
+    praw->roi_xy_size = pHD->roi_config__user_roi_requested_global_xy_size;
+    memcpy(praw->bin_seq, pHD->bin_seq, sizeof(praw->bin_seq));
+    memcpy(praw->bin_rep, pHD->bin_rep, sizeof(praw->bin_rep));
+}
+
+uint32_t VL53LX_wire_encode(const VL53LX_Frame_t *pframe, uint8_t sensor_id, void *out){
+    const VL53LX_histogram_bin_data_t *pHD = &pframe->additional.VL53LX_p_006;
+    const VL53LX_MultiRangingData_t *pMRD = &pframe->ranging;
+    const VL53LX_TargetRangeData_t *pRD;
+    VL53LX_WireFrame_t *pwf = out;
+    VL53LX_WireTarget_t *pwt;
+    uint8_t count = 0;
+    int i;
+
+    pwf->magic = htole16(VL53LX_WIRE_MAGIC);
+    pwf->version = VL53LX_WIRE_VERSION;
+    pwf->flags = (pHD->result__stream_count % 2 == 0) ? VL53LX_WIRE_FLAG_HIST_A : 0;
+    pwf->sensor_id = sensor_id;
+    pwf->stream_count = pHD->result__stream_count;
+    pwf->reserved = 0;
+    pwf->timestamp_ns = htole64(pframe->timestamp_ns);
+    for (i = 0; i < VL53LX_WIRE_BINS; i++)
+        pwf->bins[i] = (int32_t)htole32((uint32_t)pHD->bin_data[i]);
+
+    if (!pframe->raw)
+        count = pMRD->NumberOfObjectsFound;
+    if (count > VL53LX_MAX_RANGE_RESULTS)
+        count = VL53LX_MAX_RANGE_RESULTS;
+    pwf->object_count = count;
+
+    memset(pwf->target, 0, sizeof(pwf->target));
+    for (i = 0; i < count; i++) {
+        pRD = &pMRD->RangeData[i];
+        pwt = &pwf->target[i];
+        pwt->signal_rate_mcps = htole32(pRD->SignalRateRtnMegaCps);
+        pwt->ambient_rate_mcps = htole32(pRD->AmbientRateRtnMegaCps);
+        pwt->sigma_mm = htole32(pRD->SigmaMilliMeter);
+        pwt->range_min_mm = (int16_t)htole16((uint16_t)pRD->RangeMinMilliMeter);
+        pwt->range_mm = (int16_t)htole16((uint16_t)pRD->RangeMilliMeter);
+        pwt->range_max_mm = (int16_t)htole16((uint16_t)pRD->RangeMaxMilliMeter);
+        pwt->range_status = pRD->RangeStatus;
+        pwt->extended_range = pRD->ExtendedRange;
+    }
+
+    if (!pframe->raw)
+        return sizeof(VL53LX_WireFrame_t);
+
+    pwf->flags |= VL53LX_WIRE_FLAG_RAW;
+    encode_raw(pHD, (VL53LX_WireRaw_t *)(pwf + 1));
+    return sizeof(VL53LX_WireFrame_t) + sizeof(VL53LX_WireRaw_t);
+}
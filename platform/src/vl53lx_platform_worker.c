@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "vl53lx_platform_worker.h"
+#include "vl53lx_platform_capture.h"
+#include "vl53lx_platform_user_data.h"
+#include "vl53lx_platform_raw.h"
+#include "vl53lx_api.h"
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Only the worker writes its counters, no read-modify-write needed
+static void count(atomic_uint *counter){
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+static VL53LX_Error read_frame(VL53LX_Worker_t *pw, uint8_t sensor, uint32_t level, VL53LX_Frame_t *pframe){
+    VL53LX_Sensor_t *ps = &pw->pm->sensor[sensor];
+    VL53LX_DEV Dev = &ps->dev;
+    VL53LX_PlatformStats_t stats;
+    VL53LX_Error status;
+
+    pframe->sensor = sensor;
+    pframe->timestamp_ns = now_ns();
+    pframe->raw = ps->config.raw || level == VL53LX_WORKER_READ_RAW;
+    if (pframe->raw) {
+        status = VL53LX_GetRawHistogramData(Dev, &pframe->additional);
+        VL53LX_GetRawHistogramInputs(Dev, &pframe->inputs);
+        pframe->ranging.StreamCount = pframe->additional.VL53LX_p_006.result__stream_count;
+        pframe->ranging.NumberOfObjectsFound = 0;
+    } else {
+        status = VL53LX_GetMultiRangingData(Dev, &pframe->ranging);
+        if (status == VL53LX_ERROR_NONE)
+            status = VL53LX_GetAdditionalData(Dev, &pframe->additional);
+    }
+
+    VL53LX_GetPlatformStats(Dev, &stats);
+    pframe->syscalls = stats.syscalls - pw->last_syscalls[sensor];
+    pw->last_syscalls[sensor] = stats.syscalls;
+    return status;
+}
+
+static void *worker_main(void *arg){
+    VL53LX_Worker_t *pw = arg;
+    VL53LX_MultiSensor_t *pm = pw->pm;
+    VL53LX_Frame_t frame;
+    VL53LX_Sensor_t *ps;
+    struct timespec pause_wait = {0, VL53LX_WORKER_PAUSE_WAIT_MS * 1000000L};
+    VL53LX_Error status;
+    uint32_t level;
+    uint8_t ready;
+    uint32_t due;
+    int i;
+
+    while (pw->running) {
+        if (pw->pause != pw->paused) {
+            pw->paused = pw->pause;
+            if (pw->paused)
+                VL53LX_multi_stop(pm);
+            else
+                VL53LX_multi_start(pm);
+        }
+        if (pw->paused) {
+            nanosleep(&pause_wait, NULL);
+            continue;
+        }
+
+        due = VL53LX_multi_wait(pm, pw->poll_period_ms);
+
+        for (i = 0; i < pm->count && pw->running; i++) {
+            if (!(due & (1 << i)))
+                continue;
+            ps = &pm->sensor[i];
+
+            ready = 0;
+            status = VL53LX_GetMeasurementDataReady(&ps->dev, &ready);
+            // A replay stops for good once the capture runs out
+            if (status == VL53LX_ERROR_CONTROL_INTERFACE && VL53LX_capture_is_replay(ps->dev.fd)) {
+                pw->status = status;
+                pw->running = 0;
+            }
+            if (status != VL53LX_ERROR_NONE)
+                count(&pw->errors[i]);
+            else if (!ready)
+                count(&pw->not_ready[i]);
+            if (status != VL53LX_ERROR_NONE || !ready)
+                continue;
+
+            VL53LX_multi_ready(pm, i);
+            level = atomic_load_explicit(&pw->demand[i], memory_order_relaxed);
+            if (level != VL53LX_WORKER_READ_NONE) {
+                if (read_frame(pw, i, level, &frame) == VL53LX_ERROR_NONE) {
+                    pw->handler(pw->user, ps, &frame);
+                    pw->frames++;
+                } else {
+                    count(&pw->errors[i]);
+                }
+            }
+
+            // Only once the results are read, restarting earlier would
+            // drop the range in progress
+            VL53LX_ClearInterruptAndStartMeasurement(&ps->dev);
+        }
+    }
+    return NULL;
+}
+
+VL53LX_Error VL53LX_worker_start(VL53LX_Worker_t *pw, VL53LX_MultiSensor_t *pm,
+    int32_t poll_period_ms, VL53LX_FrameHandler_t handler, void *user){
+
+    sigset_t all, old;
+    int rc, i;
+
+    memset(pw, 0, sizeof(*pw));
+    pw->pm = pm;
+    pw->poll_period_ms = poll_period_ms;
+    pw->handler = handler;
+    pw->user = user;
+    pw->running = 1;
+    pw->status = VL53LX_ERROR_NONE;
+    for (i = 0; i < VL53LX_MULTI_MAX_SENSORS; i++) {
+        atomic_init(&pw->demand[i], VL53LX_WORKER_READ_FULL);
+        atomic_init(&pw->not_ready[i], 0);
+        atomic_init(&pw->errors[i], 0);
+    }
+
+    // The thread inherits the mask, signals stay with the caller
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    rc = pthread_create(&pw->thread, NULL, worker_main, pw);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        printf("Failed to start the acquisition thread due to %s.\n", strerror(rc));
+        pw->running = 0;
+        return VL53LX_ERROR_UNDEFINED;
+    }
+    return VL53LX_ERROR_NONE;
+}
+
+void VL53LX_worker_set_demand(VL53LX_Worker_t *pw, uint8_t sensor, uint32_t level){
+    atomic_store_explicit(&pw->demand[sensor], level, memory_order_relaxed);
+}
+
+void VL53LX_worker_pause(VL53LX_Worker_t *pw, int pause){
+    pw->pause = pause;
+}
+
+void VL53LX_worker_cancel(VL53LX_Worker_t *pw){
+    pw->running = 0;
+}
+
+VL53LX_Error VL53LX_worker_join(VL53LX_Worker_t *pw){
+    pthread_join(pw->thread, NULL);
+    return pw->status;
+}
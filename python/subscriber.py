@@ -1,62 +1,130 @@
 import zmq
+import numpy as np
+from collections import deque
 from multiprocessing import Queue
 from queue import Empty
 from threading import Thread
 
+# Binary frames (--format=BINARY), see platform/inc/vl53lx_platform_wire.h.
+# vl53lx_client also receives them natively, many at a time, for high rates.
+from vl53lx_client import (
+    BIN_SEQUENCE_LENGTH,
+    WIRE_FLAG_HIST_A,
+    WIRE_FLAG_RAW,
+    WIRE_FRAME_DTYPE,
+    WIRE_MAGIC,
+    WIRE_RAW_DTYPE,
+    WIRE_VERSION,
+)
+
 port = "5556"
 ip = "127.0.0.1"  # localhost
 address = "tcp://%s:%s" % (ip, port)
+# Topic prefixes to receive, SENSOR/PHASE/KIND e.g. b"left/", b"left/B/ranges"
+# or b"" for everything. Filtering happens in ZeroMQ, unwanted data never
+# arrives.
+topics = [b""]
 data_queue = Queue()
+# Measurements of the last message not returned yet, a --batch message
+# carries several
+pending = deque()
+
+# Fields following the bins of a raw frame, in the order they are published
+RAW_FIELDS = [
+    "vcsel_period",
+    "fast_osc_frequency",
+    "vcsel_width",
+    "vcsel_start",
+    "cal_vcsel_start",
+    "reference_phase",
+    "zero_distance_phase",
+    "effective_spads",
+    "total_periods_elapsed",
+    "peak_duration_us",
+    "woi_duration_us",
+    "number_of_ambient_bins",
+    "ambient_events_sum",
+    "roi_centre_spad",
+    "roi_xy_size",
+]
 
 
 class Sensor(Thread):
-    def __init__(self, address, queue):
+    def __init__(self, address, queue, topics=(b"",)):
         super().__init__()
         self._queue = queue
         context = zmq.Context()
         self.socket = context.socket(zmq.SUB)
         self.socket.connect(address)
-        self.socket.set(zmq.SUBSCRIBE, b"")
+        for topic in topics:
+            self.socket.set(zmq.SUBSCRIBE, topic)
         self.daemon = True
         self.start()
 
     def run(self) -> None:
         while True:
             try:
-                payload = self.socket.recv_string(zmq.DONTWAIT)
-                # payload = self.socket.recv_string()
-                if payload:
-                    self._queue.put(payload)
+                # Sleeps until a message arrives, topic frame then payload
+                packet = self.socket.recv_multipart()
+                if len(packet) == 2:
+                    self._queue.put(packet)
 
             except zmq.ZMQError as e:
-                if e.errno == zmq.EAGAIN:
-                    pass
-                else:
-                    print(e)
+                print(e)
 
     def join(self) -> None:
         super().join()
 
 
-def parse_packet(packet):
-    packet_list = str(packet).split(" ")
+def parse_packet(topic, payload):
+    return parse_batch(topic, payload)[0]
+
+
+def parse_batch(topic, payload):
+    """Every measurement of a message, one unless published with --batch"""
+    sensor, phase, kind = topic.decode().split("/")
 
-    # Remove empty strings
-    packet_list = [x for x in packet_list if x != ""]
+    if payload[:1] == WIRE_MAGIC.to_bytes(2, "little")[:1]:
+        measurements = []
+        offset = 0
+        while offset < len(payload):
+            frame = payload[offset:]
+            measurements.append(decode_binary(frame))
+            offset += WIRE_FRAME_DTYPE.itemsize
+            if frame[3] & WIRE_FLAG_RAW:
+                offset += WIRE_RAW_DTYPE.itemsize
+    else:
+        measurements = [parse_text(kind, text) for text in payload.decode().split("\n")]
 
-    if len(packet_list) < 4:
-        None
+    for measurement in measurements:
+        if measurement is not None:
+            measurement["sensor"] = sensor
+            measurement["phase"] = phase
+            measurement["kind"] = kind
+    return measurements
+
+
+def parse_text(kind, payload):
+    packet_list = [x for x in payload.split(" ") if x != ""]
 
     measurement = {}
     measurement["count"] = int(packet_list[0])
 
-    histogram = packet_list[1].split(",")
-    histogram = [int(i) for i in histogram]
-    # zero padd the histogram data to 23 bins
-    histogram = histogram + [0] * (23 - len(histogram))
-    measurement["histogram"] = histogram
+    if kind == "raw":
+        return parse_raw(measurement, packet_list)
+
+    if kind == "stats":
+        measurement["timestamp_us"] = int(packet_list[1])
+        measurement["syscalls"] = int(packet_list[2])
+        return measurement
 
-    objects = packet_list[2:]
+    if kind == "histogram":
+        histogram = [int(i) for i in packet_list[1].split(",")]
+        # zero padd the histogram data to 23 bins
+        measurement["histogram"] = histogram + [0] * (23 - len(histogram))
+        return measurement
+
+    objects = packet_list[1:]
     measurement["objects"] = []
     for i in range(len(objects)):
         data = objects[i].split(",")
@@ -74,20 +142,77 @@ def parse_packet(packet):
     return measurement
 
 
-def get_measurement():
+def parse_raw(measurement, packet_list):
+    # count RAW timestamp_us bins fields
+    measurement["timestamp_us"] = int(packet_list[2])
+    measurement["histogram"] = [int(i) for i in packet_list[3].split(",")]
+
+    values = [int(i) for i in packet_list[4].split(",")]
+    measurement["raw"] = dict(zip(RAW_FIELDS, values))
+    values = values[len(RAW_FIELDS):]
+    measurement["raw"]["bin_seq"] = values[:BIN_SEQUENCE_LENGTH]
+    measurement["raw"]["bin_rep"] = values[BIN_SEQUENCE_LENGTH:]
+    measurement["objects"] = []
+    return measurement
+
+
+def decode_binary(packet):
+    frame = np.frombuffer(packet, dtype=WIRE_FRAME_DTYPE, count=1)[0]
+    if frame["magic"] != WIRE_MAGIC or frame["version"] != WIRE_VERSION:
+        return None
 
-    try:
-        packet = data_queue.get(False)
-        measurement = parse_packet(packet)
-    except Empty:
-        return
+    measurement = {}
+    measurement["sensor_id"] = int(frame["sensor_id"])
+    measurement["count"] = int(frame["stream_count"])
+    measurement["timestamp_us"] = int(frame["timestamp_ns"]) // 1000
+    measurement["frame"] = frame
+    bins = frame["bins"]
+
+    if frame["flags"] & WIRE_FLAG_RAW:
+        raw = np.frombuffer(packet, dtype=WIRE_RAW_DTYPE, count=1, offset=WIRE_FRAME_DTYPE.itemsize)[0]
+        measurement["histogram"] = bins.tolist()
+        measurement["raw"] = {name: raw[name].tolist() for name in RAW_FIELDS}
+        measurement["raw"]["bin_seq"] = raw["bin_seq"].tolist()
+        measurement["raw"]["bin_rep"] = raw["bin_rep"].tolist()
+        measurement["objects"] = []
+        return measurement
+
+    # Same bins as the text format
+    bins = bins[5:] if frame["flags"] & WIRE_FLAG_HIST_A else bins[1:]
+    measurement["histogram"] = bins.tolist() + [0] * (23 - len(bins))
 
+    measurement["objects"] = []
+    for target in frame["target"][: frame["object_count"]]:
+        measurement["objects"].append(
+            {
+                "status": int(target["range_status"]),
+                "min_range": int(target["range_min_mm"]),
+                "range": int(target["range_mm"]),
+                "max_range": int(target["range_max_mm"]),
+                "sigma": target["sigma_mm"] / 65536.0,
+                "signal_rate": target["signal_rate_mcps"] / 65536.0,
+                "amplitude_rate": target["ambient_rate_mcps"] / 65536.0,
+            }
+        )
     return measurement
 
 
+def get_measurement(timeout=None):
+    """Next measurement, waiting up to timeout seconds, forever for None"""
+
+    if not pending:
+        try:
+            topic, payload = data_queue.get(timeout=timeout)
+            pending.extend(parse_batch(topic, payload))
+        except Empty:
+            return
+
+    return pending.popleft()
+
+
 if __name__ == "__main__":
 
-    sensor = Sensor(address, data_queue)
+    sensor = Sensor(address, data_queue, topics)
 
     while True:
         measurement = get_measurement()
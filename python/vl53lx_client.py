@@ -0,0 +1,188 @@
+"""Binary frames of vl53lx_pi --format=BINARY as numpy arrays
+
+Binding of bin/libvl53lx_client.so, see platform/inc/vl53lx_platform_client.h.
+recv() sleeps until frames arrive and returns all of those received at once,
+with the GIL released while it waits, so one thread serves many sensors and
+sits idle between frames.
+
+    client = Client("tcp://raspberrypi:5556", [b"left/", b"right/"])
+    while True:
+        frames, raws = client.recv()
+        ranges = frames["target"]["range_mm"][:, 0]
+"""
+
+import ctypes
+import ctypes.util
+import os
+
+import numpy as np
+
+# Layout of platform/inc/vl53lx_platform_wire.h
+WIRE_MAGIC = 0x4CB5
+WIRE_VERSION = 1
+WIRE_FLAG_RAW = 0x01
+WIRE_FLAG_HIST_A = 0x02
+BIN_SEQUENCE_LENGTH = 6
+WIRE_TARGET_DTYPE = np.dtype(
+    [
+        ("signal_rate_mcps", "<u4"),
+        ("ambient_rate_mcps", "<u4"),
+        ("sigma_mm", "<u4"),
+        ("range_min_mm", "<i2"),
+        ("range_mm", "<i2"),
+        ("range_max_mm", "<i2"),
+        ("range_status", "u1"),
+        ("extended_range", "u1"),
+    ]
+)
+WIRE_FRAME_DTYPE = np.dtype(
+    [
+        ("magic", "<u2"),
+        ("version", "u1"),
+        ("flags", "u1"),
+        ("sensor_id", "u1"),
+        ("stream_count", "u1"),
+        ("object_count", "u1"),
+        ("reserved", "u1"),
+        ("timestamp_ns", "<u8"),
+        ("bins", "<i4", (24,)),
+        ("target", WIRE_TARGET_DTYPE, (4,)),
+    ]
+)
+WIRE_RAW_DTYPE = np.dtype(
+    [
+        ("total_periods_elapsed", "<u4"),
+        ("peak_duration_us", "<u4"),
+        ("woi_duration_us", "<u4"),
+        ("ambient_events_sum", "<i4"),
+        ("fast_osc_frequency", "<u2"),
+        ("vcsel_width", "<u2"),
+        ("reference_phase", "<u2"),
+        ("zero_distance_phase", "<u2"),
+        ("effective_spads", "<u2"),
+        ("vcsel_period", "u1"),
+        ("vcsel_start", "u1"),
+        ("cal_vcsel_start", "u1"),
+        ("number_of_ambient_bins", "u1"),
+        ("roi_centre_spad", "u1"),
+        ("roi_xy_size", "u1"),
+        ("bin_seq", "u1", (BIN_SEQUENCE_LENGTH,)),
+        ("bin_rep", "u1", (BIN_SEQUENCE_LENGTH,)),
+        ("reserved", "u1", (4,)),
+    ]
+)
+
+
+class _Client(ctypes.Structure):
+    # VL53LX_Client_t, zmq_msg_t is 64 pointer aligned bytes
+    _fields_ = [
+        ("context", ctypes.c_void_p),
+        ("socket", ctypes.c_void_p),
+        ("message", ctypes.c_void_p * (64 // ctypes.sizeof(ctypes.c_void_p))),
+        ("offset", ctypes.c_uint32),
+        ("size", ctypes.c_uint32),
+        ("frames", ctypes.c_uint64),
+        ("messages", ctypes.c_uint64),
+        ("skipped", ctypes.c_uint64),
+    ]
+
+
+def _load():
+    path = os.environ.get("VL53LX_CLIENT_LIB")
+    if path is None:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "bin", "libvl53lx_client.so")
+        if not os.path.exists(path):
+            path = ctypes.util.find_library("vl53lx_client")
+    lib = ctypes.CDLL(path)
+    client_p = ctypes.POINTER(_Client)
+    lib.VL53LX_client_open.argtypes = [client_p, ctypes.c_char_p]
+    lib.VL53LX_client_open.restype = ctypes.c_int
+    lib.VL53LX_client_subscribe.argtypes = [client_p, ctypes.c_char_p]
+    lib.VL53LX_client_subscribe.restype = ctypes.c_int
+    lib.VL53LX_client_recv.argtypes = [client_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_int32]
+    lib.VL53LX_client_recv.restype = ctypes.c_int
+    lib.VL53LX_client_close.argtypes = [client_p]
+    lib.VL53LX_client_close.restype = None
+    return lib
+
+
+_lib = None
+
+
+class Client:
+    def __init__(self, address, topics=(b"",)):
+        global _lib
+        if _lib is None:
+            _lib = _load()
+        self._client = _Client()
+        if _lib.VL53LX_client_open(ctypes.byref(self._client), address.encode()) != 0:
+            raise OSError("Failed to connect to %s" % address)
+        for topic in topics:
+            if isinstance(topic, str):
+                topic = topic.encode()
+            if _lib.VL53LX_client_subscribe(ctypes.byref(self._client), topic) != 0:
+                self.close()
+                raise OSError("Failed to subscribe to %r" % topic)
+
+    def recv_into(self, frames, raws=None, timeout_ms=-1):
+        """Fills frames, and raws for raw frames, returns how many"""
+        assert frames.dtype == WIRE_FRAME_DTYPE and frames.flags["C_CONTIGUOUS"]
+        if raws is not None:
+            assert raws.dtype == WIRE_RAW_DTYPE and raws.flags["C_CONTIGUOUS"] and len(raws) >= len(frames)
+            raws = raws.ctypes.data
+        n = _lib.VL53LX_client_recv(ctypes.byref(self._client), frames.ctypes.data, raws, len(frames), timeout_ms)
+        if n < 0:
+            raise OSError("Failed to receive frames")
+        return n
+
+    def recv(self, max_frames=256, timeout_ms=-1, raw=False):
+        """Frames received, waiting up to timeout_ms for the first one, and
+        their raw data when raw is set, else None"""
+        frames = np.empty(max_frames, dtype=WIRE_FRAME_DTYPE)
+        raws = np.zeros(max_frames, dtype=WIRE_RAW_DTYPE) if raw else None
+        n = self.recv_into(frames, raws, timeout_ms)
+        return frames[:n], raws[:n] if raw else None
+
+    @property
+    def frames(self):
+        return self._client.frames
+
+    @property
+    def messages(self):
+        return self._client.messages
+
+    @property
+    def skipped(self):
+        return self._client.skipped
+
+    def close(self):
+        _lib.VL53LX_client_close(ctypes.byref(self._client))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+if __name__ == "__main__":
+    import sys
+    import time
+
+    address = sys.argv[1] if len(sys.argv) > 1 else "tcp://127.0.0.1:5556"
+    with Client(address) as client:
+        start = time.monotonic()
+        received = 0
+        while True:
+            frames, _ = client.recv(timeout_ms=1000)
+            received += len(frames)
+            now = time.monotonic()
+            if now - start >= 1.0:
+                # First target of the frames of each sensor
+                for sensor in np.unique(frames["sensor_id"]):
+                    ranged = frames[(frames["sensor_id"] == sensor) & (frames["object_count"] > 0)]
+                    if len(ranged):
+                        print("sensor %d: %d mm" % (sensor, ranged["target"]["range_mm"][-1, 0]))
+                print("%.0f frames/s, %d messages, %d skipped" % (received / (now - start), client.messages, client.skipped))
+                start = now
+                received = 0
@@ -0,0 +1,186 @@
+/**
+Reprocesses raw histograms recorded with vl53lx_pi --raw-file on every core,
+to tune the histogram post processing on recorded data.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "vl53lx_platform_batch.h"
+
+// Ranges of one frame, kept in frame order until the run ends
+typedef struct
+{
+    uint8_t count;
+    uint8_t status[VL53LX_MAX_RANGE_RESULTS];
+    int16_t range_mm[VL53LX_MAX_RANGE_RESULTS];
+    uint16_t sigma_mm[VL53LX_MAX_RANGE_RESULTS];
+    uint16_t signal_mcps[VL53LX_MAX_RANGE_RESULTS];
+    uint16_t ambient_mcps[VL53LX_MAX_RANGE_RESULTS];
+} batch_result_t;
+
+static char *argv0;
+
+static const struct option long_options[] = {
+    {"threads", required_argument, 0, 'j'},
+    {"output", required_argument, 0, 'o'},
+    {"set", required_argument, 0, 's'},
+    {"list", no_argument, 0, 'l'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}};
+
+static void help(void)
+{
+    printf("\n");
+    printf("Usage: %s [OPTION]... FILE\n", argv0);
+    printf("Runs the histogram post processing over the raw frames of FILE.\n");
+    printf("Options:\n");
+    printf("  -j, --threads=NUMBER\t\tWorker threads. Default one per core.\n");
+    printf("  -o, --output=PATH\t\tWrite the ranges of every frame to PATH as CSV.\n");
+    printf("  -s, --set=KEY=VALUE\t\tOverride a post processing parameter, repeat for each one.\n");
+    printf("  -l, --list\t\t\tPrint the post processing parameters of FILE and exit.\n");
+    printf("  -h, --help\t\t\tPrint this help message.\n");
+    printf("\n");
+}
+
+static void store_result(void *user, uint64_t index, const VL53LX_range_results_t *presults)
+{
+    batch_result_t *r = &((batch_result_t *)user)[index];
+    const VL53LX_range_data_t *pdata;
+
+    r->count = presults->active_results;
+    if (r->count > VL53LX_MAX_RANGE_RESULTS)
+        r->count = VL53LX_MAX_RANGE_RESULTS;
+    for (int i = 0; i < r->count; i++)
+    {
+        pdata = &presults->VL53LX_p_003[i];
+        r->status[i] = pdata->range_status;
+        r->range_mm[i] = pdata->median_range_mm;
+        r->sigma_mm[i] = pdata->VL53LX_p_002;
+        r->signal_mcps[i] = pdata->peak_signal_count_rate_mcps;
+        r->ambient_mcps[i] = pdata->ambient_count_rate_mcps;
+    }
+}
+
+static int write_results(const char *path, const VL53LX_Batch_t *pb, const batch_result_t *results)
+{
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    // Rates and sigma are 9.7 fixed point in the driver
+    fprintf(fp, "frame,timestamp_us,objects,range_status,range_mm,sigma_mm,signal_mcps,ambient_mcps\n");
+    for (uint64_t i = 0; i < pb->count; i++)
+    {
+        const batch_result_t *r = &results[i];
+        if (r->count == 0)
+            fprintf(fp, "%llu,%llu,0,,,,,\n", (unsigned long long)i,
+                    (unsigned long long)(pb->frames[i].timestamp_ns / 1000));
+        for (int j = 0; j < r->count; j++)
+            fprintf(fp, "%llu,%llu,%u,%u,%d,%.2f,%.3f,%.3f\n", (unsigned long long)i,
+                    (unsigned long long)(pb->frames[i].timestamp_ns / 1000), r->count,
+                    r->status[j], r->range_mm[j], r->sigma_mm[j] / 128.0,
+                    r->signal_mcps[j] / 128.0, r->ambient_mcps[j] / 128.0);
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    VL53LX_BatchContext_t context;
+    VL53LX_BatchStats_t stats;
+    VL53LX_Batch_t batch;
+    batch_result_t *results = NULL;
+    const char *output = NULL;
+    const char *sets[64];
+    int set_count = 0;
+    int list_flag = 0;
+    uint32_t threads = 0;
+    int c, i;
+
+    argv0 = argv[0];
+    while ((c = getopt_long(argc, argv, "j:o:s:lh", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'j':
+            threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 's':
+            if (set_count == sizeof(sets) / sizeof(sets[0]))
+            {
+                printf("Too many parameter overrides.\n");
+                return 1;
+            }
+            sets[set_count++] = optarg;
+            break;
+        case 'l':
+            list_flag = 1;
+            break;
+        case 'h':
+            help();
+            return 0;
+        default:
+            help();
+            return 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        help();
+        return 1;
+    }
+
+    if (VL53LX_batch_map(&batch, argv[optind]) != 0)
+        return 1;
+
+    context = batch.context;
+    for (i = 0; i < set_count; i++)
+    {
+        if (VL53LX_batch_set_param(&context.post_cfg, sets[i]) != 0)
+        {
+            printf("Unknown or malformed parameter %s, see --list.\n", sets[i]);
+            VL53LX_batch_unmap(&batch);
+            return 1;
+        }
+    }
+    if (list_flag)
+    {
+        VL53LX_batch_print_params(stdout, &context.post_cfg);
+        VL53LX_batch_unmap(&batch);
+        return 0;
+    }
+
+    if (output != NULL)
+    {
+        results = calloc(batch.count ? batch.count : 1, sizeof(*results));
+        if (results == NULL)
+        {
+            printf("Failed to allocate results of %llu frames.\n", (unsigned long long)batch.count);
+            VL53LX_batch_unmap(&batch);
+            return 1;
+        }
+    }
+
+    VL53LX_batch_process(&batch, &context, threads, results ? store_result : NULL, results, &stats);
+    printf("%llu frames (%llu failed) in %.3f s on %u threads: %.0f frames/s, %.0f frames/s per core\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.errors, stats.seconds,
+           stats.threads, stats.fps, stats.fps_per_core);
+
+    if (output != NULL && write_results(output, &batch, results) != 0)
+        c = 1;
+    else
+        c = 0;
+    free(results);
+    VL53LX_batch_unmap(&batch);
+    return c;
+}
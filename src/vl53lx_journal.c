@@ -0,0 +1,134 @@
+/**
+Prints the frames recorded with vl53lx_pi --journal, from any point in time,
+and the sensor configuration they were recorded with.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <getopt.h>
+#include "vl53lx_platform_journal.h"
+
+static char *argv0;
+
+static const struct option long_options[] = {
+    {"from", required_argument, 0, 'f'},
+    {"to", required_argument, 0, 't'},
+    {"config", no_argument, 0, 'c'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}};
+
+static void help(void)
+{
+    printf("\n");
+    printf("Usage: %s [OPTION]... SEGMENT...\n", argv0);
+    printf("Prints the frames of journal segments as CSV, give the segments in order.\n");
+    printf("Options:\n");
+    printf("  -f, --from=SECONDS\t\tStart at SECONDS after the recording started.\n");
+    printf("  -t, --to=SECONDS\t\tStop at SECONDS after the recording started.\n");
+    printf("  -c, --config\t\t\tPrint the sensor configuration of the first segment and exit.\n");
+    printf("  -h, --help\t\t\tPrint this help message.\n");
+    printf("\n");
+}
+
+static void print_config(const VL53LX_JournalSegment_t *pseg)
+{
+    const VL53LX_JournalHeader_t *ph = pseg->header;
+    const VL53LX_JournalSensor_t *pjs;
+
+    printf("segment %u, started at %llu.%09llu (CLOCK_REALTIME)\n", ph->segment,
+           (unsigned long long)(ph->start_realtime_ns / 1000000000ULL),
+           (unsigned long long)(ph->start_realtime_ns % 1000000000ULL));
+    for (uint32_t i = 0; i < ph->sensor_count; i++)
+    {
+        pjs = &pseg->sensor[i];
+        printf("sensor %u %s: address 0x%02x, preset %u, distance mode %u, timing budget %u us, %s\n",
+               pjs->sensor_id, pjs->name, pjs->address, pjs->preset_mode, pjs->distance_mode,
+               pjs->timing_budget_us, pjs->raw ? "raw" : "ranges");
+        printf("  calibration: offset inner %d mm outer %d mm, crosstalk plane offset %u kcps\n",
+               pjs->calibration.customer.mm_config__inner_offset_mm,
+               pjs->calibration.customer.mm_config__outer_offset_mm,
+               pjs->calibration.customer.algo__crosstalk_compensation_plane_offset_kcps);
+    }
+}
+
+static void print_frame(const VL53LX_JournalSegment_t *pseg, const VL53LX_WireFrame_t *pwf)
+{
+    uint64_t t = le64toh(pwf->timestamp_ns) - pseg->header->start_ns;
+    const VL53LX_WireTarget_t *pwt;
+
+    if (pwf->object_count == 0)
+        printf("%llu.%06llu,%u,%u,0,,,,,\n", (unsigned long long)(t / 1000000000ULL),
+               (unsigned long long)(t % 1000000000ULL / 1000), pwf->sensor_id, pwf->stream_count);
+    for (int j = 0; j < pwf->object_count; j++)
+    {
+        pwt = &pwf->target[j];
+        // Rates and sigma are 16.16 fixed point on the wire
+        printf("%llu.%06llu,%u,%u,%u,%u,%d,%.2f,%.2f,%.2f\n", (unsigned long long)(t / 1000000000ULL),
+               (unsigned long long)(t % 1000000000ULL / 1000), pwf->sensor_id, pwf->stream_count,
+               pwf->object_count, pwt->range_status, (int16_t)le16toh(pwt->range_mm),
+               le32toh(pwt->sigma_mm) / 65536.0, le32toh(pwt->signal_rate_mcps) / 65536.0,
+               le32toh(pwt->ambient_rate_mcps) / 65536.0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    VL53LX_JournalSegment_t seg;
+    const VL53LX_WireFrame_t *pwf;
+    double from = 0, to = -1;
+    int config_flag = 0;
+    uint64_t offset, from_ns, to_ns;
+    int c, i;
+
+    argv0 = argv[0];
+    while ((c = getopt_long(argc, argv, "f:t:ch", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'f':
+            from = atof(optarg);
+            break;
+        case 't':
+            to = atof(optarg);
+            break;
+        case 'c':
+            config_flag = 1;
+            break;
+        case 'h':
+            help();
+            return 0;
+        default:
+            help();
+            return 1;
+        }
+    }
+    if (optind == argc)
+    {
+        help();
+        return 1;
+    }
+
+    if (!config_flag)
+        printf("time_s,sensor,count,objects,range_status,range_mm,sigma_mm,signal_mcps,ambient_mcps\n");
+    for (i = optind; i < argc; i++)
+    {
+        if (VL53LX_journal_map(argv[i], &seg) != 0)
+            return 1;
+        if (config_flag)
+        {
+            print_config(&seg);
+            VL53LX_journal_unmap(&seg);
+            return 0;
+        }
+
+        from_ns = seg.header->start_ns + (uint64_t)(from * 1e9);
+        to_ns = to < 0 ? UINT64_MAX : seg.header->start_ns + (uint64_t)(to * 1e9);
+        offset = VL53LX_journal_seek(&seg, from_ns);
+        while ((pwf = VL53LX_journal_next(&seg, &offset)) != NULL && le64toh(pwf->timestamp_ns) < to_ns)
+            print_frame(&seg, pwf);
+        VL53LX_journal_unmap(&seg);
+    }
+    return 0;
+}
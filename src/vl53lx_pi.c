@@ -12,8 +12,21 @@ Based on the i2c port of https://github.com/74ls04/VL53L3CX_rasppi
 #include <signal.h>
 #include <getopt.h>
 #include <stdarg.h>
+#include <limits.h>
+#include <sys/eventfd.h>
 #include <vl53lx_api.h>
 #include "vl53lx_platform.h"
+#include "vl53lx_platform_capture.h"
+#include "vl53lx_platform_gpio.h"
+#include "vl53lx_platform_worker.h"
+#include "vl53lx_platform_ring.h"
+#include "vl53lx_platform_batch.h"
+#include "vl53lx_platform_wire.h"
+#include "vl53lx_platform_pool.h"
+#include "vl53lx_platform_pack.h"
+#include "vl53lx_platform_shm.h"
+#include "vl53lx_platform_journal.h"
+#include "vl53lx_platform_metrics.h"
 #include <czmq.h>
 #include <assert.h>
 
@@ -77,10 +90,51 @@ struct _error_text
     {-60, "ERROR: PLATFORM SPECIFIC START"},
 };
 
-VL53LX_Dev_t dev;
-VL53LX_DEV Dev = &dev;
+#define MAX_BUSES 4
+#define FRAME_BUFFER_SIZE 3000
+#define FRAME_BUFFERS 1024
+#define MAX_SUBSCRIPTIONS 64
+#define TOPIC_SIZE 64
+#define BATCH_BUFFER_SIZE 32768
+#define BATCH_BUFFERS 64
+#define SHM_SLOTS 1024
+#define METRICS_LABELS_SIZE 256
+
+VL53LX_MultiSensor_t sensors[MAX_BUSES];
+VL53LX_Worker_t workers[MAX_BUSES];
+VL53LX_Ring_t rings[MAX_BUSES];
+FILE *raw_files[MAX_BUSES][VL53LX_MULTI_MAX_SENSORS];
+VL53LX_Pool_t frame_pool;
+VL53LX_Packer_t packer;
+VL53LX_Shm_t shm;
+VL53LX_Journal_t journal;
+VL53LX_Metrics_t metrics;
+char journal_path[PATH_MAX];                                     // [-J] Journal segment files are PATH.NNNN, empty for none
+int journal_size = 64;                                           // [-J] Journal segment size (MiB)
+char *metrics_address = NULL;                                    // [-M] Serve counters in the Prometheus text format on [HOST:]PORT, NULL for none
+char shm_name[NAME_MAX];                                         // [-S] Shared memory frame ring for local consumers, empty for none
+char subscriptions[MAX_SUBSCRIPTIONS][TOPIC_SIZE];                // Topic prefixes subscribers asked for, through XPUB
+int subscription_count = 0;
+_Alignas(8) char fallback_buffer[FRAME_BUFFER_SIZE];
+int workers_started = 0;
 int status;
 
+// Counters of the publishing thread, served with --metrics
+struct sensor_counters
+{
+    uint64_t frames;         // Frames taken from the queue
+    uint64_t stream_gaps;    // Frames whose stream count does not follow the previous one
+    uint8_t stream_count;    // Of the previous frame
+    uint64_t window_frames;  // frames when the current rate window started
+    double frame_rate;       // Frames per second over the previous window
+} sensor_counters[MAX_BUSES][VL53LX_MULTI_MAX_SENSORS];
+uint32_t queue_depth_max[MAX_BUSES];                             // Most frames waiting since the previous scrape
+uint64_t publish_bytes = 0;                                      // Topic and payload bytes handed to ZeroMQ
+uint64_t publish_messages = 0;
+uint64_t window_bytes = 0;                                       // publish_bytes when the current rate window started
+uint64_t window_start_ns = 0;
+double publish_rate = 0;                                         // Bytes per second over the previous window
+
 enum hist_mode
 {
     HIST_A,
@@ -94,11 +148,30 @@ enum hist_mode hist_mode = HIST_BOTH;                            // [-g] Histogr
 int compact_flag = 0;                                            // [-f] Enable debug messages
 int quiet_flag = 0;                                              // [-q] Disable debug messages
 int tcp_port = 5556;                                             // [-p] TCP port to publish on
-int poll_period = 33;                                            // [-p] Device polling period in (ms)
+int poll_period = -1;                                            // [-m] Fixed device polling period in (ms), -1 to schedule from the timing budget
 int timing_budget = 33;                                          // [-t] VL53L3CX timing budget (8ms to 500ms)
-int XSHUTPIN = 4;                                                // [-x] GPIO pin for XSHUT (default: 4)
+int XSHUTPIN = 4;                                                // [-x] gpiochip line for XSHUT (default: 4)
+int power_pin = -1;                                              // [-e] gpiochip line enabling the sensor supply, -1 if not wired (default: -1)
 uint8_t address = 0x29;                                          // [-a] VL53L3CX I2C address (Default is 0x29)
+char *i2c_device[MAX_BUSES] = {"/dev/i2c-1"};                   // [-i] I2C buses, a record:/replay: capture path or sim:
+int bus_count = 1;
+int bus_given = 0;
+int shadow_flag = 0;                                             // [-r] Skip register writes that match the last written value
+int raw_flag = 0;                                                // [-R] Publish raw histograms, range processing is left to subscribers
+int binary_flag = 0;                                             // [-f] Publish frames in the binary wire format instead of text
+char *raw_file = NULL;                                           // [-w] Also record raw histograms to batch files for vl53lx_batch
+int batch_frames = 1;                                            // [-B] Frames packed into one message, 1 to publish each on its own
+int batch_latency = 10;                                          // [-B] Longest a frame waits for its message to fill in (ms)
+int idle_stop = 0;                                               // [-I] Stop ranging after this many seconds without subscribers, 0 never
+int queue_length = 16;                                           // [-l] Frames buffered per bus between acquisition and publishing
+uint8_t queue_policy = VL53LX_RING_DROP_OLDEST;                  // [-b] Drop the oldest frame or block acquisition when the queue is full
+int interrupt_pin = -1;                                          // [-n] gpiochip line wired to GPIO1, -1 to poll (default: -1)
+char *gpio_chip = VL53LX_GPIO_DEFAULT_CHIP;                      // [-o] gpiochip of the XSHUT, power and interrupt lines
 VL53LX_DistanceModes distance_mode = VL53LX_DISTANCEMODE_MEDIUM; // Distance mode. SHORT, MEDIUM, or LONG. (default: MEDIUM)
+VL53LX_SensorConfig_t sensor_config[MAX_BUSES][VL53LX_MULTI_MAX_SENSORS]; // [-s] Sensors of the last -i bus, -x/-e/-a/-n describe a single one otherwise
+int sensor_count[MAX_BUSES];
+int sensor_base[MAX_BUSES];                                      // Wire format id of the first sensor of each bus
+int total_sensors = 0;
 
 // delimiter for publishing data
 char delimiter = ' ';
@@ -115,10 +188,27 @@ static struct option long_options[] = {
     {"poll-period", required_argument, NULL, 'm'},
     {"timing-budget", required_argument, NULL, 't'},
     {"xshut-pin", required_argument, NULL, 'x'},
+    {"power-pin", required_argument, NULL, 'e'},
     {"address", required_argument, NULL, 'a'},
+    {"register-shadow", no_argument, NULL, 'r'},
+    {"raw", no_argument, NULL, 'R'},
+    {"raw-file", required_argument, NULL, 'w'},
+    {"format", required_argument, NULL, 'f'},
+    {"i2c-device", required_argument, NULL, 'i'},
+    {"interrupt-pin", required_argument, NULL, 'n'},
+    {"gpio-chip", required_argument, NULL, 'o'},
+    {"sensor", required_argument, NULL, 's'},
+    {"queue-length", required_argument, NULL, 'l'},
+    {"queue-policy", required_argument, NULL, 'b'},
+    {"idle-stop", required_argument, NULL, 'I'},
+    {"batch", required_argument, NULL, 'B'},
+    {"shm", required_argument, NULL, 'S'},
+    {"journal", required_argument, NULL, 'J'},
+    {"metrics", required_argument, NULL, 'M'},
     {NULL, 0, NULL, 0}};
 
 void ranging_loop(void);
+void open_raw_files(void);
 void signal_handler(int signal);
 void check_status(int status);
 
@@ -132,10 +222,37 @@ static void help(void)
     printf("  -q, --quiet\t\t\t\tDisable debug messages.\n");
     printf("  -d, --distance-mode=MODE\t\tSet distance mode. SHORT, MEDIUM, or LONG.\n");
     printf("  -p, --port=NUMBER\t\t\tSet the port number for publishing data. Default 5556.\n");
-    printf("  -m, --poll-period=MILLISECONDS\tSet device polling period in (ms). Default 33 ms.\n");
+    printf("  -m, --poll-period=MILLISECONDS\tPoll at a fixed period in (ms) instead of scheduling\n");
+    printf("\t\t\t\t\tpolls from the timing budget.\n");
     printf("  -t, --timing-budget=MILLISECONDS\tSet VL53L3CX timing budget (8ms to 500ms). Default 33 ms.\n");
-    printf("  -x, --xshut-pin=NUMBER\t\tSet GPIO pin for XSHUT.\n");
+    printf("  -x, --xshut-pin=NUMBER\t\tSet GPIO line for XSHUT, -1 if not wired.\n");
+    printf("  -e, --power-pin=NUMBER\t\tSet GPIO line enabling the sensor supply, -1 if not wired (default).\n");
     printf("  -a, --address=ADDRESS\t\t\tSet VL53L3CX I2C address.\n");
+    printf("  -i, --i2c-device=PATH\t\t\tSet I2C bus (Default=/dev/i2c-1). record:FILE:DEVICE captures\n");
+    printf("\t\t\t\t\tall bus traffic to FILE, replay:FILE plays it back,\n");
+    printf("\t\t\t\t\tsim:[KEY=VALUE,...] runs a simulated sensor. Repeat for\n");
+    printf("\t\t\t\t\tup to 4 buses, each ranged by its own thread.\n");
+    printf("  -r, --register-shadow\t\t\tSkip register writes that match the last written value.\n");
+    printf("  -R, --raw\t\t\t\tPublish raw histograms without processing them into ranges.\n");
+    printf("  -f, --format=FORMAT\t\t\tPublish frames as TEXT (default) or in the little endian BINARY format.\n");
+    printf("  -w, --raw-file=PATH\t\t\tAlso record raw histograms to PATH, PATH.NAME for each of several\n");
+    printf("\t\t\t\t\tsensors, to reprocess them with vl53lx_batch. Implies --raw.\n");
+    printf("  -n, --interrupt-pin=NUMBER\t\tWait for data ready on this GPIO1 line instead of polling.\n");
+    printf("  -o, --gpio-chip=PATH\t\t\tSet gpiochip of the XSHUT, power and interrupt lines (Default=/dev/gpiochip0).\n");
+    printf("  -s, --sensor=NAME[:KEY=VALUE,...]\tAdd a sensor on the last given bus, repeat for each one. Keys are\n");
+    printf("\t\t\t\t\txshut=LINE, power=LINE, address=0xNN and irq=LINE.\n");
+    printf("  -l, --queue-length=FRAMES\t\tFrames buffered per bus between acquisition and publishing. Default 16.\n");
+    printf("  -b, --queue-policy=POLICY\t\tWhen the queue is full, DROP the oldest frame (default) or BLOCK acquisition.\n");
+    printf("  -I, --idle-stop=SECONDS\t\tStop ranging after SECONDS without subscribers and restart\n");
+    printf("\t\t\t\t\twhen one subscribes. Default 0, never.\n");
+    printf("  -B, --batch=FRAMES[:MILLISECONDS]\tPack up to FRAMES frames of a topic into one message, sent at the latest\n");
+    printf("\t\t\t\t\tMILLISECONDS after its first frame (Default=10).\n");
+    printf("  -S, --shm=NAME\t\t\tAlso write every frame in the binary format to the shared memory ring\n");
+    printf("\t\t\t\t\t/dev/shm/NAME for consumers on this host.\n");
+    printf("  -J, --journal=PATH[:MEGABYTES]\tRecord every frame in the binary format to segment files PATH.NNNN\n");
+    printf("\t\t\t\t\tof MEGABYTES each (Default=64), read them with vl53lx_journal.\n");
+    printf("  -M, --metrics=[HOST:]PORT\t\tServe counters in the Prometheus text format over HTTP on PORT of\n");
+    printf("\t\t\t\t\tHOST (Default=127.0.0.1, * for every interface).\n");
     printf("  -h, --help\t\t\t\tPrint this help message.\n");
     printf("\n");
 }
@@ -163,8 +280,12 @@ int main(int argc, char *argv[])
 
     VL53LX_Error status;
     VL53LX_LLDriverData_t *pDev;
+    VL53LX_Sensor_t *ps;
+    VL53LX_DEV Dev;
+    uint32_t saved = 0;
+    int i, b;
 
-    while ((opt = getopt_long(argc, argv, "g:chqd:p:t:m:x:a:", long_options, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "g:chqd:p:t:m:x:e:a:rRw:f:i:n:o:s:l:b:I:B:S:J:M:", long_options, NULL)) != -1)
     {
         switch (opt)
         {
@@ -234,9 +355,127 @@ int main(int argc, char *argv[])
         case 'x':
             XSHUTPIN = atoi(optarg);
             break;
+        case 'e':
+            power_pin = atoi(optarg);
+            break;
         case 'a':
             address = (uint8_t)strtol(optarg, NULL, 16);
             break;
+        case 'r':
+            shadow_flag = 1;
+            break;
+        case 'R':
+            raw_flag = 1;
+            break;
+        case 'f':
+            if (strcasecmp(optarg, "TEXT") == 0)
+            {
+                binary_flag = 0;
+            }
+            else if (strcasecmp(optarg, "BINARY") == 0)
+            {
+                binary_flag = 1;
+            }
+            else
+            {
+                printf("Invalid format: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'w':
+            raw_file = optarg;
+            raw_flag = 1;
+            break;
+        case 'i':
+            // Sensors listed before the first bus belong to it
+            if (bus_given)
+            {
+                if (bus_count == MAX_BUSES)
+                {
+                    printf("At most %d buses are supported\n", MAX_BUSES);
+                    exit(EXIT_FAILURE);
+                }
+                bus_count++;
+            }
+            i2c_device[bus_count - 1] = optarg;
+            bus_given = 1;
+            break;
+        case 'n':
+            interrupt_pin = atoi(optarg);
+            break;
+        case 'o':
+            gpio_chip = optarg;
+            break;
+        case 's':
+            b = bus_count - 1;
+            if (sensor_count[b] == VL53LX_MULTI_MAX_SENSORS)
+            {
+                printf("At most %d sensors per bus are supported\n", VL53LX_MULTI_MAX_SENSORS);
+                exit(EXIT_FAILURE);
+            }
+            if (VL53LX_multi_parse_sensor(&sensor_config[b][sensor_count[b]], optarg) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            sensor_count[b]++;
+            break;
+        case 'l':
+            queue_length = atoi(optarg);
+            if (queue_length < 1)
+            {
+                printf("Invalid queue length: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            if (strcasecmp(optarg, "DROP") == 0)
+            {
+                queue_policy = VL53LX_RING_DROP_OLDEST;
+            }
+            else if (strcasecmp(optarg, "BLOCK") == 0)
+            {
+                queue_policy = VL53LX_RING_BLOCK;
+            }
+            else
+            {
+                printf("Invalid queue policy: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'I':
+            idle_stop = atoi(optarg);
+            break;
+        case 'B':
+            batch_frames = atoi(optarg);
+            if (strchr(optarg, ':') != NULL)
+            {
+                batch_latency = atoi(strchr(optarg, ':') + 1);
+            }
+            if (batch_frames < 1 || batch_latency < 0)
+            {
+                printf("Invalid batch: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'S':
+            snprintf(shm_name, sizeof(shm_name), "/%s", optarg[0] == '/' ? optarg + 1 : optarg);
+            break;
+        case 'J':
+            snprintf(journal_path, sizeof(journal_path), "%s", optarg);
+            if (strchr(journal_path, ':') != NULL)
+            {
+                journal_size = atoi(strchr(journal_path, ':') + 1);
+                *strchr(journal_path, ':') = '\0';
+            }
+            if (journal_size < 1)
+            {
+                printf("Invalid journal segment size: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'M':
+            metrics_address = optarg;
+            break;
         case 'h':
             help();
             exit(EXIT_SUCCESS);
@@ -264,148 +503,919 @@ int main(int argc, char *argv[])
     // Register signal handler
     signal(SIGINT, signal_handler);
 
-    // Turn on the sensor using GPIO4
-    // Enable GPIO4 using sysfs
-    char buf[100];
+    for (b = 0; b < bus_count; b++)
+    {
+        // Without --sensor the single sensor options describe the only one
+        if (sensor_count[b] == 0)
+        {
+            char name[sizeof(sensor_config[b][0].name)];
+            snprintf(name, sizeof(name), "%d", b);
+            VL53LX_multi_parse_sensor(&sensor_config[b][0], name);
+            sensor_config[b][0].xshut_line = XSHUTPIN;
+            sensor_config[b][0].power_line = power_pin;
+            sensor_config[b][0].irq_line = interrupt_pin;
+            sensor_config[b][0].address = address;
+            sensor_count[b] = 1;
+        }
+        for (i = 0; i < sensor_count[b]; i++)
+        {
+            sensor_config[b][i].shadow = shadow_flag;
+            sensor_config[b][i].raw |= raw_flag;
+        }
+        sensor_base[b] = total_sensors;
+        total_sensors += sensor_count[b];
+    }
 
-    FILE *fp = fopen("/sys/class/gpio/export", "w");
-    if (fp == NULL)
+    for (b = 0; b < bus_count; b++)
     {
-        print("Failed to open /sys/class/gpio/export\n");
-        raise(SIGTERM);
+        // Sequences XSHUT and power enable and moves every sensor to its own address
+        print("Initializing I2C bus %s...\n", i2c_device[b]);
+        status = VL53LX_multi_init(&sensors[b], i2c_device[b], gpio_chip, sensor_config[b], sensor_count[b]);
+        if (status != VL53LX_ERROR_NONE)
+        {
+            check_status(status);
+            print("Failed to init 4\n");
+            raise(SIGTERM);
+        }
     }
-    fprintf(fp, "%d", XSHUTPIN);
-    fclose(fp);
 
-    // Give the udev rules a chance to make the GPIO available
-    sleep(1);
+    for (b = 0; b < bus_count; b++)
+    {
+        for (i = 0; i < sensors[b].count; i++)
+        {
+            ps = &sensors[b].sensor[i];
+            Dev = &ps->dev;
+
+            pDev = VL53LXDevStructGetLLDriverHandle(Dev);
+            print("Sensor %s on %s at I2C address 0x%02X\n", ps->config.name, i2c_device[b], Dev->i2c_slave_address);
+            print("Device Info:\n");
+            print("\t Product Type : 0x%02X\n", pDev->nvm_copy_data.identification__module_type);
+            print("\t Model ID : 0x%02X\n", pDev->nvm_copy_data.identification__model_id);
 
-    // Set as output
-    sprintf(buf, "/sys/class/gpio/gpio%d/direction", XSHUTPIN);
-    fp = fopen(buf, "w");
-    if (fp == NULL)
+            if ((pDev->nvm_copy_data.identification__module_type == 0xAA) &&
+                (pDev->nvm_copy_data.identification__model_id == 0xEA))
+            {
+                print("\t Model Name : VL53L3CX\n");
+            }
+            else
+            {
+                print("WARNING: Unknown model ID!\n");
+                raise(SIGTERM);
+            }
+
+            print("\n");
+
+            // Set distance mode if not default
+            if (distance_mode != VL53LX_DISTANCEMODE_MEDIUM)
+            {
+                print("Setting distance mode to %s\n", distance_mode == VL53LX_DISTANCEMODE_SHORT ? "SHORT" : "LONG");
+                status = VL53LX_SetDistanceMode(Dev, distance_mode);
+                check_status(status);
+            }
+            // Set timing budget if not default
+            if (timing_budget != 33)
+            {
+                print("Setting timing budget to %d ms\n", timing_budget);
+                status = VL53LX_SetMeasurementTimingBudgetMicroSeconds(Dev, timing_budget * 1000);
+                check_status(status);
+            }
+
+            if (ps->config.irq_line >= 0 && VL53LX_GetInterruptFd(Dev) >= 0)
+            {
+                print("Waiting for data ready on %s line %d\n", gpio_chip, ps->config.irq_line);
+            }
+        }
+    }
+
+    for (b = 0; b < bus_count; b++)
     {
-        print("Failed to open %s\n", buf);
-        raise(SIGTERM);
+        status = VL53LX_multi_start(&sensors[b]);
+        check_status(status);
     }
-    fprintf(fp, "out");
-    fclose(fp);
 
-    // Set GPIO4 high
-    sprintf(buf, "/sys/class/gpio/gpio%d/value", XSHUTPIN);
-    fp = fopen(buf, "w");
-    if (fp == NULL)
+    if (shadow_flag)
     {
-        print("Failed to open %s\n", buf);
-        raise(SIGTERM);
+        for (b = 0; b < bus_count; b++)
+        {
+            for (i = 0; i < sensors[b].count; i++)
+            {
+                saved += sensors[b].sensor[i].start_bytes_elided;
+            }
+        }
+        print("Register shadow saved %u bytes on start\n", saved);
     }
-    fprintf(fp, "1");
-    fclose(fp);
 
-    // Delay for a bit
-    usleep(10000); // 10 millisecond
+    if (raw_file)
+    {
+        open_raw_files();
+    }
+
+    ranging_loop();
+}
+
+// CTRL-C handler
+void signal_handler(int signal)
+{
+
+    // Print if not in compact mode
+
+    print("\n\rExiting...\n\r");
+
+    // The ranging loop powers the sensors down once the workers stopped
+    if (workers_started)
+    {
+        for (int b = 0; b < bus_count; b++)
+        {
+            VL53LX_worker_cancel(&workers[b]);
+        }
+        return;
+    }
 
-    // Initialize the i2c bus
-    print("Initializing I2C bus...\n");
-    Dev->i2c_slave_address = 0x29;
-    Dev->fd = VL53LX_i2c_init("/dev/i2c-1", Dev->i2c_slave_address); // choose between i2c-0 and i2c-1; On the raspberry pi zero, i2c-1 are pins 2 and 3
-    if (Dev->fd < 0)
+    // Powers the sensors down and flushes a capture in progress
+    for (int b = 0; b < bus_count; b++)
     {
-        print("Failed to init 4\n");
-        raise(SIGTERM);
+        VL53LX_multi_close(&sensors[b]);
     }
 
-    status = VL53LX_WaitDeviceBooted(Dev);
-    check_status(status);
+    exit(signal);
+}
+
+// Whether anyone listens to a topic. The terminal is no subscriber, it
+// only shows the frames published for someone
+static int want(VL53LX_Sensor_t *ps, int is_A, const char *kind)
+{
+    char topic[TOPIC_SIZE];
+    int i;
+
+    snprintf(topic, sizeof(topic), "%s/%s/%s", ps->config.name, is_A ? "A" : "B", kind);
+    for (i = 0; i < subscription_count; i++)
+    {
+        if (strncmp(topic, subscriptions[i], strlen(subscriptions[i])) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int want_any(VL53LX_Sensor_t *ps, const char *kind)
+{
+    return want(ps, 1, kind) || want(ps, 0, kind);
+}
 
-    status = VL53LX_DataInit(Dev);
-    check_status(status);
+// Comma separated bins, A ranges start after their ambient bins
+static int format_histogram(char *out, const VL53LX_histogram_bin_data_t *pHD, int is_A)
+{
+    int len = 0;
+    int j;
 
-    // Check if address is default
-    if (address == 0x29)
+    for (j = is_A ? 5 : 1; j < VL53LX_HISTOGRAM_BUFFER_SIZE; j++)
     {
-        print("Using default I2C address 0x29\n");
+        len += sprintf(out + len, len ? ",%d" : "%d", pHD->bin_data[j]);
     }
-    else
+    return len;
+}
+
+// Buffer to format the next frame into. Pool buffers are sent without a
+// copy, the fallback one is copied when every pool buffer is still queued
+static char *frame_buffer(void)
+{
+    char *data = VL53LX_pool_get(&frame_pool);
+
+    return data ? data : fallback_buffer;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Publish a full or expired batch, handed over to ZeroMQ like single frames
+static void send_batch(void *publisher, const char *topic, void *data, uint32_t len)
+{
+    zmq_msg_t msg;
+
+    zmq_send(publisher, topic, strlen(topic), ZMQ_SNDMORE);
+    publish_bytes += strlen(topic) + len;
+    publish_messages++;
+    zmq_msg_init_data(&msg, data, len, VL53LX_pool_release, &packer.pool);
+    if (zmq_msg_send(&msg, publisher, 0) < 0)
     {
-        print("Switching to using I2C address 0x%02X\n", address);
-        // set new i2c address for VL53L3CX
-        // print address
-        status = VL53LX_SetDeviceAddress(Dev, address);
-        check_status(status);
-        Dev->i2c_slave_address = address;
+        zmq_msg_close(&msg);
     }
+}
 
-    pDev = VL53LXDevStructGetLLDriverHandle(Dev);
-    print("Device Info:\n");
-    print("\t Product Type : 0x%02X\n", pDev->nvm_copy_data.identification__module_type);
-    print("\t Model ID : 0x%02X\n", pDev->nvm_copy_data.identification__model_id);
+// Publish a buffer from frame_buffer() after a SENSOR/PHASE/KIND topic
+// frame, subscribers filter on its prefix. ZeroMQ returns pool buffers to
+// the pool once every subscriber got them. With --batch the frame is
+// copied into the batch of its topic instead
+static void send_frame(void *publisher, VL53LX_Sensor_t *ps, int is_A, const char *kind, char *data, size_t len)
+{
+    char topic[64];
+    int topic_len;
+    zmq_msg_t msg;
 
-    if ((pDev->nvm_copy_data.identification__module_type == 0xAA) &&
-        (pDev->nvm_copy_data.identification__model_id == 0xEA))
+    topic_len = snprintf(topic, sizeof(topic), "%s/%s/%s", ps->config.name, is_A ? "A" : "B", kind);
+    if (compact_flag && binary_flag)
     {
-        print("\t Model Name : VL53L3CX\n");
+        printf("%s %zu bytes\n", topic, len);
     }
-    else
+    else if (compact_flag)
     {
-        print("WARNING: Unknown model ID!\n");
-        raise(SIGTERM);
+        printf("%s %.*s\n", topic, (int)len, data);
     }
 
-    print("\n");
+    // Text frames hold no newline, binary ones tell their size
+    if (batch_frames > 1 &&
+        VL53LX_pack_add(&packer, topic, data, len, binary_flag && strcmp(kind, "stats") != 0 ? VL53LX_PACK_NO_SEPARATOR : '\n',
+                        now_ns()) == 0)
+    {
+        if (VL53LX_pool_owns(&frame_pool, data))
+        {
+            VL53LX_pool_put(&frame_pool, data);
+        }
+        return;
+    }
 
-    // Set distance mode if not default
-    if (distance_mode != VL53LX_DISTANCEMODE_MEDIUM)
+    zmq_send(publisher, topic, topic_len, ZMQ_SNDMORE);
+    publish_bytes += topic_len + len;
+    publish_messages++;
+    if (!VL53LX_pool_owns(&frame_pool, data))
     {
-        print("Setting distance mode to %s\n", distance_mode == VL53LX_DISTANCEMODE_SHORT ? "SHORT" : "LONG");
-        status = VL53LX_SetDistanceMode(Dev, distance_mode);
-        check_status(status);
+        zmq_send(publisher, data, len, 0);
+        return;
     }
-    // Set timing budget if not default
-    if (timing_budget != 33)
+
+    zmq_msg_init_data(&msg, data, len, VL53LX_pool_release, &frame_pool);
+    if (zmq_msg_send(&msg, publisher, 0) < 0)
     {
-        print("Setting timing budget to %d ms\n", timing_budget);
-        status = VL53LX_SetMeasurementTimingBudgetMicroSeconds(Dev, timing_budget * 1000);
-        check_status(status);
+        // Releases the buffer
+        zmq_msg_close(&msg);
     }
+}
 
-    status = VL53LX_StartMeasurement(Dev);
-    check_status(status);
+// Publish one frame taken from the queue of its bus
+static void publish_frame(void *publisher, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
+{
+    const VL53LX_MultiRangingData_t *pMultiRangingData = &pframe->ranging;
+    const VL53LX_AdditionalData_t *pAdditionalData = &pframe->additional;
 
-    ranging_loop();
+    int no_of_object_found = 0;
+    int j;
+    int is_A;
+    char tmp_data1[5], tmp_data2[512], *data, *histogram;
+    char histogram_data_buffer[500] = "";
+
+    /*
+    From: https://community.st.com/s/question/0D53W00000etcEZ/understanding-vl53l3cx-histogram-data
+    We use:
+    VL53LX_Error VL53LX_GetAdditionalData(VL53LX_DEV Dev,
+    VL53LX_AdditionalData_t *pAdditionalData)
+    This function will return the histogram data.
+    But there is a trick. The data is formatted for the hardware and not for you.
+    Under the covers there are 2 ranges (an 'a' and a 'b' range)
+    The first 2 'bins' of the arrays are NOT histogram data.
+    And the next 4 bins of the 'a' array are ambient data - not histogram data.
+    So if you use VL53LX_GetAdditionalData and plot starting at bin 6 of the odd ranges and bin 2 of the even ranges you will do better.
+    The A ranges have 20 valid bins, the B ranges have 24 valid ones.
+
+    From: https://community.st.com/s/question/0D53W00001Gl6B2SAJ/can-someone-please-post-sample-code-on-how-to-get-histogram-data-from-vl53l3cx-i-have-the-dev-board-nucleo-f401-re-and-the-both-the-sensor-and-the-eval-kit
+
+    But it's not quite that easy. There are 2 ranges and they toggle back an forth. One range consists of 4 bins of ambient light and 20 data bins.
+    The alternating range consists of 24 range bins.
+    Range on a flat wall print out the 24 bins, gathering the data into a spreadsheet.
+    You will soon figure it out.
+    (The two range timing have to do with a search for 'radar aliasing' effects. google it.)
+    And each bin is about 20cm worth of distance.
+    */
+
+    no_of_object_found = pMultiRangingData->NumberOfObjectsFound;
+
+    // Process if object is found
+    if (no_of_object_found > 0)
+    {
+
+        // Check if even
+        is_A = (pMultiRangingData->StreamCount % 2 == 0);
+        //
+        if ((hist_mode == HIST_A && is_A) || (hist_mode == HIST_B && !is_A) || hist_mode == HIST_BOTH)
+        {
+            if (!compact_flag)
+            {
+                if (total_sensors > 1)
+                {
+                    printf("Sensor:    %s\n", ps->config.name);
+                }
+                // Bus syscalls spent since the previous frame of the sensor
+                printf("Count:     %d,\n", pMultiRangingData->StreamCount);
+                printf("# Objs:    %1d\n", no_of_object_found);
+                printf("Syscalls:  %u\n", pframe->syscalls);
+            }
+
+            sprintf(tmp_data1, "%d ", pMultiRangingData->StreamCount);
+
+            // The histogram goes out on its own topic
+            if (want(ps, is_A, "histogram"))
+            {
+                format_histogram(histogram_data_buffer, &pAdditionalData->VL53LX_p_006, is_A);
+                histogram = frame_buffer();
+                send_frame(publisher, ps, is_A, "histogram", histogram,
+                           sprintf(histogram, "%s%s", tmp_data1, histogram_data_buffer));
+
+                if (!compact_flag)
+                {
+                    printf("Histogram: %s\n", histogram_data_buffer);
+                }
+            }
+
+            if (!want(ps, is_A, "ranges"))
+            {
+                return;
+            }
+            data = frame_buffer();
+            strcpy(data, tmp_data1);
+
+            for (j = 0; j < no_of_object_found; j++)
+            {
+
+                if (!compact_flag)
+                {
+                    printf("Status=%d, Min Dist=%d mm, Dist=%d mm, Max dist=%d mm, Sigma=%2.2f mm, Signal Rate=%2.2f Mcps, Ambient Rate=%2.2f Mcps\n",
+                           pMultiRangingData->RangeData[j].RangeStatus,
+                           pMultiRangingData->RangeData[j].RangeMinMilliMeter,
+                           pMultiRangingData->RangeData[j].RangeMilliMeter,
+                           pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
+                           pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
+                           pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
+                           pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
+                }
+
+                if (j == no_of_object_found - 1)
+                {
+                    sprintf(tmp_data2, "%d,%d,%d,%d,%2.2f,%2.2f,%2.2f",
+                            pMultiRangingData->RangeData[j].RangeStatus,
+                            pMultiRangingData->RangeData[j].RangeMinMilliMeter,
+                            pMultiRangingData->RangeData[j].RangeMilliMeter,
+                            pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
+                            pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
+                            pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
+                            pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
+                }
+                else
+                {
+                    sprintf(tmp_data2, "%d,%d,%d,%d,%2.2f,%2.2f,%2.2f ",
+                            pMultiRangingData->RangeData[j].RangeStatus,
+                            pMultiRangingData->RangeData[j].RangeMinMilliMeter,
+                            pMultiRangingData->RangeData[j].RangeMilliMeter,
+                            pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
+                            pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
+                            pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
+                            pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
+                }
+
+                strcat(data, tmp_data2);
+                memset(tmp_data2, 0, sizeof(tmp_data2));
+            }
+
+            if (!compact_flag)
+            {
+                printf("\n");
+            }
+
+            send_frame(publisher, ps, is_A, "ranges", data, strlen(data));
+        }
+    }
 }
 
-// CTRL-C handler
-void signal_handler(int signal)
+// Publish the histogram of a raw frame with what processing it later needs
+static void publish_raw_frame(void *publisher, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
 {
+    const VL53LX_histogram_bin_data_t *pHD = &pframe->additional.VL53LX_p_006;
+    char *data;
+    int len = 0;
+    int is_A = (pHD->result__stream_count % 2 == 0);
+    int j;
 
-    // Print if not in compact mode
+    if ((hist_mode == HIST_A && !is_A) || (hist_mode == HIST_B && is_A) || !want(ps, is_A, "raw"))
+    {
+        return;
+    }
 
-    print("\n\rExiting...\n\r");
+    data = frame_buffer();
+    len += sprintf(data + len, "%d RAW %llu ", pHD->result__stream_count,
+                   (unsigned long long)(pframe->timestamp_ns / 1000));
 
-    // Turn off the sensor using GPIO4
-    char buf[100];
-    sprintf(buf, "/sys/class/gpio/gpio%d/value", XSHUTPIN);
-    FILE *fp = fopen(buf, "w");
-    if (fp == NULL)
+    for (j = 0; j < VL53LX_HISTOGRAM_BUFFER_SIZE; j++)
+    {
+        len += sprintf(data + len, j ? ",%d" : "%d", pHD->bin_data[j]);
+    }
+
+    // Timing and bin layout, in the order listed in the README
+    len += sprintf(data + len, " %u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%u,%u",
+                   pHD->VL53LX_p_005, pHD->VL53LX_p_015, pHD->vcsel_width,
+                   pHD->phasecal_result__vcsel_start, pHD->cal_config__vcsel_start,
+                   pHD->phasecal_result__reference_phase, pHD->zero_distance_phase,
+                   pHD->result__dss_actual_effective_spads, pHD->total_periods_elapsed,
+                   pHD->peak_duration_us, pHD->woi_duration_us,
+                   pHD->number_of_ambient_bins, pHD->ambient_events_sum,
+                   pHD->roi_config__user_roi_centre_spad,
+                   pHD->roi_config__user_roi_requested_global_xy_size);
+    for (j = 0; j < VL53LX_MAX_BIN_SEQUENCE_LENGTH; j++)
+    {
+        len += sprintf(data + len, ",%u", pHD->bin_seq[j]);
+    }
+    for (j = 0; j < VL53LX_MAX_BIN_SEQUENCE_LENGTH; j++)
+    {
+        len += sprintf(data + len, ",%u", pHD->bin_rep[j]);
+    }
+
+    if (!compact_flag)
+    {
+        printf("Count:     %d\n", pHD->result__stream_count);
+        printf("Syscalls:  %u\n", pframe->syscalls);
+        printf("Raw:       %s\n\n", data);
+    }
+
+    send_frame(publisher, ps, is_A, "raw", data, len);
+}
+
+// Publish the histogram of a frame read without range processing because
+// nobody subscribed to the ranges of its sensor
+static void publish_histogram(void *publisher, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
+{
+    const VL53LX_histogram_bin_data_t *pHD = &pframe->additional.VL53LX_p_006;
+    char *data;
+    int prefix, len;
+    int is_A = (pHD->result__stream_count % 2 == 0);
+
+    if ((hist_mode == HIST_A && !is_A) || (hist_mode == HIST_B && is_A) || !want(ps, is_A, "histogram"))
     {
-        print("Failed to open %s\n", buf);
         return;
     }
-    fprintf(fp, "0");
-    fclose(fp);
 
-    // Disable GPIO4 using sysfs
-    fp = fopen("/sys/class/gpio/unexport", "w");
-    if (fp == NULL)
+    data = frame_buffer();
+    prefix = sprintf(data, "%d ", pHD->result__stream_count);
+    len = prefix + format_histogram(data + prefix, pHD, is_A);
+
+    if (!compact_flag)
     {
-        print("Failed to open /sys/class/gpio/unexport\n");
-        // return;
+        printf("Count:     %d\n", pHD->result__stream_count);
+        printf("Histogram: %s\n\n", data + prefix);
     }
-    fprintf(fp, "%d", XSHUTPIN);
-    fclose(fp);
 
-    exit(signal);
+    send_frame(publisher, ps, is_A, "histogram", data, len);
+}
+
+// Create the batch file of every sensor, each stores the processing context
+// of its sensor, which the driver only derives while processing a range
+void open_raw_files(void)
+{
+    VL53LX_MultiRangingData_t ranging;
+    VL53LX_BatchContext_t context;
+    VL53LX_Sensor_t *ps;
+    char path[PATH_MAX];
+    int i, b;
+
+    for (b = 0; b < bus_count; b++)
+    {
+        for (i = 0; i < sensors[b].count; i++)
+        {
+            ps = &sensors[b].sensor[i];
+            if (total_sensors > 1)
+            {
+                snprintf(path, sizeof(path), "%s.%s", raw_file, ps->config.name);
+            }
+            else
+            {
+                snprintf(path, sizeof(path), "%s", raw_file);
+            }
+
+            status = VL53LX_WaitMeasurementDataReady(&ps->dev);
+            if (status == VL53LX_ERROR_NONE)
+            {
+                status = VL53LX_GetMultiRangingData(&ps->dev, &ranging);
+            }
+            if (status == VL53LX_ERROR_NONE)
+            {
+                status = VL53LX_GetBatchContext(&ps->dev, &context);
+            }
+            check_status(status);
+            VL53LX_ClearInterruptAndStartMeasurement(&ps->dev);
+
+            if (status == VL53LX_ERROR_NONE)
+            {
+                raw_files[b][i] = VL53LX_batch_create(path, &context);
+                print("Recording raw histograms of %s to %s\n", ps->config.name, path);
+            }
+        }
+    }
+}
+
+// Publish a frame in the binary wire format, see vl53lx_platform_wire.h
+static void publish_binary_frame(void *publisher, VL53LX_Sensor_t *ps, uint8_t sensor_id, const VL53LX_Frame_t *pframe)
+{
+    char *data;
+    int is_A = (pframe->additional.VL53LX_p_006.result__stream_count % 2 == 0);
+    uint32_t len;
+
+    // Same frames as the text format
+    if ((hist_mode == HIST_A && !is_A) || (hist_mode == HIST_B && is_A) ||
+        !want(ps, is_A, pframe->raw ? "raw" : "ranges"))
+    {
+        return;
+    }
+    if (!pframe->raw && pframe->ranging.NumberOfObjectsFound == 0)
+    {
+        return;
+    }
+
+    data = frame_buffer();
+    len = VL53LX_wire_encode(pframe, sensor_id, data);
+
+    if (!compact_flag)
+    {
+        printf("Sensor:    %d\n", sensor_id);
+        printf("Count:     %d\n", pframe->additional.VL53LX_p_006.result__stream_count);
+        printf("# Objs:    %d\n", pframe->raw ? 0 : pframe->ranging.NumberOfObjectsFound);
+        printf("Bytes:     %u\n\n", len);
+    }
+
+    send_frame(publisher, ps, is_A, pframe->raw ? "raw" : "ranges", data, len);
+}
+
+// Publish what acquiring a frame cost, whatever its format and content
+static void publish_stats(void *publisher, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
+{
+    int count = pframe->additional.VL53LX_p_006.result__stream_count;
+    char *data;
+    int len;
+
+    if (!want(ps, count % 2 == 0, "stats"))
+    {
+        return;
+    }
+
+    data = frame_buffer();
+    len = sprintf(data, "%d %llu %u", count, (unsigned long long)(pframe->timestamp_ns / 1000), pframe->syscalls);
+    send_frame(publisher, ps, count % 2 == 0, "stats", data, len);
+}
+
+// What the acquisition thread has to read for the topics of a sensor
+// someone subscribed to. Raw topics only exist for sensors configured raw
+// and the histogram topic only in the text format
+static uint32_t sensor_demand(VL53LX_Sensor_t *ps, int b, int i)
+{
+    if (shm_name[0] || journal_path[0])
+    {
+        return VL53LX_WORKER_READ_FULL;
+    }
+    if (!ps->config.raw && want_any(ps, "ranges"))
+    {
+        return VL53LX_WORKER_READ_FULL;
+    }
+    if (raw_files[b][i] || want_any(ps, "stats") || (ps->config.raw && want_any(ps, "raw")) ||
+        (!binary_flag && want_any(ps, "histogram")))
+    {
+        return VL53LX_WORKER_READ_RAW;
+    }
+    return VL53LX_WORKER_READ_NONE;
+}
+
+// Apply the subscriptions to every acquisition thread, returns whether
+// anything at all is in demand
+static int update_demand(void)
+{
+    uint32_t level;
+    int wanted = 0;
+    int i, b;
+
+    for (b = 0; b < bus_count; b++)
+    {
+        for (i = 0; i < sensors[b].count; i++)
+        {
+            level = sensor_demand(&sensors[b].sensor[i], b, i);
+            VL53LX_worker_set_demand(&workers[b], i, level);
+            wanted |= (level != VL53LX_WORKER_READ_NONE);
+        }
+    }
+    return wanted;
+}
+
+// Track the subscriptions XPUB passes up, a first byte of 1 subscribes and
+// 0 unsubscribes from the topic prefix that follows. XPUB only forwards
+// the first subscription and the last unsubscription of each prefix, so a
+// plain set is enough
+static int read_subscriptions(void *publisher)
+{
+    char message[TOPIC_SIZE + 1];
+    int changed = 0;
+    int len, i;
+
+    while ((len = zmq_recv(publisher, message, sizeof(message) - 1, ZMQ_DONTWAIT)) > 0)
+    {
+        if (len > TOPIC_SIZE)
+        {
+            print("Ignoring subscription longer than %d bytes\n", TOPIC_SIZE - 1);
+            continue;
+        }
+        message[len] = '\0';
+
+        for (i = 0; i < subscription_count && strcmp(subscriptions[i], message + 1) != 0; i++)
+            ;
+        if (message[0] == 1 && i == subscription_count && subscription_count < MAX_SUBSCRIPTIONS)
+        {
+            strcpy(subscriptions[subscription_count++], message + 1);
+            print("Subscribed to \"%s\"\n", message + 1);
+        }
+        else if (message[0] == 0 && i < subscription_count)
+        {
+            strcpy(subscriptions[i], subscriptions[--subscription_count]);
+            print("Unsubscribed from \"%s\"\n", message + 1);
+        }
+        changed = 1;
+    }
+    return changed;
+}
+
+// Queue a frame for publishing, called by the acquisition thread of its bus
+static void queue_frame(void *user, VL53LX_Sensor_t *ps, const VL53LX_Frame_t *pframe)
+{
+    VL53LX_Ring_t *ring = user;
+    VL53LX_Worker_t *worker = &workers[ring - rings];
+    VL53LX_Frame_t *slot;
+
+    // A blocked queue still lets the worker notice it was cancelled
+    while ((slot = VL53LX_ring_claim(ring, 100)) == NULL)
+    {
+        if (!worker->running)
+        {
+            return;
+        }
+    }
+    memcpy(slot, pframe, sizeof(*slot));
+    VL53LX_ring_push(ring);
+}
+
+// Upper bound in us of the bucket holding a fraction of the runs of a stage
+static double profile_percentile(const VL53LX_ProfileStage_t *pst, double fraction)
+{
+    uint64_t rank = (uint64_t)(pst->count * fraction);
+    uint64_t seen = 0;
+    int bucket;
+
+    for (bucket = 0; bucket < VL53LX_PROFILE_BUCKETS - 1; bucket++)
+    {
+        seen += pst->histogram[bucket];
+        if (seen > rank)
+        {
+            break;
+        }
+    }
+    return (double)(2ULL << bucket) / 1000;
+}
+
+// Stage durations of a sensor, when the driver was built with PROFILE=1
+static void print_profile(VL53LX_Sensor_t *ps)
+{
+    VL53LX_ProfileStats_t profile;
+    const VL53LX_ProfileStage_t *pst;
+
+    VL53LX_GetProfileStats(&ps->dev, &profile);
+    if (profile.stage[VL53LX_PROFILE_DEVICE_RESULTS].count == 0)
+    {
+        return;
+    }
+
+    print("Stages of %s in us:\n", ps->config.name);
+    print("\t%-18s %8s %9s %9s %9s %9s\n", "stage", "count", "mean", "p50 <", "p99 <", "max");
+    for (int s = 0; s < VL53LX_PROFILE_STAGES; s++)
+    {
+        pst = &profile.stage[s];
+        if (pst->count == 0)
+        {
+            continue;
+        }
+        print("\t%-18s %8u %9.1f %9.1f %9.1f %9.1f\n", VL53LX_ProfileStageName(s), pst->count,
+              (double)pst->total_ns / pst->count / 1000, profile_percentile(pst, 0.5),
+              profile_percentile(pst, 0.99), (double)pst->max_ns / 1000);
+    }
+}
+
+// Stream counts run from 0 to 255 then wrap to 128, they restart at 0
+// with ranging
+static void count_frame(int b, const VL53LX_Frame_t *pframe)
+{
+    struct sensor_counters *pc = &sensor_counters[b][pframe->sensor];
+    uint8_t count = pframe->ranging.StreamCount;
+    uint8_t expected = pc->stream_count == 255 ? 128 : pc->stream_count + 1;
+
+    if (pc->frames > 0 && count != 0 && count != expected)
+    {
+        pc->stream_gaps++;
+    }
+    pc->stream_count = count;
+    pc->frames++;
+}
+
+// Frame and byte rates over windows of a second
+static void update_rates(uint64_t now)
+{
+    double seconds = (now - window_start_ns) / 1e9;
+    struct sensor_counters *pc;
+
+    if (seconds < 1)
+    {
+        return;
+    }
+    for (int b = 0; b < bus_count; b++)
+    {
+        for (int i = 0; i < sensors[b].count; i++)
+        {
+            pc = &sensor_counters[b][i];
+            pc->frame_rate = (pc->frames - pc->window_frames) / seconds;
+            pc->window_frames = pc->frames;
+        }
+    }
+    publish_rate = (publish_bytes - window_bytes) / seconds;
+    window_bytes = publish_bytes;
+    window_start_ns = now;
+}
+
+static void sensor_labels(char *labels, int b, int i)
+{
+    labels[0] = '\0';
+    VL53LX_metrics_label(labels, METRICS_LABELS_SIZE, "sensor", sensors[b].sensor[i].config.name);
+    VL53LX_metrics_label(labels, METRICS_LABELS_SIZE, "bus", i2c_device[b]);
+}
+
+enum sensor_metric
+{
+    FRAMES_TOTAL,
+    FRAMES_PER_SECOND,
+    STREAM_GAPS_TOTAL,
+    NOT_READY_TOTAL,
+    RANGE_ERRORS_TOTAL,
+    I2C_TRANSFERS_TOTAL,
+    I2C_ERRORS_TOTAL,
+    INTERRUPT_TIMEOUTS_TOTAL,
+    REGISTER_WAIT_POLLS_TOTAL,
+    REGISTER_WAIT_TIMEOUTS_TOTAL,
+    SHADOW_START_BYTES_SAVED,
+    SENSOR_METRICS,
+};
+
+struct _metric_text
+{
+    char *name;
+    char *type;
+    char *help;
+} sensor_metric_text[SENSOR_METRICS] = {
+    {"frames_total", "counter", "Frames taken from the acquisition queue."},
+    {"frames_per_second", "gauge", "Frames per second over the previous second."},
+    {"stream_gaps_total", "counter", "Frames whose stream count does not follow the previous one, ranges were lost."},
+    {"not_ready_total", "counter", "Data ready checks that found no data yet."},
+    {"range_errors_total", "counter", "Failed data ready checks and range reads, the range is started again."},
+    {"i2c_transfers_total", "counter", "I2C transfers issued."},
+    {"i2c_errors_total", "counter", "I2C transfers that failed."},
+    {"interrupt_timeouts_total", "counter", "Waits for GPIO1 that saw no edge."},
+    {"register_wait_polls_total", "counter", "Register reads polling for the device to be ready."},
+    {"register_wait_timeouts_total", "counter", "Register waits that timed out."},
+    {"shadow_start_bytes_saved", "gauge", "Bytes the register shadow left out of the latest start of ranging."},
+};
+
+// The acquisition threads update the device counters with relaxed atomic
+// adds, they are read without stopping them
+#define COUNTER(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+static double sensor_metric_value(int metric, int b, int i)
+{
+    VL53LX_Dev_t *pdev = &sensors[b].sensor[i].dev;
+
+    switch (metric)
+    {
+    case FRAMES_TOTAL:
+        return sensor_counters[b][i].frames;
+    case FRAMES_PER_SECOND:
+        return sensor_counters[b][i].frame_rate;
+    case STREAM_GAPS_TOTAL:
+        return sensor_counters[b][i].stream_gaps;
+    case NOT_READY_TOTAL:
+        return atomic_load_explicit(&workers[b].not_ready[i], memory_order_relaxed);
+    case RANGE_ERRORS_TOTAL:
+        return atomic_load_explicit(&workers[b].errors[i], memory_order_relaxed);
+    case I2C_TRANSFERS_TOTAL:
+        return COUNTER(pdev->stats.syscalls);
+    case I2C_ERRORS_TOTAL:
+        return COUNTER(pdev->stats.errors);
+    case INTERRUPT_TIMEOUTS_TOTAL:
+        return COUNTER(pdev->stats.interrupt_timeouts);
+    case REGISTER_WAIT_POLLS_TOTAL:
+        return COUNTER(pdev->wait_stats.polls);
+    case REGISTER_WAIT_TIMEOUTS_TOTAL:
+        return COUNTER(pdev->wait_stats.timeouts);
+    default:
+        return COUNTER(sensors[b].sensor[i].start_bytes_elided);
+    }
+}
+
+// One sample per bus of a queue metric
+static void queue_metric(const char *name, const char *type, const char *help, uint32_t *values)
+{
+    char labels[METRICS_LABELS_SIZE];
+
+    VL53LX_metrics_family(&metrics, name, type, help);
+    for (int b = 0; b < bus_count; b++)
+    {
+        labels[0] = '\0';
+        VL53LX_metrics_label(labels, sizeof(labels), "bus", i2c_device[b]);
+        VL53LX_metrics_sample(&metrics, name, labels, values[b]);
+    }
+}
+
+// Answers the scrape whose request is in, from the counters as they are now
+static void serve_metrics(void)
+{
+    static VL53LX_ProfileStats_t profile[MAX_BUSES][VL53LX_MULTI_MAX_SENSORS];
+    uint32_t depth[MAX_BUSES], capacity[MAX_BUSES], overflows[MAX_BUSES];
+    char labels[METRICS_LABELS_SIZE];
+    char stage_labels[METRICS_LABELS_SIZE];
+    int profiled = 0;
+
+    for (int m = 0; m < SENSOR_METRICS; m++)
+    {
+        VL53LX_metrics_family(&metrics, sensor_metric_text[m].name, sensor_metric_text[m].type,
+                              sensor_metric_text[m].help);
+        for (int b = 0; b < bus_count; b++)
+        {
+            for (int i = 0; i < sensors[b].count; i++)
+            {
+                sensor_labels(labels, b, i);
+                VL53LX_metrics_sample(&metrics, sensor_metric_text[m].name, labels, sensor_metric_value(m, b, i));
+            }
+        }
+    }
+
+    for (int b = 0; b < bus_count; b++)
+    {
+        depth[b] = VL53LX_ring_depth(&rings[b]);
+        capacity[b] = rings[b].mask + 1;
+        overflows[b] = VL53LX_ring_overflows(&rings[b]);
+    }
+    queue_metric("queue_depth", "gauge", "Frames waiting to be published.", depth);
+    queue_metric("queue_depth_max", "gauge", "Most frames waiting since the previous scrape.", queue_depth_max);
+    queue_metric("queue_capacity", "gauge", "Frames the queue holds.", capacity);
+    queue_metric("queue_overflows_total", "counter",
+                 "Frames that found the queue full, dropped or blocking acquisition.", overflows);
+    memset(queue_depth_max, 0, sizeof(queue_depth_max));
+
+    VL53LX_metrics_family(&metrics, "publish_bytes_total", "counter", "Topic and payload bytes published.");
+    VL53LX_metrics_sample(&metrics, "publish_bytes_total", "", publish_bytes);
+    VL53LX_metrics_family(&metrics, "publish_bytes_per_second", "gauge",
+                          "Bytes published per second over the previous second.");
+    VL53LX_metrics_sample(&metrics, "publish_bytes_per_second", "", publish_rate);
+    VL53LX_metrics_family(&metrics, "publish_messages_total", "counter", "Messages published.");
+    VL53LX_metrics_sample(&metrics, "publish_messages_total", "", publish_messages);
+
+    // Only built with PROFILE=1
+    for (int b = 0; b < bus_count; b++)
+    {
+        for (int i = 0; i < sensors[b].count; i++)
+        {
+            VL53LX_GetProfileStats(&sensors[b].sensor[i].dev, &profile[b][i]);
+            for (int s = 0; s < VL53LX_PROFILE_STAGES; s++)
+            {
+                profiled |= profile[b][i].stage[s].count > 0;
+            }
+        }
+    }
+    if (profiled)
+    {
+        VL53LX_metrics_family(&metrics, "stage_duration_seconds", "histogram",
+                              "Durations of the range processing stages.");
+    }
+    for (int b = 0; profiled && b < bus_count; b++)
+    {
+        for (int i = 0; i < sensors[b].count; i++)
+        {
+            sensor_labels(labels, b, i);
+            for (int s = 0; s < VL53LX_PROFILE_STAGES; s++)
+            {
+                if (profile[b][i].stage[s].count == 0)
+                {
+                    continue;
+                }
+                snprintf(stage_labels, sizeof(stage_labels), "%s", labels);
+                VL53LX_metrics_label(stage_labels, sizeof(stage_labels), "stage", VL53LX_ProfileStageName(s));
+                VL53LX_metrics_histogram(&metrics, "stage_duration_seconds", stage_labels,
+                                         &profile[b][i].stage[s]);
+            }
+        }
+    }
+
+    VL53LX_metrics_reply(&metrics);
 }
 
 // Ranging loop
@@ -413,202 +1423,258 @@ void ranging_loop(void)
 {
     // Socket to talk to clients
     void *context = zmq_ctx_new();
-    void *publisher = zmq_socket(context, ZMQ_PUB);
+    // XPUB to learn the subscriptions, nobody subscribed means no work
+    void *publisher = zmq_socket(context, ZMQ_XPUB);
     // create ip string with tcp port
     char ip_string[20];
     sprintf(ip_string, "tcp://*:%d", tcp_port);
     int rc = zmq_bind(publisher, ip_string);
     assert(rc == 0);
 
-    VL53LX_MultiRangingData_t MultiRangingData;
-    VL53LX_MultiRangingData_t *pMultiRangingData = &MultiRangingData;
-    VL53LX_AdditionalData_t AdditionalData;
-    VL53LX_AdditionalData_t *pAdditionalData = &AdditionalData;
+    static VL53LX_Frame_t frame;
+    zmq_pollitem_t items[3];
+    int item_count = 2;
+    VL53LX_Sensor_t *ps;
+    struct timespec now;
+    time_t idle_since;
+    uint64_t pushes, deadline;
+    long timeout;
+    int running = 1;
+    int paused = 0;
+    int wanted;
+    int b;
+
+    rc = VL53LX_pool_init(&frame_pool, FRAME_BUFFER_SIZE, FRAME_BUFFERS);
+    assert(rc == 0);
+    if (batch_frames > 1)
+    {
+        rc = VL53LX_pack_init(&packer, BATCH_BUFFER_SIZE, BATCH_BUFFERS, batch_frames,
+                              batch_latency * 1000000ULL, send_batch, publisher);
+        assert(rc == 0);
+    }
+    if (shm_name[0])
+    {
+        rc = VL53LX_shm_create(&shm, shm_name, VL53LX_WIRE_MAX_SIZE, SHM_SLOTS);
+        assert(rc == 0);
+        print("Writing frames to /dev/shm%s\n", shm_name);
+    }
+    if (journal_path[0])
+    {
+        for (b = 0; b < bus_count; b++)
+        {
+            for (int i = 0; i < sensors[b].count; i++)
+            {
+                status = VL53LX_journal_add_sensor(&journal, sensor_base[b] + i, &sensors[b].sensor[i]);
+                check_status(status);
+            }
+        }
+        rc = VL53LX_journal_start(&journal, journal_path, (uint64_t)journal_size << 20);
+        assert(rc == 0);
+        print("Recording frames to %s.NNNN\n", journal_path);
+    }
 
-    uint8_t NewDataReady = 0;
-    int no_of_object_found = 0;
-    int j;
-    int is_A;
-    char tmp_data1[5], tmp_data2[512], data[3000];
-    char histogram_data_buffer[500];
-    char bin_buffer[5];
+    // Every queue rings the same bell, subscriptions come in on the socket
+    items[0] = (zmq_pollitem_t){publisher, 0, ZMQ_POLLIN, 0};
+    items[1] = (zmq_pollitem_t){NULL, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), ZMQ_POLLIN, 0};
+    assert(items[1].fd >= 0);
+    for (b = 0; b < bus_count; b++)
+    {
+        rc = VL53LX_ring_init(&rings[b], sizeof(VL53LX_Frame_t), queue_length, queue_policy);
+        assert(rc == 0);
+        rings[b].notify_fd = items[1].fd;
+    }
+    // Scrapes are answered between frames, a slow client never holds them
+    if (metrics_address)
+    {
+        rc = VL53LX_metrics_open(&metrics, metrics_address);
+        assert(rc == 0);
+        items[item_count++] = (zmq_pollitem_t){NULL, VL53LX_metrics_fd(&metrics), ZMQ_POLLIN, 0};
+        window_start_ns = now_ns();
+        print("Serving metrics on %s\n", metrics_address);
+    }
 
     print("\nRanging started...\n\n");
 
-    do
-    { // polling mode
-
-        status = VL53LX_GetMeasurementDataReady(Dev, &NewDataReady);
+    // One acquisition thread per bus, this thread only publishes
+    for (b = 0; b < bus_count; b++)
+    {
+        status = VL53LX_worker_start(&workers[b], &sensors[b], poll_period, queue_frame, &rings[b]);
         check_status(status);
+    }
+    workers_started = 1;
+    wanted = update_demand();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    idle_since = now.tv_sec;
 
-        usleep(poll_period * 1000); // Polling period
-
-        if ((!status) && (NewDataReady != 0))
+    // Until interrupted or every replay ran out, then the queues drain
+    while (running)
+    {
+        running = 0;
+        for (b = 0; b < bus_count; b++)
         {
+            running |= workers[b].running;
+        }
 
-            status = VL53LX_GetMultiRangingData(Dev, pMultiRangingData);
-            check_status(status);
-
-            /*
-            From: https://community.st.com/s/question/0D53W00000etcEZ/understanding-vl53l3cx-histogram-data
-            We use:
-            VL53LX_Error VL53LX_GetAdditionalData(VL53LX_DEV Dev,
-            VL53LX_AdditionalData_t *pAdditionalData)
-            This function will return the histogram data.
-            But there is a trick. The data is formatted for the hardware and not for you.
-            Under the covers there are 2 ranges (an 'a' and a 'b' range)
-            The first 2 'bins' of the arrays are NOT histogram data.
-            And the next 4 bins of the 'a' array are ambient data - not histogram data.
-            So if you use VL53LX_GetAdditionalData and plot starting at bin 6 of the odd ranges and bin 2 of the even ranges you will do better.
-            The A ranges have 20 valid bins, the B ranges have 24 valid ones.
-
-            From: https://community.st.com/s/question/0D53W00001Gl6B2SAJ/can-someone-please-post-sample-code-on-how-to-get-histogram-data-from-vl53l3cx-i-have-the-dev-board-nucleo-f401-re-and-the-both-the-sensor-and-the-eval-kit
-
-            But it's not quite that easy. There are 2 ranges and they toggle back an forth. One range consists of 4 bins of ambient light and 20 data bins.
-            The alternating range consists of 24 range bins.
-            Range on a flat wall print out the 24 bins, gathering the data into a spreadsheet.
-            You will soon figure it out.
-            (The two range timing have to do with a search for 'radar aliasing' effects. google it.)
-            And each bin is about 20cm worth of distance.
-            */
-
-            no_of_object_found = pMultiRangingData->NumberOfObjectsFound;
-
-            // Process if object is found
-            if (no_of_object_found > 0)
-            {
-
-                // Check if even
-                is_A = (pMultiRangingData->StreamCount % 2 == 0);
-                //
-                if ((hist_mode == HIST_A && is_A) || (hist_mode == HIST_B && !is_A) || hist_mode == HIST_BOTH)
-                {
-                    if (!compact_flag)
-                    {
-                        printf("Count:     %d,\n", pMultiRangingData->StreamCount);
-                        printf("# Objs:    %1d\n", no_of_object_found);
-                    }
+        // Wake up in time for the first batch due
+        timeout = 100;
+        deadline = batch_frames > 1 ? VL53LX_pack_deadline(&packer) : 0;
+        if (deadline)
+        {
+            timeout = deadline > now_ns() ? (long)((deadline - now_ns() + 999999) / 1000000) : 0;
+            timeout = timeout < 100 ? timeout : 100;
+        }
+        zmq_poll(items, item_count, timeout);
+        rc = read(items[1].fd, &pushes, sizeof(pushes));
 
-                    sprintf(tmp_data1, "%d ", pMultiRangingData->StreamCount);
-                    strcat(data, tmp_data1);
-                    memset(tmp_data1, 0, sizeof(tmp_data1));
+        if (read_subscriptions(publisher))
+        {
+            wanted = update_demand();
+        }
 
-                    // if (hist_flag)
-                    // {
+        // Stop ranging once nobody listened for idle_stop seconds
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (wanted)
+        {
+            idle_since = now.tv_sec;
+        }
+        if (idle_stop > 0 && paused != (!wanted && now.tv_sec - idle_since >= idle_stop))
+        {
+            paused = !paused;
+            for (b = 0; b < bus_count; b++)
+            {
+                VL53LX_worker_pause(&workers[b], paused);
+            }
+            print(paused ? "No subscribers, ranging stopped\n" : "Subscribed, ranging restarted\n");
+        }
 
-                    VL53LX_GetAdditionalData(Dev, pAdditionalData);
+        for (b = 0; b < bus_count; b++)
+        {
+            if (metrics_address && VL53LX_ring_depth(&rings[b]) > queue_depth_max[b])
+            {
+                queue_depth_max[b] = VL53LX_ring_depth(&rings[b]);
+            }
+            while (VL53LX_ring_pop(&rings[b], &frame))
+            {
+                ps = &sensors[b].sensor[frame.sensor];
+                count_frame(b, &frame);
+                // Local consumers get every frame, encoded in place
+                if (shm_name[0])
+                {
+                    VL53LX_shm_commit(&shm, VL53LX_wire_encode(&frame, sensor_base[b] + frame.sensor,
+                                                               VL53LX_shm_claim(&shm)));
+                }
+                if (journal_path[0])
+                {
+                    VL53LX_journal_append(&journal, &frame, sensor_base[b] + frame.sensor);
+                }
 
-                    // Convert the histogram data to a comma-separated string
-                    if ((hist_mode == HIST_A && is_A) || (hist_mode == HIST_BOTH && is_A))
-                    {
-                        for (j = 5; j < VL53LX_HISTOGRAM_BUFFER_SIZE; j++)
-                        {
-                            if (j == VL53LX_HISTOGRAM_BUFFER_SIZE - 1)
-                            {
-                                sprintf(bin_buffer, "%d ", pAdditionalData->VL53LX_p_006.bin_data[j]);
-                                strcat(histogram_data_buffer, bin_buffer);
-                            }
-                            else
-                            {
-                                sprintf(bin_buffer, "%d,", pAdditionalData->VL53LX_p_006.bin_data[j]);
-                                strcat(histogram_data_buffer, bin_buffer);
-                            }
-                        }
-                    }
-                    else if ((hist_mode == HIST_B && !is_A) || (hist_mode == HIST_BOTH && !is_A))
+                // Frames of sensors not configured raw are only read raw
+                // when nobody wants their ranges
+                if (binary_flag)
+                {
+                    if (!frame.raw || ps->config.raw)
                     {
-                        for (j = 1; j < VL53LX_HISTOGRAM_BUFFER_SIZE; j++)
-                        {
-                            if (j == VL53LX_HISTOGRAM_BUFFER_SIZE - 1)
-                            {
-                                sprintf(bin_buffer, "%d ", pAdditionalData->VL53LX_p_006.bin_data[j]);
-                                strcat(histogram_data_buffer, bin_buffer);
-                            }
-                            else
-                            {
-                                sprintf(bin_buffer, "%d,", pAdditionalData->VL53LX_p_006.bin_data[j]);
-                                strcat(histogram_data_buffer, bin_buffer);
-                            }
-                        }
+                        publish_binary_frame(publisher, ps, sensor_base[b] + frame.sensor, &frame);
                     }
+                }
+                else if (frame.raw && ps->config.raw)
+                {
+                    publish_raw_frame(publisher, ps, &frame);
+                }
+                else if (frame.raw)
+                {
+                    publish_histogram(publisher, ps, &frame);
+                }
+                else
+                {
+                    publish_frame(publisher, ps, &frame);
+                }
 
-                    strcat(data, histogram_data_buffer);
-
-                    if (!compact_flag)
-                    {
-                        printf("Histogram: %s\n", histogram_data_buffer);
-                    }
+                publish_stats(publisher, ps, &frame);
 
-                    // }
-                    for (j = 0; j < no_of_object_found; j++)
-                    {
+                if (frame.raw && raw_files[b][frame.sensor])
+                {
+                    VL53LX_batch_append(raw_files[b][frame.sensor], frame.timestamp_ns,
+                                        &frame.additional.VL53LX_p_006, &frame.inputs);
+                }
+            }
+        }
 
-                        if (!compact_flag)
-                        {
-                            printf("Status=%d, Min Dist=%d mm, Dist=%d mm, Max dist=%d mm, Sigma=%2.2f mm, Signal Rate=%2.2f Mcps, Ambient Rate=%2.2f Mcps\n",
-                                   pMultiRangingData->RangeData[j].RangeStatus,
-                                   pMultiRangingData->RangeData[j].RangeMinMilliMeter,
-                                   pMultiRangingData->RangeData[j].RangeMilliMeter,
-                                   pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
-                                   pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
-                                   pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
-                                   pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
-                        }
-
-                        if (j == no_of_object_found - 1)
-                        {
-                            sprintf(tmp_data2, "%d,%d,%d,%d,%2.2f,%2.2f,%2.2f",
-                                    pMultiRangingData->RangeData[j].RangeStatus,
-                                    pMultiRangingData->RangeData[j].RangeMinMilliMeter,
-                                    pMultiRangingData->RangeData[j].RangeMilliMeter,
-                                    pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
-                                    pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
-                                    pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
-                                    pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
-                        }
-                        else
-                        {
-                            sprintf(tmp_data2, "%d,%d,%d,%d,%2.2f,%2.2f,%2.2f ",
-                                    pMultiRangingData->RangeData[j].RangeStatus,
-                                    pMultiRangingData->RangeData[j].RangeMinMilliMeter,
-                                    pMultiRangingData->RangeData[j].RangeMilliMeter,
-                                    pMultiRangingData->RangeData[j].RangeMaxMilliMeter,
-                                    pMultiRangingData->RangeData[j].SigmaMilliMeter / 65536.0,
-                                    pMultiRangingData->RangeData[j].SignalRateRtnMegaCps / 65536.0,
-                                    pMultiRangingData->RangeData[j].AmbientRateRtnMegaCps / 65536.0);
-                        }
-
-                        strcat(data, tmp_data2);
-                        memset(tmp_data2, 0, sizeof(tmp_data2));
-                    }
+        if (batch_frames > 1)
+        {
+            VL53LX_pack_expire(&packer, now_ns());
+        }
 
-                    rc = zmq_send(publisher, data, strlen(data), 0);
+        if (metrics_address)
+        {
+            update_rates(now_ns());
+            if (VL53LX_metrics_serve(&metrics, items[2].revents != 0, now_ns()))
+            {
+                serve_metrics();
+            }
+            items[2].fd = VL53LX_metrics_fd(&metrics);
+            items[2].events = VL53LX_metrics_sending(&metrics) ? ZMQ_POLLOUT : ZMQ_POLLIN;
+        }
+    }
 
-                    if (compact_flag)
-                    {
-                        printf("%s\n", data);
-                    }
-                    else
-                    {
-                        printf("\n");
-                    }
+    if (batch_frames > 1)
+    {
+        VL53LX_pack_flush(&packer);
+        print("Packed %llu frames into %llu messages\n", (unsigned long long)packer.frames,
+              (unsigned long long)packer.messages);
+    }
 
-                    // clear buffers
-                    // if (hist_flag)
-                    // {
-                    memset(histogram_data_buffer, 0, sizeof(histogram_data_buffer));
-                    memset(bin_buffer, 0, sizeof(bin_buffer));
-                    // }
-                    memset(data, 0, sizeof(data));
-                }
+    for (b = 0; b < bus_count; b++)
+    {
+        VL53LX_worker_join(&workers[b]);
+        if (VL53LX_ring_overflows(&rings[b]))
+        {
+            print("Queue of %s overflowed %u times\n", i2c_device[b], VL53LX_ring_overflows(&rings[b]));
+        }
+        VL53LX_ring_free(&rings[b]);
+        for (int i = 0; i < sensors[b].count; i++)
+        {
+            if (raw_files[b][i])
+            {
+                fclose(raw_files[b][i]);
             }
         }
 
-        status = VL53LX_ClearInterruptAndStartMeasurement(Dev);
-        check_status(status);
+        for (int i = 0; i < sensors[b].count; i++)
+        {
+            print_profile(&sensors[b].sensor[i]);
+        }
 
-    } while (1);
+        // Powers the sensors down and flushes a capture in progress
+        VL53LX_multi_close(&sensors[b]);
+    }
+    close(items[1].fd);
+    if (metrics_address)
+    {
+        VL53LX_metrics_close(&metrics);
+    }
+    if (shm_name[0])
+    {
+        VL53LX_shm_close(&shm, shm_name);
+    }
+    if (journal_path[0])
+    {
+        VL53LX_journal_stop(&journal);
+        print("Recorded %llu frames in %u segments, %u dropped, %u lost\n", (unsigned long long)journal.frames,
+              journal.segment, VL53LX_journal_dropped(&journal), journal.errors);
+    }
 
     zmq_close(publisher);
     zmq_ctx_destroy(context);
+
+    // Every message is released once the context is gone
+    if (VL53LX_pool_exhausted(&frame_pool))
+    {
+        print("Frame pool ran out %u times\n", VL53LX_pool_exhausted(&frame_pool));
+    }
+    VL53LX_pool_free(&frame_pool);
+    if (batch_frames > 1)
+    {
+        VL53LX_pack_free(&packer);
+    }
 }